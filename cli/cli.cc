@@ -15,6 +15,7 @@
 #define CLI_COLUMNS "cli_columns"
 #define CLI_INDEXES "cli_indexes"
 #define COLUMNS_TABLE_RECORD_MAX_LENGTH 150   // It is actually 112
+#define LOAD_BATCH_SIZE 1000    // tuples inserted at once by load
 #define DIVISOR "  |  "
 #define DIVISOR_LENGTH 5
 #define EXIT_CODE -99
@@ -264,6 +265,7 @@ RC CLI::process(const string input)
     ////////////////////////////////////////////
     // print <tableName>
     // print attributes <tableName>
+    // print iostats
     ////////////////////////////////////////////
     else if (expect(tokenizer, "print")) {
       tokenizer = next();
@@ -271,6 +273,8 @@ RC CLI::process(const string input)
         code = printAttributes();
       else if (expect(tokenizer, "index"))
         code = printIndex();
+      else if (expect(tokenizer, "iostats"))
+        code = printIOStats();
       else if (tokenizer != NULL)
         code = printTable(string(tokenizer));
       else
@@ -1195,7 +1199,10 @@ RC CLI::load()
   this->getAttributesFromCatalog(tableName, attributes);
   uint offset = 0, index = 0, keyIndex = 0;
   uint length;
-  void *buffer = malloc(PAGE_SIZE);
+  vector<void *> buffers(LOAD_BATCH_SIZE);
+  for (uint i = 0; i < LOAD_BATCH_SIZE; i++)
+    buffers[i] = malloc(PAGE_SIZE);
+  uint numOfTuples = 0;
   void *key = malloc(PAGE_SIZE);
   RID rid;
 
@@ -1227,6 +1234,7 @@ RC CLI::load()
     getline(ifs, line);
     if (line.compare("") == 0)
       continue;
+    void *buffer = buffers[numOfTuples];
     char *a=new char[line.size()+1];
     a[line.size()] = 0;
     memcpy(a,line.c_str(),line.size());
@@ -1276,21 +1284,29 @@ RC CLI::load()
       if (keyIndex == attributes.size())
         keyIndex = 0;
     }
-    if (this->insertTupleToDB(tableName, attributes, buffer, indexMap) != 0) {
-      return error("error while inserting tuple");
-    }
-
     delete [] a;
+
+    // the tuples are inserted a batch at a time, so that the pages of the table are filled before they are written
+    if (++numOfTuples == LOAD_BATCH_SIZE) {
+      if (this->insertTuplesToDB(tableName, buffers, numOfTuples) != 0) {
+        return error("error while inserting tuples");
+      }
+      numOfTuples = 0;
+    }
     // prepare tuple for addition
     // for (std::vector<Attribute>::iterator it = attrs.begin() ; it != attrs.end(); ++it)
     // totalLength += it->length;
   }
+  if (numOfTuples > 0 && this->insertTuplesToDB(tableName, buffers, numOfTuples) != 0) {
+    return error("error while inserting tuples");
+  }
   // clear up indexMap
   for (auto it=indexMap.begin(); it != indexMap.end(); ++it) {
     free (it->second);
   }
 
-  free(buffer);
+  for (uint i = 0; i < LOAD_BATCH_SIZE; i++)
+    free(buffers[i]);
   free(key);
   ifs.close();
   return 0;
@@ -1406,6 +1422,17 @@ RC CLI::insertTupleToDB(const string tableName, const vector<Attribute> attribut
   return 0;
 }
 
+RC CLI::insertTuplesToDB(const string tableName, const vector<void *> &buffers, uint numOfTuples) {
+  vector<const void *> data(buffers.begin(), buffers.begin() + numOfTuples);
+  vector<RID> rids;
+
+  // insert the first numOfTuples buffers to given table
+  if (rm->insertTuples(tableName, data, rids) != 0)
+    return error("error CLI::load in rm->insertTuples");
+
+  return 0;
+}
+
 RC CLI::printAttributes()
 {
   char * tokenizer = next();
@@ -1466,6 +1493,56 @@ RC CLI::printIndex() {
   return this->printOutputBuffer(outputBuffer, 2);
 }
 
+// print the I/O latencies and volumes of every file opened so far
+RC CLI::printIOStats()
+{
+  vector<IOMetricsSnapshot> snapshots;
+  if (PagedFileManager::instance()->collectIOMetrics(snapshots) != 0)
+    return error ("error in collecting the I/O metrics");
+
+  vector<string> outputBuffer;
+  outputBuffer.push_back("File");
+  outputBuffer.push_back("Operation");
+  outputBuffer.push_back("Count");
+  outputBuffer.push_back("Avg(us)");
+  outputBuffer.push_back("P50(us)");
+  outputBuffer.push_back("P99(us)");
+  outputBuffer.push_back("Max(us)");
+  for (const IOMetricsSnapshot &snapshot : snapshots) {
+    for (uint operation = 0; operation < NUM_OF_IO_OPERATIONS; operation++) {
+      const LatencyHistogram &latencies = snapshot.latencies[operation];
+      if (latencies.count == 0)
+        continue;
+      outputBuffer.push_back(snapshot.fileName);
+      outputBuffer.push_back(getIOOperationName(operation));
+      outputBuffer.push_back(to_string(latencies.count));
+      outputBuffer.push_back(to_string(latencies.totalNanos / latencies.count / 1000.0));
+      outputBuffer.push_back(to_string(latencies.getPercentile(0.5) / 1000.0));
+      outputBuffer.push_back(to_string(latencies.getPercentile(0.99) / 1000.0));
+      outputBuffer.push_back(to_string(latencies.maxNanos / 1000.0));
+    }
+  }
+  RC rc = this->printOutputBuffer(outputBuffer, 7);
+  if (rc != 0)
+    return rc;
+  cout << endl;
+
+  outputBuffer.clear();
+  outputBuffer.push_back("File");
+  outputBuffer.push_back("BytesRead");
+  outputBuffer.push_back("BytesWritten");
+  outputBuffer.push_back("QueueDepth");
+  outputBuffer.push_back("MaxQueueDepth");
+  for (const IOMetricsSnapshot &snapshot : snapshots) {
+    outputBuffer.push_back(snapshot.fileName);
+    outputBuffer.push_back(to_string(snapshot.bytesRead));
+    outputBuffer.push_back(to_string(snapshot.bytesWritten));
+    outputBuffer.push_back(to_string(snapshot.queueDepth));
+    outputBuffer.push_back(to_string(snapshot.maxQueueDepth));
+  }
+  return this->printOutputBuffer(outputBuffer, 5);
+}
+
 // print every tuples in given tableName
 RC CLI::printTable(const string tableName)
 {
@@ -1536,6 +1613,7 @@ RC CLI::help(const string input)
     cout << "\tprint <tableName>: print every record in tableName" << endl;
     cout << "\tprint attributes <tableName>: print columns of given tableName" << endl;
     cout << "\tprint index <attributeName> on <tableName>: print columns of given tableName" << endl;
+    cout << "\tprint iostats: print the I/O latencies, bytes and queue depths of every file opened so far" << endl;
   }
   else if (input.compare("load") == 0) {
     cout << "\tload <tableName> \"fileName\"";
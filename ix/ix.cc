@@ -26,8 +26,8 @@ RC IndexManager::destroyFile(const string &fileName) {
     return pfm->destroyFile(fileName);
 }
 
-RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle) {
-    if (pfm->openFile(fileName, ixfileHandle.fileHandle) == FAIL) {
+RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle, unsigned openFlags) {
+    if (pfm->openFile(fileName, ixfileHandle.fileHandle, openFlags) == FAIL) {
         return FAIL;
     }
 
@@ -57,7 +57,7 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
         return FAIL;
     }
     if (isSplit) {
-        PageNum newRootNum = ixfileHandle.getNumberOfPages();
+        PageNum newRootNum;
         byte newRoot[PAGE_SIZE] = {0};
         unsigned keyLength = getKeyLength(attribute, newChildKey);
         memcpy(newRoot + NONLEAF_HEADER_SZ, &rootNum, NODE_PTR_SZ);
@@ -65,7 +65,10 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
         writeRid(newRoot, NONLEAF_HEADER_SZ + NODE_PTR_SZ + keyLength, newChildRid);
         memcpy(newRoot + NONLEAF_HEADER_SZ + NODE_PTR_SZ + keyLength + RID_SZ, &newChildNum, NODE_PTR_SZ);
         setFreeSpace(newRoot, PAGE_SIZE - NONLEAF_HEADER_SZ - 2 * NODE_PTR_SZ - keyLength - RID_SZ);
-        ixfileHandle.appendPage(newRoot);
+        if (ixfileHandle.allocatePage(newRoot, newRootNum) == FAIL) {
+            delete[] newChildKey;
+            return FAIL;
+        }
         setRoot(ixfileHandle, newRootNum);
     }
 
@@ -76,10 +79,14 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
 RC IndexManager::deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attribute, const void *key, const RID &rid) {
     PageNum nodeNum = getRoot(ixfileHandle);
     byte node[PAGE_SIZE];
+    vector<PageNum> path;
+    vector<unsigned> childNumOffsets;
     while (true) {
         ixfileHandle.readPage(nodeNum, node);
         if (!isLeaf(node)) {
             unsigned childNumOffset = findChildNumOffset(node, attribute, key, rid);
+            path.push_back(nodeNum);
+            childNumOffsets.push_back(childNumOffset);
             nodeNum = *((PageNum *) (node + childNumOffset));
         } else {
             unsigned freeBytes = getFreeSpace(node);
@@ -93,6 +100,9 @@ RC IndexManager::deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
                     unsigned entryLength = keyLength + RID_SZ;
                     memmove(node + offset, node + offset + entryLength, PAGE_SIZE - freeBytes - offset - entryLength);
                     setFreeSpace(node, freeBytes + entryLength);
+                    if (freeBytes + entryLength == MAX_LEAF_SPACE && !path.empty()) {
+                        return removeLeaf(ixfileHandle, attribute, nodeNum, node, path, childNumOffsets);
+                    }
                     ixfileHandle.writePage(nodeNum, node);
                     return SUCCESS;
                 }
@@ -104,6 +114,77 @@ RC IndexManager::deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
     }
 }
 
+RC IndexManager::removeLeaf(IXFileHandle &ixfileHandle, const Attribute &attribute, PageNum nodeNum, const byte *node,
+                            vector<PageNum> &path, vector<unsigned> &childNumOffsets) {
+    // unlink the leaf from its siblings
+    byte sibling[PAGE_SIZE];
+    if (hasPrev(node)) {
+        PageNum prevNum = getPrevNum(node);
+        ixfileHandle.readPage(prevNum, sibling);
+        if (hasNext(node)) {
+            setNextNum(sibling, getNextNum(node));
+        } else {
+            removeNext(sibling);
+        }
+        ixfileHandle.writePage(prevNum, sibling);
+    }
+    if (hasNext(node)) {
+        PageNum nextNum = getNextNum(node);
+        ixfileHandle.readPage(nextNum, sibling);
+        if (hasPrev(node)) {
+            setPrevNum(sibling, getPrevNum(node));
+        } else {
+            removePrev(sibling);
+        }
+        ixfileHandle.writePage(nextNum, sibling);
+    }
+    if (ixfileHandle.freePage(nodeNum) == FAIL) {
+        return FAIL;
+    }
+
+    // remove the pointer to the removed node from its parent
+    byte parent[PAGE_SIZE];
+    while (!path.empty()) {
+        PageNum parentNum = path.back();
+        unsigned childNumOffset = childNumOffsets.back();
+        path.pop_back();
+        childNumOffsets.pop_back();
+        ixfileHandle.readPage(parentNum, parent);
+        unsigned freeBytes = getFreeSpace(parent);
+        unsigned endOffset = PAGE_SIZE - freeBytes;
+
+        if (endOffset == NONLEAF_HEADER_SZ + NODE_PTR_SZ) {     // the removed node was the only child
+            if (path.empty()) {
+                memset(parent, 0, PAGE_SIZE);
+                setFreeSpace(parent, MAX_LEAF_SPACE);
+                setLeaf(parent);
+                return ixfileHandle.writePage(parentNum, parent);
+            }
+            if (ixfileHandle.freePage(parentNum) == FAIL) {
+                return FAIL;
+            }
+            continue;
+        }
+
+        // the first pointer is removed with the key after it, the others with the key before them
+        unsigned removedOffset = NONLEAF_HEADER_SZ;
+        unsigned removedLength;
+        if (childNumOffset == NONLEAF_HEADER_SZ) {
+            removedLength = NODE_PTR_SZ + getKeyLength(attribute, parent + NONLEAF_HEADER_SZ + NODE_PTR_SZ) + RID_SZ;
+        } else {
+            removedOffset += NODE_PTR_SZ;
+            while (removedOffset + getKeyLength(attribute, parent + removedOffset) + RID_SZ != childNumOffset) {
+                removedOffset += getKeyLength(attribute, parent + removedOffset) + RID_SZ + NODE_PTR_SZ;
+            }
+            removedLength = childNumOffset + NODE_PTR_SZ - removedOffset;
+        }
+        memmove(parent + removedOffset, parent + removedOffset + removedLength, endOffset - removedOffset - removedLength);
+        setFreeSpace(parent, freeBytes + removedLength);
+        return ixfileHandle.writePage(parentNum, parent);
+    }
+    return SUCCESS;
+}
+
 unsigned IndexManager::findFirstQualifiedEntry(const byte *node, const Attribute &attribute, const void *lowKey,
                                                const void *highKey, bool lowKeyInclusive, bool highKeyInclusive,
                                                bool &isQualifiedEntryExist) {
@@ -151,13 +232,16 @@ IndexManager::initializeScanIterator(IXFileHandle &ixfileHandle, const Attribute
         return;
     }
 
+    ix_ScanIterator.cancelPrefetch();
     ix_ScanIterator.isReady = true;
     ix_ScanIterator.ixFileHandle = ixfileHandle;
-    ixfileHandle.readPage(nodeNum, ix_ScanIterator.node);
+    ixfileHandle.readPage(nodeNum, ix_ScanIterator.nodeBuffers[0]);
+    ix_ScanIterator.node = ix_ScanIterator.nodeBuffers[0];
     ix_ScanIterator.offset = offset;
     ix_ScanIterator.highKey = highKey;
     ix_ScanIterator.highKeyInclusive = highKeyInclusive;
     ix_ScanIterator.attribute = attribute;
+    ix_ScanIterator.prefetchNextNode();
 }
 
 RC IndexManager::scan(IXFileHandle &ixfileHandle,
@@ -308,7 +392,6 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, PageNum nodeNum,
             assert((numOfMove <= MAX_LEAF_SPACE) && "The new data entry is too large!");
             memcpy(newChildKey, node + offset, keyLength);
             loadRid(node, offset + keyLength, newChildRid);
-            newChildNum = ixfileHandle.getNumberOfPages();
             memmove(node + PAGE_SIZE + LEAF_HEADER_SZ, node + offset, numOfMove);   // move entries to the new leaf page
             memset(node + PAGE_SIZE, 0, LEAF_HEADER_SZ);    // initialize leaf node header
             setLeaf(node + PAGE_SIZE);
@@ -316,18 +399,23 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, PageNum nodeNum,
             setFreeSpace(node, PAGE_SIZE - offset);
 
             // set previous and next page pointers
+            if (hasNext(node)) {
+                setNextNum(node + PAGE_SIZE, getNextNum(node));
+            }
+            setPrevNum(node + PAGE_SIZE, nodeNum);
+
+            // allocate the new leaf before linking it, so that a full file leaves the tree unchanged
+            if (ixfileHandle.allocatePage(node + PAGE_SIZE, newChildNum) == FAIL) {
+                return FAIL;
+            }
             if (hasNext(node)) {
                 PageNum nextNum = getNextNum(node);
-                setNextNum(node + PAGE_SIZE, nextNum);
                 byte nextNode[PAGE_SIZE];
                 ixfileHandle.readPage(nextNum, nextNode);
                 setPrevNum(nextNode, newChildNum);
                 ixfileHandle.writePage(nextNum, nextNode);
             }
-            setPrevNum(node + PAGE_SIZE, nodeNum);
             setNextNum(node, newChildNum);
-
-            ixfileHandle.appendPage(node + PAGE_SIZE);
             ixfileHandle.writePage(nodeNum, node);
             isSplit = true;
             return SUCCESS;
@@ -377,14 +465,15 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, PageNum nodeNum,
             assert((numOfMove <= MAX_NONLEAF_SPACE) && "The new index entry is too large!");
             memcpy(newChildKey, node + offset, keyLength);
             loadRid(node, offset + keyLength, newChildRid);
-            newChildNum = ixfileHandle.getNumberOfPages();
             setFreeSpace(node, PAGE_SIZE - offset);
             offset += keyLength + RID_SZ;
             memmove(node + PAGE_SIZE + NONLEAF_HEADER_SZ, node + offset, numOfMove);   // move entries to the new leaf page
             memset(node + PAGE_SIZE, 0, NONLEAF_HEADER_SZ);    // initialize non-leaf node header
             setFreeSpace(node + PAGE_SIZE, PAGE_SIZE - NONLEAF_HEADER_SZ - numOfMove);
 
-            ixfileHandle.appendPage(node + PAGE_SIZE);
+            if (ixfileHandle.allocatePage(node + PAGE_SIZE, newChildNum) == FAIL) {
+                return FAIL;
+            }
             ixfileHandle.writePage(nodeNum, node);
             isSplit = true;
             return SUCCESS;
@@ -518,15 +607,14 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
     unsigned freeSpace = indexManager->getFreeSpace(node);
     if (offset == PAGE_SIZE - freeSpace) {  //  all entries in current node have been scanned
         if (indexManager->hasNext(node)) {
-            PageNum nextNodeNum = indexManager->getNextNum(node);
-            ixFileHandle.readPage(nextNodeNum, node);
+            loadNextNode();
             offset = LEAF_HEADER_SZ;
         } else {    //  no more entries to scan
             return IX_EOF;
         }
     }
 
-    void *curKey = node + offset;
+    const void *curKey = node + offset;
     if (highKey != nullptr) {
         int cmp = indexManager->compareKey(attribute, curKey, highKey);
         if ((cmp == 0 && !highKeyInclusive) || (cmp > 0)) { //  current entry is not qualified
@@ -543,12 +631,57 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
 }
 
 RC IX_ScanIterator::close() {
+    cancelPrefetch();
     isReady = false;
     indexManager->closeFile(ixFileHandle);
     return SUCCESS;
 }
 
 
+void IX_ScanIterator::prefetchNextNode() {
+    if (!indexManager->hasNext(node)) {
+        return;
+    }
+    if (ixFileHandle.isMapped()) {
+        ixFileHandle.prefetchMappedPages(indexManager->getNextNum(node), 1);
+        return;
+    }
+    nextNodeRequest.pageNum = indexManager->getNextNum(node);
+    nextNodeRequest.data = (node == nodeBuffers[0]) ? nodeBuffers[1] : nodeBuffers[0];
+    nextNodeRequest.isWrite = false;
+    nextNodeVersion = ixFileHandle.getWriteVersion();
+    isPrefetching = true;
+    ixFileHandle.submitPages(&nextNodeRequest, 1);
+}
+
+void IX_ScanIterator::loadNextNode() {
+    PageNum nextNodeNum = indexManager->getNextNum(node);
+    byte *nextNode = (node == nodeBuffers[0]) ? nodeBuffers[1] : nodeBuffers[0];
+    const byte *mappedNode;
+    if (ixFileHandle.isMapped() && ixFileHandle.mapPage(nextNodeNum, mappedNode) == SUCCESS) {
+        // the mapping changes under the scan when an entry is deleted, so the leaf is scanned from a copy
+        memcpy(nextNode, mappedNode, PAGE_SIZE);
+        node = nextNode;
+        prefetchNextNode();
+        return;
+    }
+    bool isPrefetched = isPrefetching && nextNodeRequest.pageNum == nextNodeNum;
+    cancelPrefetch();
+    if (!isPrefetched || nextNodeRequest.result == FAIL || ixFileHandle.getWriteVersion() != nextNodeVersion) {
+        // the leaf chain or the next leaf may have been modified since the request
+        ixFileHandle.readPage(nextNodeNum, nextNode);
+    }
+    node = nextNode;
+    prefetchNextNode();
+}
+
+void IX_ScanIterator::cancelPrefetch() {
+    if (isPrefetching) {
+        ixFileHandle.waitPages(&nextNodeRequest, 1);
+        isPrefetching = false;
+    }
+}
+
 IXFileHandle::IXFileHandle() {
 }
 
@@ -559,3 +692,7 @@ RC IXFileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePa
     return fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
 }
 
+RC IXFileHandle::collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount) {
+    return fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+}
+
@@ -32,7 +32,7 @@ public:
     RC destroyFile(const string &fileName);
 
     // Open an index and return an ixfileHandle.
-    RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+    RC openFile(const string &fileName, IXFileHandle &ixfileHandle, unsigned openFlags = OPEN_DEFAULT);
 
     // Close an ixfileHandle for an index.
     RC closeFile(IXFileHandle &ixfileHandle);
@@ -78,6 +78,12 @@ private:
 
     RC insertDataEntry(byte *node, unsigned entryLength, const Attribute &attribute, const void *key, const RID &rid);
 
+    // Unlink the given empty leaf from its siblings and remove it from its parent (path holds the non-leaf nodes
+    // from the root, and childNumOffsets the offset of the pointer followed in each of them). A non-leaf node left
+    // without children is removed too, except the root, which becomes an empty leaf. Removed nodes are freed.
+    RC removeLeaf(IXFileHandle &ixfileHandle, const Attribute &attribute, PageNum nodeNum, const byte *node,
+                  vector<PageNum> &path, vector<unsigned> &childNumOffsets);
+
     // return the offset of the child pointer in a non-leaf node for the given composite key
     unsigned findChildNumOffset(const byte *node, const Attribute &attribute, const void *key, const RID &rid) const;
 
@@ -125,11 +131,15 @@ private:
 
     void setPrevNum(byte *node, PageNum prevNum);
 
+    void removePrev(byte *node);
+
     bool hasNext(const byte *node) const;
 
     PageNum getNextNum(const byte *node) const;
 
     void setNextNum(byte *node, PageNum nextNum);
+
+    void removeNext(byte *node);
 };
 
 inline
@@ -157,12 +167,12 @@ void IndexManager::writeRid(byte *node, unsigned offset, const RID &rid) {
 
 inline
 unsigned IndexManager::getFreeSpace(const byte *node) const {
-    return *((uint16_t *) node);
+    return *((PageOffset *) node);
 }
 
 inline
 void IndexManager::setFreeSpace(byte *node, unsigned freeBytes) {
-    *((uint16_t *) node) = freeBytes;
+    *((PageOffset *) node) = freeBytes;
 }
 
 inline
@@ -193,6 +203,11 @@ void IndexManager::setPrevNum(byte *node, PageNum prevNum) {
     *((PageNum *) (node + FREE_SPACE_SZ + LEAF_FLAG_SZ)) = prevNum;
 }
 
+inline
+void IndexManager::removePrev(byte *node) {
+    *((uint8_t *) (node + FREE_SPACE_SZ)) &= ~0x4;
+}
+
 inline
 bool IndexManager::hasNext(const byte *node) const {
     assert(isLeaf(node) && "This node is not a leaf node");
@@ -211,6 +226,11 @@ void IndexManager::setNextNum(byte *node, PageNum nextNum) {
     *((PageNum *) (node + FREE_SPACE_SZ + LEAF_FLAG_SZ + NODE_PTR_SZ)) = nextNum;
 }
 
+inline
+void IndexManager::removeNext(byte *node) {
+    *((uint8_t *) (node + FREE_SPACE_SZ)) &= ~0x2;
+}
+
 class IXFileHandle {
     friend class IndexManager;
 
@@ -233,6 +253,23 @@ public:
         return fileHandle.appendPage(data);
     }
 
+    // Write a new node into a freed page if there is one, otherwise append it
+    RC allocatePage(const void *data, PageNum &pageNum) {
+        return fileHandle.allocatePage(data, pageNum);
+    }
+
+    RC freePage(PageNum pageNum) {
+        return fileHandle.freePage(pageNum);
+    }
+
+    unsigned getNumberOfFreePages() {
+        return fileHandle.getNumberOfFreePages();
+    }
+
+    RC shrink() {
+        return fileHandle.shrink();
+    }
+
     unsigned getNumberOfPages() {
         return fileHandle.getNumberOfPages();
     }
@@ -240,6 +277,12 @@ public:
     // Put the current counter values of associated PF FileHandles into variables
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);
 
+    RC collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount);
+
+    RC collectBufferCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount) {
+        return fileHandle.collectBufferCounterValues(hitCount, missCount, evictionCount);
+    }
+
     RC readHeaderPage(void *data) {
         return fileHandle.readHeaderPage(data);
     }
@@ -248,6 +291,30 @@ public:
         return fileHandle.writeHeaderPage(data);
     }
 
+    RC submitPages(AsyncPageIO *requests, unsigned count) {
+        return fileHandle.submitPages(requests, count);
+    }
+
+    RC waitPages(AsyncPageIO *requests, unsigned count) {
+        return fileHandle.waitPages(requests, count);
+    }
+
+    uint64_t getWriteVersion() {
+        return fileHandle.getWriteVersion();
+    }
+
+    bool isMapped() {
+        return fileHandle.isMapped();
+    }
+
+    RC mapPage(PageNum pageNum, const byte *&page) {
+        return fileHandle.mapPage(pageNum, page);
+    }
+
+    RC prefetchMappedPages(PageNum startPageNum, unsigned count) {
+        return fileHandle.prefetchMappedPages(startPageNum, count);
+    }
+
 private:
     FileHandle fileHandle;
 };
@@ -272,11 +339,24 @@ private:
     IndexManager *indexManager = IndexManager::instance();
     bool isReady = false;
     IXFileHandle ixFileHandle;
-    byte node[PAGE_SIZE];
+    byte nodeBuffers[2][PAGE_SIZE];
+    const byte *node = nodeBuffers[0];  // the current leaf; the next leaf is read asynchronously into the other buffer
+                                        // (or copied from the mapping of the file)
+    AsyncPageIO nextNodeRequest;
+    uint64_t nextNodeVersion = 0;   // write version of the file when the next leaf was requested
+    bool isPrefetching = false;
     unsigned offset;
     const void *highKey;
     bool highKeyInclusive;
     Attribute attribute;
+
+    // Start reading the next leaf of the current one
+    void prefetchNextNode();
+
+    // Move to the next leaf, using the prefetched page if it is still valid
+    void loadNextNode();
+
+    void cancelPrefetch();
 };
 
 #endif
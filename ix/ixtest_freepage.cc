@@ -0,0 +1,133 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include "ix.h"
+#include "ix_test_util.h"
+
+IndexManager * indexManager;
+
+// Scan the whole index and return the number of entries, or -1 if the entries are not the expected ones
+int scanAll(IXFileHandle &ixfileHandle, const Attribute &attribute, unsigned numOfEntries)
+{
+    IX_ScanIterator ix_ScanIterator;
+    RID rid;
+    int key;
+    RC rc = indexManager->scan(ixfileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+
+    int count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+        if (key != count || rid.pageNum != (unsigned) count + 1 || rid.slotNum != (unsigned) count % 10) {
+            count = -1;
+            break;
+        }
+        count++;
+    }
+    ix_ScanIterator.close();
+    return (count == (int) numOfEntries) ? count : -1;
+}
+
+int testCase_freePage(const string &indexFileName, const Attribute &attribute)
+{
+    // Checks whether the nodes emptied by deleteEntry() are freed and reused by insertEntry()
+    cerr << endl << "***** In IX Test Case FreePage *****" << endl;
+
+    RID rid;
+    IXFileHandle ixfileHandle;
+    const unsigned numOfEntries = 30000;
+    PageNum numOfPages = 0;
+
+    // create index file
+    RC rc = indexManager->createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+
+    // open index file
+    rc = indexManager->openFile(indexFileName, ixfileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    for (unsigned round = 0; round < 2; round++) {
+        // insert entries
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            int key = i;
+            rid.pageNum = i + 1;
+            rid.slotNum = i % 10;
+            rc = indexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+            assert(rc == success && "indexManager::insertEntry() should not fail.");
+        }
+        if (scanAll(ixfileHandle, attribute, numOfEntries) == -1) {
+            cerr << "Wrong entries output after insertion...Failure" << endl;
+            goto error_close_index;
+        }
+
+        if (round == 0) {
+            numOfPages = ixfileHandle.getNumberOfPages();
+        } else if (ixfileHandle.getNumberOfPages() != numOfPages) {
+            cerr << "The freed nodes are not reused: " << ixfileHandle.getNumberOfPages() << " pages instead of "
+                 << numOfPages << " ...Failure" << endl;
+            goto error_close_index;
+        }
+
+        // delete all the entries, in an order which empties leaves in the middle of the tree first
+        for (unsigned i = 0; i < numOfEntries; i++) {
+            int key = (i * 7919) % numOfEntries;
+            rid.pageNum = key + 1;
+            rid.slotNum = key % 10;
+            rc = indexManager->deleteEntry(ixfileHandle, attribute, &key, rid);
+            assert(rc == success && "indexManager::deleteEntry() should not fail.");
+        }
+        if (scanAll(ixfileHandle, attribute, 0) == -1) {
+            cerr << "Entries are left after deleting all of them...Failure" << endl;
+            goto error_close_index;
+        }
+        if (ixfileHandle.getNumberOfFreePages() != numOfPages - 1) {
+            cerr << "Wrong number of free pages: " << ixfileHandle.getNumberOfFreePages() << " instead of "
+                 << numOfPages - 1 << " ...Failure" << endl;
+            goto error_close_index;
+        }
+
+        // the free pages are persisted
+        rc = indexManager->closeFile(ixfileHandle);
+        assert(rc == success && "indexManager::closeFile() should not fail.");
+        rc = indexManager->openFile(indexFileName, ixfileHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+    }
+
+    // Close index file
+    rc = indexManager->closeFile(ixfileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    // Destroy Index
+    rc = indexManager->destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    return success;
+
+error_close_index:
+    indexManager->closeFile(ixfileHandle);
+    indexManager->destroyFile(indexFileName);
+
+    return fail;
+}
+
+int main()
+{
+    indexManager = IndexManager::instance();
+    const string indexFileName = "freepage_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager->destroyFile("freepage_idx");
+
+    int rcmain = testCase_freePage(indexFileName, attrAge);
+    if (rcmain == success) {
+        cerr << "***** IX Test Case FreePage finished. The result will be examined. *****" << endl;
+        return success;
+    } else {
+        cerr << "***** [FAIL] IX Test Case FreePage failed. *****" << endl;
+        return fail;
+    }
+}
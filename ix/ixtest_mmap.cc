@@ -0,0 +1,116 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include "ix.h"
+#include "ix_test_util.h"
+
+IndexManager * indexManager;
+
+int testCase_mmap(const string &indexFileName, const Attribute &attribute)
+{
+    // Checks whether a scan of a mapped index returns every entry while the entries are deleted during the scan.
+    // The buffer pool holds one page, so every deletion is written back to the mapping under the scan.
+    cerr << endl << "***** In IX Test Case Mmap *****" << endl;
+
+    RID rid;
+    IXFileHandle ixfileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    const unsigned numOfEntries = 20000;
+    unsigned count = 0;
+    int key;
+
+    RC rc = PagedFileManager::instance()->setBufferPoolSize(1);
+    assert(rc == success && "PagedFileManager::setBufferPoolSize() should not fail.");
+
+    // create index file
+    rc = indexManager->createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+
+    // open index file
+    rc = indexManager->openFile(indexFileName, ixfileHandle, OPEN_MMAP);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    // insert entries
+    for (unsigned i = 0; i < numOfEntries; i++) {
+        key = i;
+        rid.pageNum = i + 1;
+        rid.slotNum = i % 10;
+        rc = indexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // scan all the entries, deleting each one after it is returned
+    rc = indexManager->scan(ixfileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+        if (key != (int) count || rid.pageNum != count + 1 || rid.slotNum != count % 10) {
+            cerr << "Wrong entry returned: " << key << " instead of " << count << " ...Failure" << endl;
+            goto error_close_scan;
+        }
+        rc = indexManager->deleteEntry(ixfileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::deleteEntry() should not fail.");
+        count++;
+    }
+    rc = ix_ScanIterator.close();
+    assert(rc == success && "IX_ScanIterator::close() should not fail.");
+    if (count != numOfEntries) {
+        cerr << "Wrong number of entries returned: " << count << " instead of " << numOfEntries << " ...Failure"
+             << endl;
+        goto error_close_index;
+    }
+
+    // no entry is left
+    rc = indexManager->scan(ixfileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    if (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+        cerr << "Entries are left after deleting all of them...Failure" << endl;
+        goto error_close_scan;
+    }
+    rc = ix_ScanIterator.close();
+    assert(rc == success && "IX_ScanIterator::close() should not fail.");
+
+    // Close index file
+    rc = indexManager->closeFile(ixfileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    // Destroy Index
+    rc = indexManager->destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    rc = PagedFileManager::instance()->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "PagedFileManager::setBufferPoolSize() should not fail.");
+
+    return success;
+
+error_close_scan:
+    ix_ScanIterator.close();
+
+error_close_index:
+    indexManager->closeFile(ixfileHandle);
+    indexManager->destroyFile(indexFileName);
+
+    return fail;
+}
+
+int main()
+{
+    indexManager = IndexManager::instance();
+    const string indexFileName = "mmap_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager->destroyFile("mmap_idx");
+
+    int rcmain = testCase_mmap(indexFileName, attrAge);
+    if (rcmain == success) {
+        cerr << "***** IX Test Case Mmap finished. The result will be examined. *****" << endl;
+        return success;
+    } else {
+        cerr << "***** [FAIL] IX Test Case Mmap failed. *****" << endl;
+        return fail;
+    }
+}
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "ix.h"
+#include "ix_test_util.h"
+
+IndexManager * indexManager;
+
+// Wide varchar keys in insertion order, so that each node holds only a few entries
+void prepareScaleKey(const Attribute &attribute, unsigned i, char *key)
+{
+    *(int*)key = attribute.length;
+    memset(key + 4, 'k', attribute.length);
+    char digits[16];
+    sprintf(digits, "%010u", i);
+    memcpy(key + 4, digits, 10);
+}
+
+int testCase_scale(const string &indexFileName, const Attribute &attribute)
+{
+    // Checks whether an index can grow beyond 4 GB
+    // (needs about 5 GB of free disk space).
+    cerr << endl << "***** In IX Test Case Scale *****" << endl;
+
+    RID rid;
+    IXFileHandle ixfileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    char key[PAGE_SIZE];
+    char returnedKey[PAGE_SIZE];
+    const PageNum boundaryNumOfPages = (PageNum) ((1ULL << 32) / PAGE_SIZE);
+    const PageNum ridPageNumBase = 3000000000U;     // RIDs point to pages beyond 4 GB of a heap file too
+    unsigned numOfEntries = 0;
+    unsigned count = 0;
+    uint64_t readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+    struct stat fileStat;
+
+    // create index file
+    RC rc = indexManager->createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+
+    // open index file
+    rc = indexManager->openFile(indexFileName, ixfileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    // insert entries until the index is larger than 4 GB
+    while (ixfileHandle.getNumberOfPages() <= boundaryNumOfPages + 1000) {
+        prepareScaleKey(attribute, numOfEntries, key);
+        rid.pageNum = ridPageNumBase + numOfEntries;
+        rid.slotNum = numOfEntries % PAGE_SIZE;
+
+        rc = indexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+        numOfEntries++;
+    }
+
+    // close and reopen the index file
+    rc = indexManager->closeFile(ixfileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    if (stat(indexFileName.c_str(), &fileStat) != 0 || (uint64_t) fileStat.st_size <= (1ULL << 32)) {
+        cerr << "The index file is not larger than 4 GB...Failure" << endl;
+        goto error_destroy_index;
+    }
+
+    rc = indexManager->openFile(indexFileName, ixfileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    rc = ixfileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "indexManager::collectCounterValues() should not fail.");
+
+    if (appendPageCount != ixfileHandle.getNumberOfPages() || readPageCount < numOfEntries) {
+        cerr << "Wrong counter values after reopening the index...Failure" << endl;
+        goto error_close_index;
+    }
+
+    // scan the entries around the first and the last leaves
+    for (unsigned lowNum = 0; lowNum < numOfEntries; lowNum += numOfEntries - 1000) {
+        char lowKey[PAGE_SIZE];
+        char highKey[PAGE_SIZE];
+        prepareScaleKey(attribute, lowNum, lowKey);
+        prepareScaleKey(attribute, lowNum + 999, highKey);
+
+        rc = indexManager->scan(ixfileHandle, attribute, lowKey, highKey, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &returnedKey) != IX_EOF) {
+            prepareScaleKey(attribute, lowNum + count, key);
+            if (rid.pageNum != ridPageNumBase + lowNum + count || rid.slotNum != (lowNum + count) % PAGE_SIZE
+                || memcmp(key, returnedKey, attribute.length + 4) != 0) {
+                cerr << "Wrong entries output...Failure" << endl;
+                ix_ScanIterator.close();
+                goto error_close_index;
+            }
+            count++;
+        }
+        if (count != 1000) {
+            cerr << "Wrong output count! expected: 1000, actual: " << count << " ...Failure" << endl;
+            ix_ScanIterator.close();
+            goto error_close_index;
+        }
+
+        rc = ix_ScanIterator.close();
+        assert(rc == success && "IX_ScanIterator::close() should not fail.");
+    }
+
+    // Close index file
+    rc = indexManager->closeFile(ixfileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    // Destroy Index
+    rc = indexManager->destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    return success;
+
+error_close_index:
+    indexManager->closeFile(ixfileHandle);
+error_destroy_index:
+    indexManager->destroyFile(indexFileName);
+
+    return fail;
+}
+
+int main()
+{
+    indexManager = IndexManager::instance();
+    const string indexFileName = "scale_idx";
+    Attribute attrName;
+    attrName.length = 1200;
+    attrName.name = "Name";
+    attrName.type = TypeVarChar;
+
+    indexManager->destroyFile("scale_idx");
+
+    int rcmain = testCase_scale(indexFileName, attrName);
+    if (rcmain == success) {
+        cerr << "***** IX Test Case Scale finished. The result will be examined. *****" << endl;
+        return success;
+    } else {
+        cerr << "***** [FAIL] IX Test Case Scale failed. *****" << endl;
+        return fail;
+    }
+}
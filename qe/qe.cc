@@ -109,8 +109,8 @@ Project::Project(Iterator *input, const vector<string> &attrNames) : iter(input)
 };
 
 RC Project::getNextTuple(void *data) {
-    void *originalData = malloc(PAGE_SIZE);
-    void *attributeData = malloc(PAGE_SIZE);
+    void *originalData = originalTuple.get();
+    void *attributeData = attributeValue.get();
     if (iter->getNextTuple(originalData) == QE_EOF) { return FAIL; }
 
     prepareNullsIndicator(data);
@@ -137,8 +137,6 @@ RC Project::getNextTuple(void *data) {
         }
     }
 
-    free(originalData);
-    free(attributeData);
     return SUCCESS;
 };
 
@@ -175,7 +173,7 @@ void Project::prepareNullsIndicator(void *data) {
 BNLJoin::BNLJoin(Iterator *leftIn, TableScan *rightIn, const Condition &condition, const unsigned numPages)
         : leftIn(leftIn), rightIn(rightIn), condition(condition), numOfBufferPages(numPages) {
     assert(condition.op == EQ_OP);  // should be equijoin
-    leftBuffer = new byte[numPages * PAGE_SIZE];
+    leftBuffer = PageArena::instance().allocate(numPages * PAGE_SIZE);
     leftIn->getAttributes(leftAttrs);
     rightIn->getAttributes(rightAttrs);
 //    rightIn->setIterator();
@@ -212,7 +210,7 @@ BNLJoin::BNLJoin(Iterator *leftIn, TableScan *rightIn, const Condition &conditio
 }
 
 BNLJoin::~BNLJoin() {
-    delete[] leftBuffer;
+    PageArena::instance().release(leftBuffer, numOfBufferPages * PAGE_SIZE);
     switch (attrType) {
         case TypeInt:
             delete (unordered_map<int32_t, vector<unsigned>> *) hashTable;
@@ -454,7 +452,8 @@ RC GHJoin::getNextTuple(void *data) {
             if (numOfLeftPages == 0) {
                 continue;
             }
-            leftBuffer = new byte[numOfLeftPages * PAGE_SIZE];
+            leftBufferCapacity = numOfLeftPages * PAGE_SIZE;
+            leftBuffer = PageArena::instance().allocate(leftBufferCapacity);
             RID rid;
             while (leftIterator.getNextRecord(rid, leftBuffer + leftBufferSize) != RBFM_EOF) {
                 unsigned leftTupleLength = computeTupleLength(leftAttrs, leftBuffer + leftBufferSize);
@@ -466,7 +465,7 @@ RC GHJoin::getNextTuple(void *data) {
             leftIterator.close();   // the leftIterator will never be used again
 
             if (leftBufferSize == 0) {
-                delete[] leftBuffer;
+                PageArena::instance().release(leftBuffer, leftBufferCapacity);
                 continue;
             }
             FileHandle rightFileHandle;
@@ -492,7 +491,7 @@ RC GHJoin::getNextTuple(void *data) {
         }
 
         rightIterator.close();  // the rightIterator will never be used again
-        delete[] leftBuffer;
+        PageArena::instance().release(leftBuffer, leftBufferCapacity);
         leftBufferSize = 0;
         clearHashTable(hashTable, attrType);
     }
@@ -553,9 +552,11 @@ RC Aggregate::getNextTuple(void *data) {
 }
 
 RC Aggregate::getNextUngroupedTuple(void *data) {
-    float *aggAttrValuePtr = new float;
+    float aggAttrValueBuffer;
+    float *aggAttrValuePtr = &aggAttrValueBuffer;
     float aggAttrValue;
-    void *originalData = malloc(PAGE_SIZE);
+    PageBuffer originalTuple;
+    void *originalData = originalTuple.get();
 
     if (reachEOF) {
         return QE_EOF;
@@ -572,16 +573,17 @@ RC Aggregate::getNextUngroupedTuple(void *data) {
     prepareUngroupedTuple(data);
     reachEOF = true;
 
-    free(originalData);
-    delete (aggAttrValuePtr);
     return SUCCESS;
 }
 
 RC Aggregate::getNextGroupedTuple(void *data) {
-    float *aggAttrValuePtr = new float;
-    void *groupAttrValuePtr = malloc(PAGE_SIZE);
+    float aggAttrValueBuffer;
+    float *aggAttrValuePtr = &aggAttrValueBuffer;
+    PageBuffer groupAttrValue;
+    void *groupAttrValuePtr = groupAttrValue.get();
     float aggAttrValue;
-    void *originalData = malloc(PAGE_SIZE);
+    PageBuffer originalTuple;
+    void *originalData = originalTuple.get();
     AggregateInfo aggInfoToBeAdded;
 
     if (reachEOF) {
@@ -607,9 +609,6 @@ RC Aggregate::getNextGroupedTuple(void *data) {
     prepareNextKeyValueFromGroupMap(groupAttrValuePtr, aggregateInfo);
     prepareGroupedTuple(groupAttrValuePtr, data);
 
-    free(originalData);
-    free(groupAttrValuePtr);
-    delete (aggAttrValuePtr);
     return SUCCESS;
 }
 
@@ -245,6 +245,8 @@ private:
     vector<Attribute> attrs;
     vector<Attribute> originalAttrs;
     unordered_map<string, Attribute> nameAttributeMap;
+    PageBuffer originalTuple;       // tuple from the input, reused for every call
+    PageBuffer attributeValue;
 
     void prepareNameAttributeMap(const vector<Attribute> attrs);
 
@@ -364,6 +366,7 @@ private:
     RBFM_ScanIterator leftIterator;
     RBFM_ScanIterator rightIterator;
     byte *leftBuffer = nullptr;     // memory buffer for tuples from left relation
+    size_t leftBufferCapacity = 0;  // size of the memory buffer, drawn from the page arena
     unsigned leftBufferSize = 0;    // size of tuples in leftBuffer
     void *hashTable = nullptr;
     vector<unsigned> leftOffsets;
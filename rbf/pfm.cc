@@ -1,22 +1,55 @@
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <cerrno>
+#include <cstdint>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <unordered_set>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include "pfm.h"
 using namespace std;
 
 PagedFileManager* PagedFileManager::_pf_manager = nullptr;
 
+static RC getFileId(const string &fileName, FileId &fileId)
+{
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        return FAIL;
+    }
+    fileId.device = fileStat.st_dev;
+    fileId.inode = fileStat.st_ino;
+    return SUCCESS;
+}
+
+static void flushBufferPoolAtExit()
+{
+    PagedFileManager::instance()->flushAllPages();
+    PagedFileManager::instance()->saveHotPageLists();
+}
+
 PagedFileManager* PagedFileManager::instance()
 {
-    if(!_pf_manager)
+    if(!_pf_manager) {
         _pf_manager = new PagedFileManager();
+        atexit(flushBufferPoolAtExit);    // dirty pages of files that are never closed should not be lost
+    }
 
     return _pf_manager;
 }
 
 
-PagedFileManager::PagedFileManager()
+PagedFileManager::PagedFileManager(): bufferPool(DEFAULT_NUM_OF_FRAMES)
 {
 }
 
@@ -25,7 +58,17 @@ PagedFileManager::~PagedFileManager()
 {
 }
 
-RC PagedFileManager::createFile(const string &fileName)
+// Return true if the header page of the file has the given creation flag
+static bool hasCreateFlag(const string &fileName, int createFlagsOffset, unsigned createFlag)
+{
+    ifstream file(fileName, fstream::in | fstream::binary);
+    uint32_t createFlags = 0;
+    file.seekg(createFlagsOffset);
+    file.read((char*) &createFlags, sizeof(createFlags));
+    return file && (createFlags & createFlag) != 0;
+}
+
+RC PagedFileManager::createFile(const string &fileName, unsigned createFlags)
 {
     struct stat fileStat;
     if (stat(fileName.c_str(), &fileStat) == 0) {
@@ -37,20 +80,174 @@ RC PagedFileManager::createFile(const string &fileName)
     ofstream file(fileName, fstream::out | fstream::binary);
     byte header[PAGE_SIZE] = {0};
     header[0] = FILE_ID;   // first byte of the header page is a fingerprint for identifying files created by this function
+    *((uint32_t*) (header + FileHandle::PAGE_SIZE_OFFSET)) = PAGE_SIZE;
+    *((uint32_t*) (header + FileHandle::CREATE_FLAGS_OFFSET)) = createFlags;
     file.write(header, PAGE_SIZE);
-    return (file) ? SUCCESS : (destroyFile(fileName), FAIL);
+    file.close();
+    bool isCreated = (bool) file;
+    remove(CompressedPageMap::getMapFileName(fileName).c_str());
+    if (isCreated && (createFlags & CREATE_COMPRESSED)) {
+        ofstream mapFile(CompressedPageMap::getMapFileName(fileName), fstream::out | fstream::binary);
+        isCreated = (bool) mapFile;
+    }
+    if (!isCreated) {
+        destroyFile(fileName);
+        return FAIL;
+    }
+
+    // the inode of a destroyed file may be reused, so drop any page cached or logged under the same identity
+    FileId fileId;
+    if (getFileId(fileName, fileId) == SUCCESS) {
+        forgetFile(fileId);
+    }
+    remove(WriteAheadLog::getLogFileName(fileName).c_str());
+    remove(HotPageList::getListFileName(fileName).c_str());
+    return SUCCESS;
 }
 
 
 RC PagedFileManager::destroyFile(const string &fileName)
 {
+    FileId fileId;
+    if (getFileId(fileName, fileId) == SUCCESS) {
+        forgetFile(fileId);
+    }
+    remove(WriteAheadLog::getLogFileName(fileName).c_str());
+    remove(CompressedPageMap::getMapFileName(fileName).c_str());
+    remove(HotPageList::getListFileName(fileName).c_str());
     return (remove(fileName.c_str()) == 0) ? SUCCESS : FAIL;
 }
 
 
-RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+void PagedFileManager::forgetFile(const FileId &fileId)
+{
+    bufferPool.discardFile(fileId);
+    {
+        lock_guard<mutex> lock(logsMutex);
+        logs.erase(fileId);
+    }
+    {
+        lock_guard<mutex> lock(pageMapsMutex);
+        pageMaps.erase(fileId);
+    }
+    {
+        lock_guard<mutex> lock(metricsMutex);
+        ioMetrics.erase(fileId);
+    }
+    {
+        lock_guard<mutex> lock(hotPagesMutex);
+        hotPageLists.erase(fileId);
+    }
+    lock_guard<mutex> lock(openFilesMutex);
+    openFiles.erase(fileId);
+}
+
+
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle, unsigned openFlags)
 {
-    return fileHandle.openFile(fileName);
+    FileId fileId;
+    if (getFileId(fileName, fileId) == FAIL) {
+        return FAIL;
+    }
+
+    // compressed pages have no fixed place in the file, so they can be neither mapped, transferred with direct I/O
+    // nor replayed from a log
+    shared_ptr<CompressedPageMap> pageMap;
+    {
+        lock_guard<mutex> lock(pageMapsMutex);
+        auto it = pageMaps.find(fileId);
+        if (it != pageMaps.end()) {
+            pageMap = it->second;
+        } else if (hasCreateFlag(fileName, FileHandle::CREATE_FLAGS_OFFSET, CREATE_COMPRESSED)) {
+            pageMap = make_shared<CompressedPageMap>();
+            if (pageMap->open(fileName) == FAIL) {
+                return FAIL;
+            }
+            pageMaps[fileId] = pageMap;
+        }
+    }
+    if (pageMap && (openFlags & (OPEN_DIRECT_IO | OPEN_MMAP | OPEN_WAL))) {
+        return FAIL;
+    }
+
+    shared_ptr<FileIOMetrics> metrics;
+    {
+        lock_guard<mutex> lock(metricsMutex);
+        shared_ptr<FileIOMetrics> &fileMetrics = ioMetrics[fileId];
+        if (!fileMetrics) {
+            fileMetrics = make_shared<FileIOMetrics>(fileName);
+        }
+        metrics = fileMetrics;
+    }
+
+    // the first open of a file after a crash replays its log; a file stays logged once a handle asks for it
+    shared_ptr<WriteAheadLog> wal;
+    {
+        lock_guard<mutex> lock(logsMutex);
+        auto it = logs.find(fileId);
+        if (it != logs.end()) {
+            wal = it->second;
+        } else if ((openFlags & OPEN_WAL) || WriteAheadLog::hasRecords(fileName)) {
+            wal = make_shared<WriteAheadLog>();
+            if (wal->open(fileName, metrics) == FAIL) {
+                return FAIL;
+            }
+            bufferPool.discardFile(fileId);     // the file has been changed behind the cached pages
+            if (openFlags & OPEN_WAL) {
+                logs[fileId] = wal;
+            } else {
+                wal.reset();
+            }
+        }
+    }
+
+    // the first open of a file in this process prefetches the pages which were hot in the last one
+    shared_ptr<HotPageList> hotPages;
+    vector<PageNum> prefetchedPageNums;
+    {
+        lock_guard<mutex> lock(hotPagesMutex);
+        shared_ptr<HotPageList> &fileHotPages = hotPageLists[fileId];
+        if (!fileHotPages) {
+            fileHotPages = make_shared<HotPageList>(fileName);
+            fileHotPages->load(prefetchedPageNums);
+        }
+        hotPages = fileHotPages;
+    }
+
+    if (fileHandle.openFile(fileName, openFlags, pageMap, metrics) == FAIL) {
+        return FAIL;
+    }
+    fileHandle.wal = wal;
+    fileHandle.hotPages = hotPages;
+    if (!prefetchedPageNums.empty() && !fileHandle.isDirectIO()) {
+        vector<PageNum> filePageNums;
+        for (PageNum pageNum : prefetchedPageNums) {
+            if (pageNum < fileHandle.getNumberOfPages()) {
+                filePageNums.push_back(pageNum + 1);
+            }
+        }
+        sort(filePageNums.begin(), filePageNums.end());
+        fileHandle.file->adviseFilePages(filePageNums, POSIX_FADV_WILLNEED);
+    }
+
+    // the header page read by the handle is stale if another handle of the file is open
+    lock_guard<mutex> lock(openFilesMutex);
+    SharedFileState &state = openFiles[fileId];
+    shared_ptr<atomic<PageNum>> numOfPages = state.numOfPages.lock();
+    shared_ptr<FreePageList> freePages = state.freePages.lock();
+    if (numOfPages && freePages) {
+        fileHandle.numOfPages = numOfPages;
+        fileHandle.freePages = freePages;
+    } else {
+        // no other handle has changed the list since the header page was written
+        if (fileHandle.loadFreePages() == FAIL) {
+            fileHandle.file->close();
+            return FAIL;
+        }
+        state.numOfPages = fileHandle.numOfPages;
+        state.freePages = fileHandle.freePages;
+    }
+    return SUCCESS;
 }
 
 
@@ -60,121 +257,2717 @@ RC PagedFileManager::closeFile(FileHandle &fileHandle)
 }
 
 
-FileHandle::FileHandle()
+RC PagedFileManager::setBufferPoolSize(unsigned numOfFrames)
 {
+    return bufferPool.resize(numOfFrames);
 }
 
 
-FileHandle::~FileHandle()
+RC PagedFileManager::shrinkFile(const string &fileName)
 {
-    closeFile();
+    FileHandle fileHandle;
+    if (openFile(fileName, fileHandle) == FAIL) {
+        return FAIL;
+    }
+    RC rc = fileHandle.shrink();
+    return (closeFile(fileHandle) == SUCCESS) ? rc : FAIL;
 }
 
-RC FileHandle::openFile(const string &fileName)
+
+RC PagedFileManager::collectIOMetrics(vector<IOMetricsSnapshot> &snapshots)
 {
-    if (file->is_open()) {
-        return FAIL;
+    lock_guard<mutex> lock(metricsMutex);
+    snapshots.clear();
+    snapshots.resize(ioMetrics.size());
+    unsigned i = 0;
+    for (auto &metrics : ioMetrics) {
+        metrics.second->collect(snapshots[i++]);
+    }
+    sort(snapshots.begin(), snapshots.end(), [](const IOMetricsSnapshot &a, const IOMetricsSnapshot &b) {
+        return a.fileName < b.fileName;
+    });
+    return SUCCESS;
+}
+
+
+RC PagedFileManager::saveHotPageLists()
+{
+    lock_guard<mutex> lock(hotPagesMutex);
+    RC rc = SUCCESS;
+    for (auto &hotPages : hotPageLists) {
+        if (hotPages.second->save(1) == FAIL) {
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+
+void PagedFileManager::resetIOMetrics()
+{
+    lock_guard<mutex> lock(metricsMutex);
+    for (auto &metrics : ioMetrics) {
+        metrics.second->reset();
     }
-    file->open(fileName, fstream::in | fstream::out | fstream::binary);
-    if (!file->is_open()) {
+}
+
+
+RC PagedFileManager::flushAllPages()
+{
+    if (bufferPool.flushAll() == FAIL) {
         return FAIL;
     }
-    byte header[PAGE_SIZE];
-    file->read(header, PAGE_SIZE);
-    if (!file || header[0] != FILE_ID) {
-        file->close();
+
+    RC rc = SUCCESS;
+    {
+        lock_guard<mutex> lock(pageMapsMutex);
+        for (auto &pageMap : pageMaps) {
+            if (pageMap.second->flush() == FAIL) {
+                rc = FAIL;
+            }
+        }
+    }
+
+    // the pages are on disk now, so the logs can be emptied
+    lock_guard<mutex> lock(logsMutex);
+    for (auto &log : logs) {
+        if (log.second->checkpoint(bufferPool, log.first) == FAIL) {
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+
+static unique_ptr<AsyncIOEngine> createAsyncIOEngine(unsigned engineType);
+
+RC PagedFileManager::setAsyncIOEngine(unsigned engineType)
+{
+    unique_ptr<AsyncIOEngine> engine = createAsyncIOEngine(engineType);
+    if (!engine) {
         return FAIL;
     }
-    *readPageCounter = *((unsigned*) (header + RD_OFFSET));
-    *writePageCounter = *((unsigned*) (header + WR_OFFSET));
-    *appendPageCounter = *((unsigned*) (header + APP_OFFSET));
-    *numOfPages = *((unsigned*) (header + NUM_OF_PAGES_OFFSET));
+    lock_guard<mutex> lock(engineMutex);
+    asyncIOEngine = move(engine);
     return SUCCESS;
 }
 
 
-RC FileHandle::closeFile()
+unsigned PagedFileManager::getAsyncIOEngineType()
 {
-    if (!file->is_open()) {
-        return FAIL;
+    return getAsyncIOEngine()->getType();
+}
+
+
+AsyncIOEngine* PagedFileManager::getAsyncIOEngine()
+{
+    lock_guard<mutex> lock(engineMutex);
+    if (!asyncIOEngine) {
+        asyncIOEngine = createAsyncIOEngine(ASYNC_IO_AUTO);
+    }
+    return asyncIOEngine.get();
+}
+
+
+byte* allocateAlignedBuffer(size_t size)
+{
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, size) != 0) {
+        throw bad_alloc();
     }
+    return (byte*) buffer;
+}
 
-    // update the header page
-    file->seekg(0, fstream::beg);
-    byte header[PAGE_SIZE];
-    file->read(header, PAGE_SIZE);
-    memcpy(header + RD_OFFSET, readPageCounter.get(), sizeof(unsigned));
-    memcpy(header + WR_OFFSET, writePageCounter.get(), sizeof(unsigned));
-    memcpy(header + APP_OFFSET, appendPageCounter.get(), sizeof(unsigned));
-    memcpy(header + NUM_OF_PAGES_OFFSET, numOfPages.get(), sizeof(unsigned));
-    file->seekp(0, fstream::beg);
-    file->write(header, PAGE_SIZE);
-    if (!file) {
+
+PageArena& PageArena::instance()
+{
+    static PageArena arena;
+    return arena;
+}
+
+unsigned PageArena::getSizeClass(size_t size)
+{
+    unsigned sizeClass = 0;
+    while (sizeClass < NUM_OF_SIZE_CLASSES && ((size_t) PAGE_SIZE << sizeClass) < size) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+byte* PageArena::mapChunks(size_t size, bool &isHugeTLB)
+{
+    isHugeTLB = false;
+    if (isHugeTLBAvailable) {
+        void *chunk = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (chunk != MAP_FAILED) {
+            mappedBytes += size;
+            hugeTLBBytes += size;
+            isHugeTLB = true;
+            return (byte*) chunk;
+        }
+        isHugeTLBAvailable = false;     // no huge page is reserved, so do not ask again
+    }
+
+    // map one chunk more than needed and trim it, so that the chunks are aligned to huge pages
+    byte *mapping = (byte*) mmap(nullptr, size + ARENA_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == (byte*) MAP_FAILED) {
+        return nullptr;
+    }
+    size_t head = (ARENA_CHUNK_SIZE - (uintptr_t) mapping % ARENA_CHUNK_SIZE) % ARENA_CHUNK_SIZE;
+    if (head > 0) {
+        munmap(mapping, head);
+    }
+    munmap(mapping + head + size, ARENA_CHUNK_SIZE - head);
+    byte *chunk = mapping + head;
+    madvise(chunk, size, MADV_HUGEPAGE);    // best effort: transparent huge pages may be disabled
+    mappedBytes += size;
+    return chunk;
+}
+
+byte* PageArena::allocate(size_t size)
+{
+    unsigned sizeClass = getSizeClass(size);
+    lock_guard<mutex> lock(arenaMutex);
+    ++allocationCount;
+
+    bool isHugeTLB;
+    if (sizeClass == NUM_OF_SIZE_CLASSES) {
+        byte *buffer = mapChunks((size + ARENA_CHUNK_SIZE - 1) / ARENA_CHUNK_SIZE * ARENA_CHUNK_SIZE, isHugeTLB);
+        if (buffer == nullptr) {
+            throw bad_alloc();
+        }
+        if (isHugeTLB) {
+            hugeTLBMappings.insert(buffer);
+        }
+        return buffer;
+    }
+
+    if (freeLists[sizeClass] != nullptr) {
+        byte *buffer = freeLists[sizeClass];
+        freeLists[sizeClass] = *((byte**) buffer);
+        ++reuseCount;
+        return buffer;
+    }
+
+    size_t classSize = (size_t) PAGE_SIZE << sizeClass;
+    if (chunkRemaining < classSize) {
+        // the rest of the chunk goes to the free lists, in pieces of decreasing size
+        while (chunkRemaining > 0) {
+            unsigned pieceClass = getSizeClass(chunkRemaining + 1) - 1;
+            size_t pieceSize = (size_t) PAGE_SIZE << pieceClass;
+            *((byte**) chunkCursor) = freeLists[pieceClass];
+            freeLists[pieceClass] = chunkCursor;
+            chunkCursor += pieceSize;
+            chunkRemaining -= pieceSize;
+        }
+        chunkCursor = mapChunks(ARENA_CHUNK_SIZE, isHugeTLB);
+        if (chunkCursor == nullptr) {
+            throw bad_alloc();
+        }
+        chunkRemaining = ARENA_CHUNK_SIZE;
+    }
+    byte *buffer = chunkCursor;
+    chunkCursor += classSize;
+    chunkRemaining -= classSize;
+    return buffer;
+}
+
+void PageArena::release(byte *buffer, size_t size)
+{
+    if (buffer == nullptr) {
+        return;
+    }
+    unsigned sizeClass = getSizeClass(size);
+    lock_guard<mutex> lock(arenaMutex);
+
+    if (sizeClass == NUM_OF_SIZE_CLASSES) {
+        size_t mappingSize = (size + ARENA_CHUNK_SIZE - 1) / ARENA_CHUNK_SIZE * ARENA_CHUNK_SIZE;
+        munmap(buffer, mappingSize);
+        mappedBytes -= mappingSize;
+        if (hugeTLBMappings.erase(buffer) > 0) {
+            hugeTLBBytes -= mappingSize;
+        }
+        return;
+    }
+    *((byte**) buffer) = freeLists[sizeClass];
+    freeLists[sizeClass] = buffer;
+}
+
+void PageArena::collectCounterValues(uint64_t &mappedBytes, uint64_t &hugeTLBBytes, uint64_t &allocationCount,
+                                     uint64_t &reuseCount)
+{
+    lock_guard<mutex> lock(arenaMutex);
+    mappedBytes = this->mappedBytes;
+    hugeTLBBytes = this->hugeTLBBytes;
+    allocationCount = this->allocationCount;
+    reuseCount = this->reuseCount;
+}
+
+
+static uint64_t getMonotonicNanos()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records the latency of an operation in the metrics (if any) when it goes out of scope
+class IOTimer
+{
+public:
+    IOTimer(FileIOMetrics *metrics, IOOperation operation)
+        : metrics(metrics), operation(operation), beginNanos(metrics ? getMonotonicNanos() : 0)
+    {
+    }
+
+    ~IOTimer()
+    {
+        if (metrics) {
+            metrics->recordLatency(operation, getMonotonicNanos() - beginNanos);
+        }
+    }
+
+private:
+    FileIOMetrics *metrics;
+    IOOperation operation;
+    uint64_t beginNanos;
+};
+
+const char* getIOOperationName(unsigned operation)
+{
+    static const char *names[NUM_OF_IO_OPERATIONS] = {"readPage", "writePage", "appendPage", "diskRead",
+                                                      "diskWrite", "sync"};
+    return (operation < NUM_OF_IO_OPERATIONS) ? names[operation] : "unknown";
+}
+
+uint64_t LatencyHistogram::getPercentile(double fraction) const
+{
+    uint64_t rank = (uint64_t) (fraction * count + 0.5);
+    uint64_t numOfOperations = 0;
+    for (unsigned bucket = 0; bucket < NUM_OF_LATENCY_BUCKETS; ++bucket) {
+        numOfOperations += buckets[bucket];
+        if (numOfOperations >= rank && numOfOperations > 0) {
+            return min(maxNanos, (uint64_t) 1 << bucket);
+        }
+    }
+    return maxNanos;
+}
+
+FileIOMetrics::FileIOMetrics(const string &fileName): fileName(fileName)
+{
+    reset();
+}
+
+void FileIOMetrics::recordLatency(IOOperation operation, uint64_t nanos)
+{
+    Histogram &histogram = histograms[operation];
+    unsigned bucket = 0;
+    while (bucket < NUM_OF_LATENCY_BUCKETS - 1 && (nanos >> bucket) != 0) {
+        ++bucket;
+    }
+    histogram.buckets[bucket].fetch_add(1, memory_order_relaxed);
+    histogram.count.fetch_add(1, memory_order_relaxed);
+    histogram.totalNanos.fetch_add(nanos, memory_order_relaxed);
+    uint64_t maxNanos = histogram.maxNanos.load(memory_order_relaxed);
+    while (nanos > maxNanos && !histogram.maxNanos.compare_exchange_weak(maxNanos, nanos, memory_order_relaxed)) {
+    }
+}
+
+void FileIOMetrics::beginTransfer()
+{
+    unsigned depth = queueDepth.fetch_add(1, memory_order_relaxed) + 1;
+    unsigned maxDepth = maxQueueDepth.load(memory_order_relaxed);
+    while (depth > maxDepth && !maxQueueDepth.compare_exchange_weak(maxDepth, depth, memory_order_relaxed)) {
+    }
+}
+
+void FileIOMetrics::endTransfer(bool isWrite, uint64_t bytes, uint64_t nanos)
+{
+    queueDepth.fetch_sub(1, memory_order_relaxed);
+    (isWrite ? bytesWritten : bytesRead).fetch_add(bytes, memory_order_relaxed);
+    recordLatency(isWrite ? IO_DISK_WRITE : IO_DISK_READ, nanos);
+}
+
+void FileIOMetrics::collect(IOMetricsSnapshot &snapshot) const
+{
+    snapshot.fileName = fileName;
+    for (unsigned operation = 0; operation < NUM_OF_IO_OPERATIONS; ++operation) {
+        const Histogram &histogram = histograms[operation];
+        LatencyHistogram &latencies = snapshot.latencies[operation];
+        latencies.count = histogram.count.load(memory_order_relaxed);
+        latencies.totalNanos = histogram.totalNanos.load(memory_order_relaxed);
+        latencies.maxNanos = histogram.maxNanos.load(memory_order_relaxed);
+        for (unsigned bucket = 0; bucket < NUM_OF_LATENCY_BUCKETS; ++bucket) {
+            latencies.buckets[bucket] = histogram.buckets[bucket].load(memory_order_relaxed);
+        }
+    }
+    snapshot.bytesRead = bytesRead.load(memory_order_relaxed);
+    snapshot.bytesWritten = bytesWritten.load(memory_order_relaxed);
+    snapshot.queueDepth = queueDepth.load(memory_order_relaxed);
+    snapshot.maxQueueDepth = maxQueueDepth.load(memory_order_relaxed);
+}
+
+// The transfers in flight are still counted, so that the queue depth stays balanced
+void FileIOMetrics::reset()
+{
+    for (Histogram &histogram : histograms) {
+        histogram.count = 0;
+        histogram.totalNanos = 0;
+        histogram.maxNanos = 0;
+        for (atomic<uint64_t> &bucket : histogram.buckets) {
+            bucket = 0;
+        }
+    }
+    bytesRead = 0;
+    bytesWritten = 0;
+    maxQueueDepth = queueDepth.load();
+}
+
+
+FileBackend::FileBackend()
+{
+}
+
+
+FileBackend::~FileBackend()
+{
+    close();
+}
+
+RC FileBackend::open(const string &fileName, unsigned openFlags, shared_ptr<CompressedPageMap> pageMap,
+                     shared_ptr<FileIOMetrics> metrics)
+{
+    if (isOpen()) {
+        return FAIL;
+    }
+    if ((openFlags & OPEN_DIRECT_IO) && (openFlags & OPEN_MMAP)) {    // a mapping always goes through the page cache
+        return FAIL;
+    }
+    int flags = O_RDWR;
+    if (openFlags & OPEN_DIRECT_IO) {
+        flags |= O_DIRECT;
+    }
+    fd = ::open(fileName.c_str(), flags);
+    if (fd < 0) {
         return FAIL;
     }
-    file = make_shared<fstream>();
+    directIO = (openFlags & OPEN_DIRECT_IO) != 0;
+    mapped = (openFlags & OPEN_MMAP) != 0;
+    this->pageMap = pageMap;
+    this->metrics = metrics;
+
+    // space reserved beyond the end of the file by an earlier handle is counted in the allocated blocks;
+    // the slots of a compressed file are not laid out by page number, so no space is reserved for them.
+    // Delayed allocation already lays out the buffered appends of a file contiguously, so only direct I/O reserves
+    // extents unless asked to.
+    struct stat fileStat;
+    preallocating = (directIO || (openFlags & OPEN_PREALLOCATE) != 0) && (openFlags & OPEN_NO_PREALLOCATION) == 0
+                    && !pageMap && fstat(fd, &fileStat) == 0;
+    allocatedSize = preallocating ? max((uint64_t) fileStat.st_size, (uint64_t) fileStat.st_blocks * 512) : 0;
     return SUCCESS;
 }
 
+void FileBackend::close()
+{
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    pageMap.reset();
+    metrics.reset();
+}
 
-RC FileHandle::readPage(PageNum pageNum, void *data)
+bool FileBackend::isOpen() const
 {
-    if (pageNum >= getNumberOfPages()) {
+    return fd >= 0;
+}
+
+bool FileBackend::isDirectIO() const
+{
+    return directIO;
+}
+
+bool FileBackend::isCompressed() const
+{
+    return pageMap != nullptr;
+}
+
+bool FileBackend::isMapped() const
+{
+    return mapped;
+}
+
+RC FileBackend::getFileId(FileId &fileId) const
+{
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
         return FAIL;
     }
-    file->seekg((pageNum+1) * PAGE_SIZE, fstream::beg);
-    file->read((char*) data, PAGE_SIZE);
-    return (file) ? (++(*readPageCounter), SUCCESS) : FAIL;
+    fileId.device = fileStat.st_dev;
+    fileId.inode = fileStat.st_ino;
+    return SUCCESS;
 }
 
+uint64_t FileBackend::beginTransfer()
+{
+    if (!metrics) {
+        return 0;
+    }
+    metrics->beginTransfer();
+    return getMonotonicNanos();
+}
 
-RC FileHandle::writePage(PageNum pageNum, const void *data)
+RC FileBackend::endTransfer(bool isWrite, uint64_t bytes, uint64_t beginNanos, RC rc)
 {
-    if (pageNum >= getNumberOfPages()) {
-        return FAIL;
+    if (metrics) {
+        metrics->endTransfer(isWrite, (rc == SUCCESS) ? bytes : 0, getMonotonicNanos() - beginNanos);
     }
-    file->seekp((pageNum+1) * PAGE_SIZE, fstream::beg);
-    file->write((const char*) data, PAGE_SIZE);
-    return (file) ? (++(*writePageCounter), SUCCESS) : FAIL;
+    return rc;
 }
 
+void FileBackend::beginAsyncTransfer(AsyncPageIO &request)
+{
+    request.submitNanos = beginTransfer();
+}
 
-RC FileHandle::appendPage(const void *data)
+void FileBackend::endAsyncTransfer(const AsyncPageIO &request, RC result)
 {
-    file->seekp(0, fstream::end);
-    file->write((const char*) data, PAGE_SIZE);
-    return (file) ? (++(*appendPageCounter), ++(*numOfPages), SUCCESS) : FAIL;
+    endTransfer(request.isWrite, request.length, request.submitNanos, result);
 }
 
+RC FileBackend::readPage(PageNum filePageNum, void *data)
+{
+    uint64_t beginNanos = beginTransfer();
+    return endTransfer(false, PAGE_SIZE, beginNanos, transferPage(false, filePageNum, data));
+}
 
-unsigned FileHandle::getNumberOfPages()
+RC FileBackend::writePage(PageNum filePageNum, const void *data)
 {
-    return *numOfPages;
+    uint64_t beginNanos = beginTransfer();
+    return endTransfer(true, PAGE_SIZE, beginNanos, transferPage(true, filePageNum, (void*) data));
 }
 
+RC FileBackend::transferPage(bool isWrite, PageNum filePageNum, void *data)
+{
+    if (directIO && (uintptr_t) data % DIRECT_IO_ALIGNMENT != 0) {
+        unique_ptr<byte, void (*)(void*)> buffer(allocateAlignedBuffer(PAGE_SIZE), free);
+        if (isWrite) {
+            memcpy(buffer.get(), data, PAGE_SIZE);
+        }
+        if (transferPage(isWrite, filePageNum, buffer.get()) == FAIL) {
+            return FAIL;
+        }
+        if (!isWrite) {
+            memcpy(data, buffer.get(), PAGE_SIZE);
+        }
+        return SUCCESS;
+    }
+    if (pageMap && filePageNum > 0) {
+        return isWrite ? pageMap->writePage(fd, filePageNum, data) : pageMap->readPage(fd, filePageNum, data);
+    }
 
-RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
+    off_t offset = (off_t) filePageNum * PAGE_SIZE;
+    size_t bytesTransferred = 0;
+    while (bytesTransferred < PAGE_SIZE) {
+        byte *position = (byte*) data + bytesTransferred;
+        ssize_t n = isWrite ? pwrite(fd, position, PAGE_SIZE - bytesTransferred, offset + bytesTransferred)
+                            : pread(fd, position, PAGE_SIZE - bytesTransferred, offset + bytesTransferred);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {   // error or the page to read is beyond the end of the file
+            return FAIL;
+        }
+        bytesTransferred += n;
+    }
+    return SUCCESS;
+}
+
+static size_t getVectorLength(const struct iovec *iovs, unsigned numOfIovs)
 {
-    readPageCount = *readPageCounter;
-    writePageCount = *writePageCounter;
-    appendPageCount = *appendPageCounter;
+    size_t length = 0;
+    for (unsigned i = 0; i < numOfIovs; ++i) {
+        length += iovs[i].iov_len;
+    }
+    return length;
+}
+
+// Transfer all bytes of the I/O vector, continuing after partial transfers
+static RC transferVector(int fd, bool isWrite, off_t offset, const struct iovec *iovs, unsigned numOfIovs)
+{
+    vector<struct iovec> remaining(iovs, iovs + numOfIovs);
+    unsigned first = 0;
+    while (first < remaining.size()) {
+        ssize_t n = isWrite ? pwritev(fd, remaining.data() + first, remaining.size() - first, offset)
+                            : preadv(fd, remaining.data() + first, remaining.size() - first, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {   // error or the pages are beyond the end of the file
+            return FAIL;
+        }
+        offset += n;
+        while (n > 0) {
+            if ((size_t) n >= remaining[first].iov_len) {
+                n -= remaining[first].iov_len;
+                ++first;
+            } else {
+                remaining[first].iov_base = (byte*) remaining[first].iov_base + n;
+                remaining[first].iov_len -= n;
+                n = 0;
+            }
+        }
+    }
     return SUCCESS;
 }
 
-RC FileHandle::readHeaderPage(void *data)
+RC FileBackend::readPages(PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs)
 {
-    file->seekg(0, fstream::end);
-    if (file->tellg() <= 0) {
-        return FAIL;
+    uint64_t beginNanos = beginTransfer();
+    return endTransfer(false, getVectorLength(iovs, numOfIovs), beginNanos,
+                       transferPages(false, filePageNum, iovs, numOfIovs));
+}
+
+RC FileBackend::writePages(PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs)
+{
+    uint64_t beginNanos = beginTransfer();
+    return endTransfer(true, getVectorLength(iovs, numOfIovs), beginNanos,
+                       transferPages(true, filePageNum, iovs, numOfIovs));
+}
+
+RC FileBackend::transferPages(bool isWrite, PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs)
+{
+    if (pageMap) {
+        return transferCompressedPages(isWrite, filePageNum, iovs, numOfIovs);
     }
-    file->seekg(0, fstream::beg);
-    file->read((char*) data, PAGE_SIZE);
-    return (file) ? SUCCESS : FAIL;
+    return transferVector(fd, isWrite, (off_t) filePageNum * PAGE_SIZE, iovs, numOfIovs);
 }
 
-RC FileHandle::writeHeaderPage(const void *data)
+RC FileBackend::transferCompressedPages(bool isWrite, PageNum filePageNum, const struct iovec *iovs,
+                                        unsigned numOfIovs)
+{
+    for (unsigned i = 0; i < numOfIovs; ++i) {
+        if (iovs[i].iov_len % PAGE_SIZE != 0) {
+            return FAIL;
+        }
+        for (size_t offset = 0; offset < iovs[i].iov_len; offset += PAGE_SIZE, ++filePageNum) {
+            byte *page = (byte*) iovs[i].iov_base + offset;
+            if (transferPage(isWrite, filePageNum, page) == FAIL) {
+                return FAIL;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+RC FileBackend::sync()
+{
+    IOTimer timer(metrics.get(), IO_SYNC);
+    return (fsync(fd) == 0) ? SUCCESS : FAIL;
+}
+
+RC FileBackend::flushPageMap()
+{
+    return pageMap ? pageMap->flush() : SUCCESS;
+}
+
+RC FileBackend::reservePages(PageNum numOfFilePages)
 {
-    file->seekp(0, fstream::beg);
-    file->write((const char*) data, PAGE_SIZE);
-    return (file) ? SUCCESS : FAIL;
+    uint64_t requiredSize = (uint64_t) numOfFilePages * PAGE_SIZE;
+    if (requiredSize <= allocatedSize) {
+        return SUCCESS;
+    }
+
+    lock_guard<mutex> lock(extentMutex);
+    uint64_t size = allocatedSize;
+    if (!preallocating || requiredSize <= size) {
+        return SUCCESS;
+    }
+    uint64_t extentSize = min((uint64_t) MAX_EXTENT_SIZE, max((uint64_t) MIN_EXTENT_SIZE, size));
+    uint64_t newSize = max(requiredSize, (size + extentSize) / PAGE_SIZE * PAGE_SIZE);
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, size, newSize - size) != 0) {
+        if (errno != ENOSPC) {
+            preallocating = false;      // not supported, so let the writes allocate space themselves
+            return SUCCESS;
+        }
+        // the disk is almost full: reserve just the required pages, so that the append fails now
+        // rather than when the page is written back
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, size, requiredSize - size) != 0) {
+            return FAIL;
+        }
+        newSize = requiredSize;
+    }
+    allocatedSize = newSize;
+    return SUCCESS;
+}
+
+RC FileBackend::truncate(PageNum numOfFilePages)
+{
+    if (pageMap) {
+        return pageMap->truncate(fd, numOfFilePages);
+    }
+
+    uint64_t size = (uint64_t) numOfFilePages * PAGE_SIZE;
+    {
+        lock_guard<mutex> lock(mappingMutex);
+        fileSize = min(fileSize, (size_t) size);
+    }
+
+    lock_guard<mutex> lock(extentMutex);
+    if (ftruncate(fd, size) != 0) {
+        return FAIL;
+    }
+    if (allocatedSize > size) {
+        allocatedSize = size;
+    }
+    return SUCCESS;
+}
+
+RC FileBackend::getMappedPage(PageNum filePageNum, const byte *&page)
+{
+    lock_guard<mutex> lock(mappingMutex);
+
+    if (!mapped) {
+        return FAIL;
+    }
+    size_t pageEnd = ((size_t) filePageNum + 1) * PAGE_SIZE;
+    if (pageEnd > fileSize) {
+        // touching a mapped page beyond the end of the file raises SIGBUS
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < pageEnd) {
+            return FAIL;
+        }
+        fileSize = fileStat.st_size;
+    }
+    if (pageEnd > mappingSize) {
+        // reserve twice the file size, so that appends rarely need a new mapping
+        size_t newMappingSize = max(max(MIN_MAPPING_SIZE, 2 * mappingSize), 2 * fileSize);
+        void *newMapping = mmap(nullptr, newMappingSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (newMapping == MAP_FAILED) {
+            return FAIL;
+        }
+        if (mapping != nullptr) {
+            retiredMappings.emplace_back(mapping, mappingSize);
+        }
+        mapping = (byte*) newMapping;
+        mappingSize = newMappingSize;
+    }
+    page = mapping + (size_t) filePageNum * PAGE_SIZE;
+    return SUCCESS;
+}
+
+RC FileBackend::adviseMappedPages(PageNum filePageNum, unsigned count, int advice)
+{
+    lock_guard<mutex> lock(mappingMutex);
+
+    if (mapping == nullptr) {
+        return FAIL;
+    }
+    size_t begin = min((size_t) filePageNum * PAGE_SIZE, mappingSize);
+    size_t end = min(((size_t) filePageNum + count) * PAGE_SIZE, mappingSize);
+    if (begin == end) {
+        return SUCCESS;
+    }
+    return (madvise(mapping + begin, end - begin, advice) == 0) ? SUCCESS : FAIL;
+}
+
+RC FileBackend::adviseFilePages(const vector<PageNum> &filePageNums, int advice)
+{
+    if (fd < 0) {
+        return FAIL;
+    }
+    if (pageMap) {
+        return SUCCESS;
+    }
+    for (size_t i = 0; i < filePageNums.size();) {
+        size_t j = i + 1;
+        while (j < filePageNums.size() && filePageNums[j] == filePageNums[j - 1] + 1) {
+            ++j;
+        }
+        if (posix_fadvise(fd, (off_t) filePageNums[i] * PAGE_SIZE, (off_t) (j - i) * PAGE_SIZE, advice) != 0) {
+            return FAIL;
+        }
+        i = j;
+    }
+    return SUCCESS;
+}
+
+void FileBackend::unmap()
+{
+    lock_guard<mutex> lock(mappingMutex);
+
+    for (auto &retiredMapping : retiredMappings) {
+        munmap(retiredMapping.first, retiredMapping.second);
+    }
+    retiredMappings.clear();
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+    }
+    mappingSize = 0;
+    fileSize = 0;
+    mapped = false;
+}
+
+
+
+const unsigned LZ_MIN_MATCH = 4;
+const unsigned LZ_MAX_OFFSET = 0xffff;
+const unsigned LZ_LAST_LITERALS = 5;    // a block ends with literals, so that a match never reads past the end
+const unsigned LZ_HASH_BITS = 12;
+const unsigned LZ_SKIP_TRIGGER = 6;     // after 2^6 missed positions, the search steps over more bytes at once
+
+static void emitLength(uint8_t *&op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t) length;
+}
+
+// Emit a sequence of literals followed by a match; the last sequence of a block has no match (matchLength is 0)
+static bool emitSequence(uint8_t *&op, const uint8_t *outEnd, const uint8_t *literals, size_t numOfLiterals,
+                         size_t offset, size_t matchLength)
+{
+    size_t matchCode = (matchLength > 0) ? matchLength - LZ_MIN_MATCH : 0;
+    size_t maxSize = 1 + numOfLiterals / 255 + 1 + numOfLiterals + 2 + matchCode / 255 + 1;
+    if (maxSize > (size_t) (outEnd - op)) {
+        return false;
+    }
+    uint8_t *token = op++;
+    *token = (uint8_t) (min(numOfLiterals, (size_t) 15) << 4);
+    if (numOfLiterals >= 15) {
+        emitLength(op, numOfLiterals - 15);
+    }
+    memcpy(op, literals, numOfLiterals);
+    op += numOfLiterals;
+    if (matchLength == 0) {
+        return true;
+    }
+    *op++ = (uint8_t) (offset & 0xff);
+    *op++ = (uint8_t) (offset >> 8);
+    *token |= (uint8_t) min(matchCode, (size_t) 15);
+    if (matchCode >= 15) {
+        emitLength(op, matchCode - 15);
+    }
+    return true;
+}
+
+size_t lzCompress(const byte *src, size_t srcSize, byte *dst, size_t dstCapacity)
+{
+    const uint8_t *in = (const uint8_t*) src;
+    uint8_t *op = (uint8_t*) dst;
+    const uint8_t *outEnd = op + dstCapacity;
+
+    // last position of each hashed 4-byte sequence
+    uint32_t table[1 << LZ_HASH_BITS];
+    fill(table, table + (1 << LZ_HASH_BITS), UINT32_MAX);
+
+    size_t matchLimit = (srcSize > LZ_LAST_LITERALS) ? srcSize - LZ_LAST_LITERALS : 0;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + LZ_MIN_MATCH <= matchLimit) {
+        uint32_t sequence;
+        memcpy(&sequence, in + pos, sizeof(sequence));
+        uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        uint32_t candidate = table[hash];
+        table[hash] = (uint32_t) pos;
+
+        uint32_t candidateSequence;
+        if (candidate == UINT32_MAX || pos - candidate > LZ_MAX_OFFSET
+            || (memcpy(&candidateSequence, in + candidate, sizeof(candidateSequence)), candidateSequence != sequence)) {
+            pos += 1 + ((pos - anchor) >> LZ_SKIP_TRIGGER);
+            continue;
+        }
+
+        size_t matchLength = LZ_MIN_MATCH;
+        while (pos + matchLength < matchLimit && in[candidate + matchLength] == in[pos + matchLength]) {
+            ++matchLength;
+        }
+        if (!emitSequence(op, outEnd, in + anchor, pos - anchor, pos - candidate, matchLength)) {
+            return 0;
+        }
+        pos += matchLength;
+        anchor = pos;
+    }
+    if (!emitSequence(op, outEnd, in + anchor, srcSize - anchor, 0, 0)) {
+        return 0;
+    }
+    return op - (uint8_t*) dst;
+}
+
+static RC readLength(const uint8_t *&ip, const uint8_t *inEnd, size_t &length)
+{
+    uint8_t b;
+    do {
+        if (ip == inEnd) {
+            return FAIL;
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return SUCCESS;
+}
+
+RC lzDecompress(const byte *src, size_t srcSize, byte *dst, size_t dstSize)
+{
+    const uint8_t *ip = (const uint8_t*) src;
+    const uint8_t *inEnd = ip + srcSize;
+    uint8_t *op = (uint8_t*) dst;
+    uint8_t *outEnd = op + dstSize;
+
+    while (ip < inEnd) {
+        unsigned token = *ip++;
+        size_t numOfLiterals = token >> 4;
+        if (numOfLiterals == 15 && readLength(ip, inEnd, numOfLiterals) == FAIL) {
+            return FAIL;
+        }
+        if (numOfLiterals > (size_t) (inEnd - ip) || numOfLiterals > (size_t) (outEnd - op)) {
+            return FAIL;
+        }
+        memcpy(op, ip, numOfLiterals);
+        ip += numOfLiterals;
+        op += numOfLiterals;
+        if (ip == inEnd) {      // the last sequence
+            break;
+        }
+
+        if (inEnd - ip < 2) {
+            return FAIL;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && readLength(ip, inEnd, matchLength) == FAIL) {
+            return FAIL;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t) (op - (uint8_t*) dst) || matchLength > (size_t) (outEnd - op)) {
+            return FAIL;
+        }
+        const uint8_t *match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // the match overlaps the bytes it produces (a repeated pattern)
+            for (size_t i = 0; i < matchLength; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return (op == outEnd) ? SUCCESS : FAIL;
+}
+
+
+static bool writeFully(int fd, const vector<byte> &data)
+{
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        offset += written;
+    }
+    return true;
+}
+
+CompressedPageMap::~CompressedPageMap()
+{
+    flush();
+    if (dataFd >= 0) {
+        ::close(dataFd);
+    }
+}
+
+RC CompressedPageMap::open(const string &fileName)
+{
+    mapFileName = getMapFileName(fileName);
+    dataFd = ::open(fileName.c_str(), O_RDWR);
+    int mapFd = ::open(mapFileName.c_str(), O_RDONLY);
+    struct stat mapStat;
+    if (dataFd < 0 || mapFd < 0 || fstat(mapFd, &mapStat) != 0 || mapStat.st_size % sizeof(Slot) != 0) {
+        if (mapFd >= 0) {
+            ::close(mapFd);
+        }
+        return FAIL;
+    }
+    slots.resize(mapStat.st_size / sizeof(Slot));
+    bool isRead = slots.empty() || pread(mapFd, slots.data(), mapStat.st_size, 0) == mapStat.st_size;
+    ::close(mapFd);
+    if (!isRead) {
+        return FAIL;
+    }
+    for (size_t filePageNum = 1; filePageNum < slots.size(); ++filePageNum) {
+        const Slot &slot = slots[filePageNum];
+        if (slot.length > slot.capacity || slot.length > PAGE_SIZE
+            || (slot.capacity > 0 && slot.offset < PAGE_SIZE)) {
+            return FAIL;
+        }
+    }
+    durableSlots = slots;
+    rebuildFreeRuns();
+    return SUCCESS;
+}
+
+void CompressedPageMap::rebuildFreeRuns()
+{
+    // the runs of the map on disk stay in use until a new map is written
+    vector<pair<uint64_t, uint64_t>> runs;     // offset, capacity of the slots in use
+    for (const vector<Slot> *slotMap : {&slots, &durableSlots}) {
+        for (size_t filePageNum = 1; filePageNum < slotMap->size(); ++filePageNum) {
+            if ((*slotMap)[filePageNum].capacity > 0) {
+                runs.emplace_back((*slotMap)[filePageNum].offset, (*slotMap)[filePageNum].capacity);
+            }
+        }
+    }
+    sort(runs.begin(), runs.end());
+
+    freeRuns.clear();
+    endOffset = PAGE_SIZE;
+    for (const auto &run : runs) {
+        if (run.first > endOffset) {
+            freeRuns.emplace(run.first - endOffset, endOffset);
+        }
+        endOffset = max(endOffset, run.first + run.second);
+    }
+}
+
+uint64_t CompressedPageMap::allocateRun(uint64_t size)
+{
+    auto it = freeRuns.lower_bound(size);
+    if (it == freeRuns.end()) {
+        uint64_t offset = endOffset;
+        endOffset += size;
+        return offset;
+    }
+    uint64_t offset = it->second;
+    uint64_t remainingSize = it->first - size;
+    freeRuns.erase(it);
+    if (remainingSize > 0) {
+        freeRuns.emplace(remainingSize, offset + size);
+    }
+    return offset;
+}
+
+RC CompressedPageMap::readPage(int fd, PageNum filePageNum, void *data)
+{
+    byte buffer[PAGE_SIZE];
+    uint32_t length;
+    {
+        // the slot may be reused as soon as the page moves, so it is read under the lock
+        lock_guard<mutex> lock(mapMutex);
+        if (filePageNum >= slots.size() || slots[filePageNum].length == 0) {
+            return FAIL;
+        }
+        const Slot &slot = slots[filePageNum];
+        length = slot.length;
+        size_t bytesRead = 0;
+        while (bytesRead < length) {
+            ssize_t n = pread(fd, buffer + bytesRead, length - bytesRead, slot.offset + bytesRead);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return FAIL;
+            }
+            bytesRead += n;
+        }
+    }
+    if (length == PAGE_SIZE) {
+        memcpy(data, buffer, PAGE_SIZE);
+        return SUCCESS;
+    }
+    return lzDecompress(buffer, length, (byte*) data, PAGE_SIZE);
+}
+
+RC CompressedPageMap::writePage(int fd, PageNum filePageNum, const void *data)
+{
+    // a page which does not save a slot unit is kept raw, so that it is read without decompressing
+    byte buffer[PAGE_SIZE];
+    const byte *page = buffer;
+    uint32_t length = lzCompress((const byte*) data, PAGE_SIZE, buffer, PAGE_SIZE - COMPRESSED_SLOT_UNIT);
+    if (length == 0) {
+        page = (const byte*) data;
+        length = PAGE_SIZE;
+    }
+    uint32_t capacity = (length + COMPRESSED_SLOT_UNIT - 1) / COMPRESSED_SLOT_UNIT * COMPRESSED_SLOT_UNIT;
+
+    lock_guard<mutex> lock(mapMutex);
+    if (filePageNum >= slots.size()) {
+        slots.resize(filePageNum + 1, Slot{0, 0, 0});
+    }
+    Slot slot = slots[filePageNum];
+    // the run of the page in the map on disk is not overwritten, so that the page is still read as it was flushed
+    // after a crash; it is released once a new map is durable
+    bool isDurableRun = filePageNum < durableSlots.size() && durableSlots[filePageNum].capacity > 0
+                        && durableSlots[filePageNum].offset == slot.offset;
+    if (length > slot.capacity || isDurableRun) {
+        if (slot.capacity > 0 && !isDurableRun) {
+            freeRuns.emplace(slot.capacity, slot.offset);
+        }
+        slot.offset = allocateRun(capacity);
+        slot.capacity = capacity;
+    }
+    slot.length = length;
+
+    size_t bytesWritten = 0;
+    while (bytesWritten < length) {
+        ssize_t n = pwrite(fd, page + bytesWritten, length - bytesWritten, slot.offset + bytesWritten);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            rebuildFreeRuns();      // the slot taken for the page is given back
+            return FAIL;
+        }
+        bytesWritten += n;
+    }
+    slots[filePageNum] = slot;
+    isDirty = true;
+    return SUCCESS;
+}
+
+RC CompressedPageMap::truncate(int fd, PageNum numOfFilePages)
+{
+    lock_guard<mutex> lock(mapMutex);
+    if (numOfFilePages < slots.size()) {
+        slots.resize(max(numOfFilePages, (PageNum) 1));
+        isDirty = true;
+    }
+    rebuildFreeRuns();
+    return (ftruncate(fd, endOffset) == 0) ? SUCCESS : FAIL;
+}
+
+RC CompressedPageMap::flush()
+{
+    lock_guard<mutex> lock(mapMutex);
+    if (!isDirty) {
+        return SUCCESS;
+    }
+    // the pages must be on disk before a map pointing to them, and a new map is written and renamed, so that a crash
+    // leaves either map behind but never half of one
+    if (dataFd < 0 || fdatasync(dataFd) != 0) {
+        return FAIL;
+    }
+    string tempFileName = mapFileName + ".tmp";
+    int mapFd = ::open(tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (mapFd < 0) {
+        return FAIL;
+    }
+    vector<byte> data((const byte*) slots.data(), (const byte*) (slots.data() + slots.size()));
+    bool isWritten = writeFully(mapFd, data) && fsync(mapFd) == 0;
+    ::close(mapFd);
+    if (!isWritten || rename(tempFileName.c_str(), mapFileName.c_str()) != 0) {
+        remove(tempFileName.c_str());
+        return FAIL;
+    }
+    durableSlots = slots;
+    isDirty = false;
+    // the runs only used by the old map are free now, and those at the end of the file are cut
+    rebuildFreeRuns();
+    return (ftruncate(dataFd, endOffset) == 0) ? SUCCESS : FAIL;
+}
+
+void HotPageList::recordAccess(PageNum pageNum)
+{
+    lock_guard<mutex> lock(listMutex);
+    ++accessCounts[pageNum];
+    ++numOfUnsavedAccesses;
+    if (accessCounts.size() <= MAX_NUM_OF_HOT_PAGE_COUNTS) {
+        return;
+    }
+
+    // age the counts, so that the pages which are no longer accessed are forgotten
+    for (auto it = accessCounts.begin(); it != accessCounts.end();) {
+        it->second /= 2;
+        it = (it->second == 0) ? accessCounts.erase(it) : next(it);
+    }
+}
+
+RC HotPageList::load(vector<PageNum> &pageNums)
+{
+    pageNums.clear();
+    ifstream file(getListFileName(fileName), fstream::in | fstream::binary);
+    if (!file) {
+        return FAIL;
+    }
+    uint32_t numOfPages = 0;
+    file.read((char*) &numOfPages, sizeof(numOfPages));
+    if (!file || numOfPages > HOT_PAGE_LIST_SIZE) {
+        return FAIL;
+    }
+    pageNums.resize(numOfPages);
+    file.read((char*) pageNums.data(), numOfPages * sizeof(PageNum));
+    if (!file) {
+        pageNums.clear();
+        return FAIL;
+    }
+
+    lock_guard<mutex> lock(listMutex);
+    for (PageNum pageNum : pageNums) {
+        accessCounts.emplace(pageNum, 1);
+    }
+    return SUCCESS;
+}
+
+RC HotPageList::save(uint64_t minNumOfAccesses)
+{
+    vector<PageNum> pageNums;
+    {
+        lock_guard<mutex> lock(listMutex);
+        if (numOfUnsavedAccesses == 0 || numOfUnsavedAccesses < minNumOfAccesses) {
+            return SUCCESS;
+        }
+        numOfUnsavedAccesses = 0;
+    }
+    getHotPages(pageNums);
+
+    // write a new list and rename it, so that a crash never leaves half a list behind
+    string listFileName = getListFileName(fileName);
+    string tempFileName = listFileName + ".tmp";
+    ofstream file(tempFileName, fstream::out | fstream::binary | fstream::trunc);
+    uint32_t numOfPages = pageNums.size();
+    file.write((const char*) &numOfPages, sizeof(numOfPages));
+    file.write((const char*) pageNums.data(), numOfPages * sizeof(PageNum));
+    file.close();
+    if (!file || rename(tempFileName.c_str(), listFileName.c_str()) != 0) {
+        remove(tempFileName.c_str());
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+void HotPageList::getHotPages(vector<PageNum> &pageNums, unsigned maxNumOfPages)
+{
+    vector<pair<uint32_t, PageNum>> counts;
+    {
+        lock_guard<mutex> lock(listMutex);
+        counts.reserve(accessCounts.size());
+        for (const auto &count : accessCounts) {
+            counts.emplace_back(count.second, count.first);
+        }
+    }
+    size_t numOfPages = min((size_t) maxNumOfPages, counts.size());
+    partial_sort(counts.begin(), counts.begin() + numOfPages, counts.end(),
+                 [](const pair<uint32_t, PageNum> &a, const pair<uint32_t, PageNum> &b) {
+                     return a.first > b.first || (a.first == b.first && a.second < b.second);
+                 });
+    pageNums.resize(numOfPages);
+    for (size_t i = 0; i < numOfPages; ++i) {
+        pageNums[i] = counts[i].second;
+    }
+}
+
+// Asynchronous page I/O on io_uring. The rings are shared by all threads and protected by a mutex;
+// completions are collected by whichever thread polls or waits, and handed to their requests.
+class IoUringEngine : public AsyncIOEngine
+{
+public:
+    IoUringEngine();
+    ~IoUringEngine();
+
+    bool isReady() const { return ringFd >= 0; }
+
+    RC submit(AsyncPageIO **requests, unsigned count) override;
+    void poll() override;
+    void wait(AsyncPageIO &request) override;
+    unsigned getType() const override { return ASYNC_IO_URING; }
+
+private:
+    mutex ringMutex;
+    int ringFd = -1;
+    unsigned numOfInFlight = 0;
+
+    void *sqRing = MAP_FAILED;
+    void *cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    struct io_uring_sqe *sqes = (struct io_uring_sqe*) MAP_FAILED;
+    unsigned sqEntries = 0;
+    unsigned cqEntries = 0;
+
+    atomic<unsigned> *sqHead;
+    atomic<unsigned> *sqTail;
+    unsigned sqMask;
+    unsigned *sqArray;
+    atomic<unsigned> *cqHead;
+    atomic<unsigned> *cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe *cqes;
+
+    // Hand the completed entries to their requests and return the number of them
+    unsigned reap();
+
+    // Block until at least one request completes
+    void waitForCompletion();
+
+    void release();
+};
+
+IoUringEngine::IoUringEngine()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = syscall(__NR_io_uring_setup, ASYNC_IO_QUEUE_DEPTH, &params);
+    if (ringFd < 0) {
+        return;
+    }
+    sqEntries = params.sq_entries;
+    cqEntries = params.cq_entries;
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool isSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (isSingleMap) {
+        sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    cqRing = isSingleMap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         ringFd, IORING_OFF_CQ_RING);
+    sqes = (struct io_uring_sqe*) mmap(nullptr, sqEntries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == (struct io_uring_sqe*) MAP_FAILED) {
+        release();
+        return;
+    }
+
+    byte *sq = (byte*) sqRing;
+    byte *cq = (byte*) cqRing;
+    sqHead = (atomic<unsigned>*) (sq + params.sq_off.head);
+    sqTail = (atomic<unsigned>*) (sq + params.sq_off.tail);
+    sqMask = *((unsigned*) (sq + params.sq_off.ring_mask));
+    sqArray = (unsigned*) (sq + params.sq_off.array);
+    cqHead = (atomic<unsigned>*) (cq + params.cq_off.head);
+    cqTail = (atomic<unsigned>*) (cq + params.cq_off.tail);
+    cqMask = *((unsigned*) (cq + params.cq_off.ring_mask));
+    cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+}
+
+IoUringEngine::~IoUringEngine()
+{
+    release();
+}
+
+void IoUringEngine::release()
+{
+    if (sqes != (struct io_uring_sqe*) MAP_FAILED) {
+        munmap(sqes, sqEntries * sizeof(struct io_uring_sqe));
+        sqes = (struct io_uring_sqe*) MAP_FAILED;
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = MAP_FAILED;
+    if (sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+        sqRing = MAP_FAILED;
+    }
+    if (ringFd >= 0) {
+        close(ringFd);
+        ringFd = -1;
+    }
+}
+
+RC IoUringEngine::submit(AsyncPageIO **requests, unsigned count)
+{
+    lock_guard<mutex> lock(ringMutex);
+
+    RC rc = SUCCESS;
+    unsigned i = 0;
+    while (i < count) {
+        // the completion queue must never overflow
+        while (numOfInFlight >= cqEntries) {
+            waitForCompletion();
+        }
+
+        unsigned tail = sqTail->load(memory_order_relaxed);
+        unsigned numToSubmit = 0;
+        while (i < count && numToSubmit < sqEntries && numOfInFlight + numToSubmit < cqEntries) {
+            AsyncPageIO *request = requests[i++];
+
+            unsigned index = (tail + numToSubmit) & sqMask;
+            struct io_uring_sqe *sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = request->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request->file->getFd();
+            sqe->off = (uint64_t) request->filePageNum * PAGE_SIZE;
+            sqe->addr = (uint64_t) (uintptr_t) request->iovs.data();
+            sqe->len = request->iovs.size();
+            sqe->user_data = (uint64_t) (uintptr_t) request;
+            sqArray[index] = index;
+            ++numToSubmit;
+        }
+        sqTail->store(tail + numToSubmit, memory_order_release);
+
+        unsigned numOfSubmitted = 0;
+        while (numOfSubmitted < numToSubmit) {
+            int n = syscall(__NR_io_uring_enter, ringFd, numToSubmit - numOfSubmitted, 0, 0, nullptr, 0);
+            if (n > 0) {
+                numOfSubmitted += n;
+            } else if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+                reap();
+            } else {
+                break;
+            }
+        }
+        numOfInFlight += numOfSubmitted;
+        if (numOfSubmitted < numToSubmit) {
+            // the kernel refused the remaining entries, so withdraw them and fail their requests
+            sqTail->store(tail + numOfSubmitted, memory_order_release);
+            for (unsigned j = numOfSubmitted; j < numToSubmit; ++j) {
+                AsyncPageIO *request = (AsyncPageIO*) (uintptr_t) sqes[(tail + j) & sqMask].user_data;
+                request->result = FAIL;
+                request->file->endAsyncTransfer(*request, FAIL);
+                request->isDone.store(true, memory_order_release);
+            }
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+void IoUringEngine::poll()
+{
+    lock_guard<mutex> lock(ringMutex);
+    reap();
+}
+
+void IoUringEngine::wait(AsyncPageIO &request)
+{
+    lock_guard<mutex> lock(ringMutex);
+    while (!request.isDone.load(memory_order_acquire)) {
+        waitForCompletion();
+    }
+}
+
+unsigned IoUringEngine::reap()
+{
+    unsigned head = cqHead->load(memory_order_relaxed);
+    unsigned tail = cqTail->load(memory_order_acquire);
+    unsigned numOfReaped = 0;
+    for (; head != tail; ++head, ++numOfReaped) {
+        struct io_uring_cqe *cqe = &cqes[head & cqMask];
+        AsyncPageIO *request = (AsyncPageIO*) (uintptr_t) cqe->user_data;
+        request->result = (cqe->res >= 0 && (size_t) cqe->res == request->length) ? SUCCESS : FAIL;
+        request->file->endAsyncTransfer(*request, request->result);
+        request->isDone.store(true, memory_order_release);
+    }
+    cqHead->store(head, memory_order_release);
+    numOfInFlight -= numOfReaped;
+    return numOfReaped;
+}
+
+void IoUringEngine::waitForCompletion()
+{
+    if (reap() > 0) {
+        return;
+    }
+    syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    reap();
+}
+
+
+// Asynchronous page I/O on a pool of worker threads doing positional reads and writes
+class ThreadPoolEngine : public AsyncIOEngine
+{
+public:
+    ThreadPoolEngine(unsigned numOfThreads);
+    ~ThreadPoolEngine();
+
+    RC submit(AsyncPageIO **requests, unsigned count) override;
+    void poll() override {}
+    void wait(AsyncPageIO &request) override;
+    unsigned getType() const override { return ASYNC_IO_THREAD_POOL; }
+
+private:
+    mutex queueMutex;
+    condition_variable requestCond;     // signaled when a request is queued or the pool is stopped
+    condition_variable completionCond;  // signaled when a request is done
+    deque<AsyncPageIO*> requestQueue;
+    vector<thread> workers;
+    bool isStopped = false;
+
+    void work();
+};
+
+ThreadPoolEngine::ThreadPoolEngine(unsigned numOfThreads)
+{
+    for (unsigned i = 0; i < numOfThreads; ++i) {
+        workers.emplace_back(&ThreadPoolEngine::work, this);
+    }
+}
+
+ThreadPoolEngine::~ThreadPoolEngine()
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        isStopped = true;
+    }
+    requestCond.notify_all();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+}
+
+RC ThreadPoolEngine::submit(AsyncPageIO **requests, unsigned count)
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        requestQueue.insert(requestQueue.end(), requests, requests + count);
+    }
+    requestCond.notify_all();
+    return SUCCESS;
+}
+
+void ThreadPoolEngine::wait(AsyncPageIO &request)
+{
+    unique_lock<mutex> lock(queueMutex);
+    completionCond.wait(lock, [&request] { return request.isDone.load(memory_order_acquire); });
+}
+
+void ThreadPoolEngine::work()
+{
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        requestCond.wait(lock, [this] { return isStopped || !requestQueue.empty(); });
+        if (requestQueue.empty()) {     // stopped
+            return;
+        }
+        AsyncPageIO *request = requestQueue.front();
+        requestQueue.pop_front();
+        lock.unlock();
+
+        FileBackend &file = *request->file;
+        const struct iovec *iovs = request->iovs.data();
+        unsigned numOfIovs = request->iovs.size();
+        RC result = file.transferPages(request->isWrite, request->filePageNum, iovs, numOfIovs);
+        file.endAsyncTransfer(*request, result);
+
+        lock.lock();
+        request->result = result;
+        request->isDone.store(true, memory_order_release);
+        completionCond.notify_all();
+    }
+}
+
+
+static unique_ptr<AsyncIOEngine> createAsyncIOEngine(unsigned engineType)
+{
+    if (engineType == ASYNC_IO_URING || engineType == ASYNC_IO_AUTO) {
+        unique_ptr<IoUringEngine> engine(new IoUringEngine());
+        if (engine->isReady()) {
+            return unique_ptr<AsyncIOEngine>(engine.release());
+        }
+        if (engineType == ASYNC_IO_URING) {     // io_uring is not supported (or not permitted) here
+            return nullptr;
+        }
+    }
+    if (engineType == ASYNC_IO_THREAD_POOL || engineType == ASYNC_IO_AUTO) {
+        return unique_ptr<AsyncIOEngine>(new ThreadPoolEngine(NUM_OF_ASYNC_IO_THREADS));
+    }
+    return nullptr;
+}
+
+
+BufferPool::BufferPool(unsigned numOfFrames): frames(numOfFrames)
+{
+    frameData = PageArena::instance().allocate((size_t) numOfFrames * PAGE_SIZE);
+}
+
+
+BufferPool::~BufferPool()
+{
+    PageArena::instance().release(frameData, frames.size() * PAGE_SIZE);
+}
+
+byte* BufferPool::pinPage(FileHandle &fileHandle, PageNum filePageNum, bool loadPage)
+{
+    unique_lock<mutex> lock(poolMutex);
+
+    FrameKey key = {fileHandle.fileId, filePageNum};
+    unsigned numOfFailedWriteBacks = 0;
+    while (true) {
+        auto it = pageTable.find(key);
+        if (it != pageTable.end()) {
+            Frame &frame = frames[it->second];
+            if (frame.isInTransit) {
+                // the page is being read by another thread, or written back before its frame is reused
+                transitCondition.wait(lock);
+                continue;
+            }
+            ++frame.pinCount;
+            frame.isReferenced = true;
+            ++(*fileHandle.bufferHitCounter);
+            return getFrameData(it->second);
+        }
+
+        unsigned frameNum = findVictim();
+        if (frameNum == frames.size()) {
+            return nullptr;
+        }
+        Frame &frame = frames[frameNum];
+        if (frame.isValid) {
+            // a dirty victim is written back without holding the lock
+            if (writeBackInTransit(frameNum, lock) == FAIL) {
+                if (++numOfFailedWriteBacks >= frames.size()) {
+                    return nullptr;
+                }
+                continue;
+            }
+            pageTable.erase(frame.key);
+            frame.file.reset();
+            frame.isValid = false;
+            ++(*fileHandle.bufferEvictionCounter);
+            if (pageTable.count(key) > 0) {
+                continue;   // the page has been loaded by another thread meanwhile
+            }
+        }
+
+        frame.key = key;
+        frame.file = fileHandle.file;
+        frame.pinCount = 1;
+        frame.isValid = true;
+        frame.isDirty = false;
+        frame.isReferenced = true;
+        pageTable[key] = frameNum;
+        ++(*fileHandle.bufferMissCounter);
+        if (!loadPage) {
+            return getFrameData(frameNum);
+        }
+
+        // other requesters of the page wait for the read, which is done without holding the lock
+        frame.isInTransit = true;
+        byte *data = getFrameData(frameNum);
+        lock.unlock();
+        RC rc = fileHandle.file->readPage(filePageNum, data);
+        lock.lock();
+        frame.isInTransit = false;
+        transitCondition.notify_all();
+        if (rc == FAIL) {
+            pageTable.erase(key);
+            frame.file.reset();
+            frame.isValid = false;
+            frame.pinCount = 0;
+            return nullptr;
+        }
+        return data;
+    }
+}
+
+void BufferPool::unpinPage(const FileId &fileId, PageNum filePageNum, bool isDirty)
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    auto it = pageTable.find({fileId, filePageNum});
+    if (it == pageTable.end()) {
+        return;
+    }
+    Frame &frame = frames[it->second];
+    if (frame.pinCount > 0) {
+        --frame.pinCount;
+    }
+    frame.isDirty = frame.isDirty || isDirty;
+    if (isDirty) {
+        ++fileVersions[fileId];
+    }
+}
+
+bool BufferPool::readCachedPage(FileHandle &fileHandle, PageNum filePageNum, void *data)
+{
+    unique_lock<mutex> lock(poolMutex);
+
+    auto it = waitForTransit({fileHandle.fileId, filePageNum}, lock);
+    if (it == pageTable.end()) {
+        return false;
+    }
+    frames[it->second].isReferenced = true;
+    memcpy(data, getFrameData(it->second), PAGE_SIZE);
+    ++(*fileHandle.bufferHitCounter);
+    return true;
+}
+
+void BufferPool::updateCachedPage(const FileId &fileId, PageNum filePageNum, const void *data)
+{
+    unique_lock<mutex> lock(poolMutex);
+
+    auto it = waitForTransit({fileId, filePageNum}, lock);
+    if (it != pageTable.end()) {
+        memcpy(getFrameData(it->second), data, PAGE_SIZE);
+    }
+    ++fileVersions[fileId];
+}
+
+uint64_t BufferPool::getFileVersion(const FileId &fileId)
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    auto it = fileVersions.find(fileId);
+    return (it == fileVersions.end()) ? 0 : it->second;
+}
+
+RC BufferPool::flushFile(const FileId &fileId)
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    RC rc = SUCCESS;
+    for (unsigned frameNum = 0; frameNum < frames.size(); ++frameNum) {
+        if (frames[frameNum].isValid && frames[frameNum].key.fileId == fileId && writeBack(frameNum) == FAIL) {
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+RC BufferPool::flushPage(const FileId &fileId, PageNum filePageNum)
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    auto it = pageTable.find({fileId, filePageNum});
+    return (it == pageTable.end()) ? SUCCESS : writeBack(it->second);
+}
+
+RC BufferPool::flushAll()
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    RC rc = SUCCESS;
+    for (unsigned frameNum = 0; frameNum < frames.size(); ++frameNum) {
+        if (frames[frameNum].isValid && writeBack(frameNum) == FAIL) {
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+void BufferPool::discardFile(const FileId &fileId)
+{
+    discardPages(fileId, 0);
+}
+
+void BufferPool::discardPages(const FileId &fileId, PageNum firstFilePageNum)
+{
+    unique_lock<mutex> lock(poolMutex);
+
+    transitCondition.wait(lock, [&] {
+        for (const Frame &frame : frames) {
+            if (frame.isInTransit && frame.key.fileId == fileId && frame.key.filePageNum >= firstFilePageNum) {
+                return false;
+            }
+        }
+        return true;
+    });
+    for (Frame &frame : frames) {
+        if (frame.isValid && frame.key.fileId == fileId && frame.key.filePageNum >= firstFilePageNum) {
+            pageTable.erase(frame.key);
+            frame.file.reset();
+            frame.isValid = false;
+            frame.isDirty = false;
+            frame.pinCount = 0;
+        }
+    }
+    ++fileVersions[fileId];
+}
+
+RC BufferPool::resize(unsigned numOfFrames)
+{
+    lock_guard<mutex> lock(poolMutex);
+
+    if (numOfFrames == 0) {
+        return FAIL;
+    }
+    for (unsigned frameNum = 0; frameNum < frames.size(); ++frameNum) {
+        if (frames[frameNum].pinCount > 0) {
+            return FAIL;
+        }
+    }
+    for (unsigned frameNum = 0; frameNum < frames.size(); ++frameNum) {
+        if (frames[frameNum].isValid && writeBack(frameNum) == FAIL) {
+            return FAIL;
+        }
+    }
+    byte *newFrameData = PageArena::instance().allocate((size_t) numOfFrames * PAGE_SIZE);
+    PageArena::instance().release(frameData, frames.size() * PAGE_SIZE);
+    frameData = newFrameData;
+    pageTable.clear();
+    frames.assign(numOfFrames, Frame());
+    clockHand = 0;
+    return SUCCESS;
+}
+
+unsigned BufferPool::getNumberOfFrames()
+{
+    lock_guard<mutex> lock(poolMutex);
+    return frames.size();
+}
+
+unordered_map<BufferPool::FrameKey, unsigned, BufferPool::FrameKeyHash>::iterator
+BufferPool::waitForTransit(const FrameKey &key, unique_lock<mutex> &lock)
+{
+    while (true) {
+        auto it = pageTable.find(key);
+        if (it == pageTable.end() || !frames[it->second].isInTransit) {
+            return it;
+        }
+        transitCondition.wait(lock);
+    }
+}
+
+unsigned BufferPool::findVictim()
+{
+    // every unpinned frame gets a second chance before it is evicted, so two rounds are enough
+    for (unsigned i = 0; i < 2 * frames.size(); ++i) {
+        unsigned frameNum = clockHand;
+        clockHand = (clockHand + 1) % frames.size();
+        Frame &frame = frames[frameNum];
+        if (!frame.isValid) {
+            return frameNum;
+        }
+        if (frame.pinCount > 0) {
+            continue;
+        }
+        if (frame.isReferenced) {
+            frame.isReferenced = false;
+            continue;
+        }
+        return frameNum;
+    }
+    return frames.size();
+}
+
+RC BufferPool::writeBack(unsigned frameNum)
+{
+    Frame &frame = frames[frameNum];
+    if (!frame.isDirty) {
+        return SUCCESS;
+    }
+    if (frame.file->writePage(frame.key.filePageNum, getFrameData(frameNum)) == FAIL) {
+        return FAIL;
+    }
+    frame.isDirty = false;
+    return SUCCESS;
+}
+
+RC BufferPool::writeBackInTransit(unsigned frameNum, unique_lock<mutex> &lock)
+{
+    Frame &frame = frames[frameNum];
+    if (!frame.isDirty) {
+        return SUCCESS;
+    }
+    // pinned, so that the frame is neither evicted nor the pool resized, and in transit, so that nobody pins or
+    // modifies the page until it is written
+    ++frame.pinCount;
+    frame.isInTransit = true;
+    shared_ptr<FileBackend> file = frame.file;
+    PageNum filePageNum = frame.key.filePageNum;
+    byte *data = getFrameData(frameNum);
+    lock.unlock();
+    RC rc = file->writePage(filePageNum, data);
+    lock.lock();
+    --frame.pinCount;
+    frame.isInTransit = false;
+    transitCondition.notify_all();
+    if (rc == FAIL) {
+        return FAIL;
+    }
+    frame.isDirty = false;
+    return SUCCESS;
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    if (logFd >= 0) {
+        ::close(logFd);
+    }
+    if (dataFd >= 0) {
+        ::close(dataFd);
+    }
+}
+
+bool WriteAheadLog::hasRecords(const string &fileName)
+{
+    struct stat logStat;
+    return stat(getLogFileName(fileName).c_str(), &logStat) == 0 && logStat.st_size > 0;
+}
+
+RC WriteAheadLog::open(const string &fileName, shared_ptr<FileIOMetrics> metrics)
+{
+    this->metrics = metrics;
+    dataFd = ::open(fileName.c_str(), O_RDWR);
+    logFd = ::open(getLogFileName(fileName).c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (dataFd < 0 || logFd < 0) {
+        return FAIL;
+    }
+    return recover();
+}
+
+uint32_t WriteAheadLog::computeChecksum(const RecordHeader &header, const byte *page)
+{
+    // FNV-1a
+    uint32_t checksum = 2166136261u;
+    const byte *pageNum = (const byte*) &header.filePageNum;
+    for (unsigned i = 0; i < sizeof(header.filePageNum); ++i) {
+        checksum = (checksum ^ (uint8_t) pageNum[i]) * 16777619u;
+    }
+    for (unsigned i = 0; i < PAGE_SIZE; ++i) {
+        checksum = (checksum ^ (uint8_t) page[i]) * 16777619u;
+    }
+    return checksum;
+}
+
+RC WriteAheadLog::recover()
+{
+    // replay the records in order; the records after a torn or stale one were never acknowledged
+    vector<byte> record(sizeof(RecordHeader) + PAGE_SIZE);
+    const byte *page = record.data() + sizeof(RecordHeader);
+    off_t offset = 0;
+    PageNum maxFilePageNum = 0;
+    while (pread(logFd, record.data(), record.size(), offset) == (ssize_t) record.size()) {
+        RecordHeader header;
+        memcpy(&header, record.data(), sizeof(header));
+        if ((lastLSN > 0 && header.lsn != lastLSN + 1) || header.checksum != computeChecksum(header, page)) {
+            break;
+        }
+        if (pwrite(dataFd, page, PAGE_SIZE, (off_t) header.filePageNum * PAGE_SIZE) != PAGE_SIZE) {
+            return FAIL;
+        }
+        lastLSN = header.lsn;
+        maxFilePageNum = max(maxFilePageNum, header.filePageNum);
+        ++recoveredCounter;
+        offset += record.size();
+    }
+
+    if (recoveredCounter > 0) {
+        // pages appended since the header page was last logged are counted too (logical page p is file page p + 1)
+        byte header[PAGE_SIZE];
+        if (pread(dataFd, header, PAGE_SIZE, 0) != PAGE_SIZE) {
+            return FAIL;
+        }
+        uint64_t *numOfPages = (uint64_t*) (header + FileHandle::NUM_OF_PAGES_OFFSET);
+        *numOfPages = max(*numOfPages, (uint64_t) maxFilePageNum);
+        if (pwrite(dataFd, header, PAGE_SIZE, 0) != PAGE_SIZE || fdatasync(dataFd) != 0) {
+            return FAIL;
+        }
+    }
+    if (ftruncate(logFd, 0) != 0 || fdatasync(logFd) != 0) {
+        return FAIL;
+    }
+    durableLSN = lastLSN;
+    return SUCCESS;
+}
+
+RC WriteAheadLog::logPages(PageNum filePageNum, const void *data, unsigned count)
+{
+    vector<RecordHeader> headers(count);
+    for (unsigned i = 0; i < count; ++i) {
+        headers[i].filePageNum = filePageNum + i;
+        headers[i].checksum = computeChecksum(headers[i], (const byte*) data + (size_t) i * PAGE_SIZE);
+    }
+
+    unique_lock<mutex> lock(logMutex);
+    if (isBroken) {
+        return FAIL;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        headers[i].lsn = ++lastLSN;
+        const byte *page = (const byte*) data + (size_t) i * PAGE_SIZE;
+        buffer.insert(buffer.end(), (const byte*) &headers[i], (const byte*) &headers[i] + sizeof(RecordHeader));
+        buffer.insert(buffer.end(), page, page + PAGE_SIZE);
+    }
+    recordCounter += count;
+    ++numOfUnapplied;   // a checkpoint must not empty the log before the pages are applied
+
+    uint64_t lsn = lastLSN;
+    while (durableLSN < lsn && !isBroken) {
+        if (isFlushing) {
+            flushedCondition.wait(lock);
+            continue;
+        }
+
+        // lead the next group: write all the buffered records, including those of other writers, with one sync
+        isFlushing = true;
+        vector<byte> batch;
+        batch.swap(buffer);
+        uint64_t batchLSN = lastLSN;
+        lock.unlock();
+        bool isWritten = writeFully(logFd, batch);
+        if (isWritten) {
+            IOTimer timer(metrics.get(), IO_SYNC);
+            isWritten = fdatasync(logFd) == 0;
+        }
+        lock.lock();
+        isFlushing = false;
+        if (isWritten) {
+            durableLSN = batchLSN;
+            logSize += batch.size();
+            ++flushCounter;
+        } else {
+            isBroken = true;
+        }
+        flushedCondition.notify_all();
+    }
+
+    if (durableLSN < lsn) {
+        if (--numOfUnapplied == 0) {
+            appliedCondition.notify_all();
+        }
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+bool WriteAheadLog::applied()
+{
+    lock_guard<mutex> lock(logMutex);
+    if (--numOfUnapplied == 0) {
+        appliedCondition.notify_all();
+    }
+    return logSize >= WAL_CHECKPOINT_SIZE && !isCheckpointing;
+}
+
+RC WriteAheadLog::checkpoint(BufferPool &bufferPool, const FileId &fileId)
+{
+    unique_lock<mutex> lock(logMutex);
+    if (isCheckpointing || (logSize == 0 && buffer.empty())) {
+        return SUCCESS;
+    }
+    isCheckpointing = true;
+    appliedCondition.wait(lock, [this] { return numOfUnapplied == 0; });
+    uint64_t checkpointLSN = lastLSN;
+    lock.unlock();
+
+    RC rc = bufferPool.flushFile(fileId);
+    if (rc == SUCCESS) {
+        IOTimer timer(metrics.get(), IO_SYNC);
+        rc = (fdatasync(dataFd) == 0) ? SUCCESS : FAIL;
+    }
+
+    lock.lock();
+    // records logged since the pages were flushed are still needed, so the log is then kept until the next checkpoint
+    if (rc == SUCCESS && lastLSN == checkpointLSN && durableLSN == lastLSN && !isFlushing) {
+        if (ftruncate(logFd, 0) == 0) {
+            logSize = 0;
+        } else {
+            rc = FAIL;
+        }
+    }
+    isCheckpointing = false;
+    return rc;
+}
+
+void WriteAheadLog::collectCounterValues(unsigned &recordCount, unsigned &flushCount, unsigned &recoveredCount)
+{
+    lock_guard<mutex> lock(logMutex);
+    recordCount = recordCounter;
+    flushCount = flushCounter;
+    recoveredCount = recoveredCounter;
+}
+
+
+FileHandle::FileHandle()
+{
+}
+
+
+FileHandle::~FileHandle()
+{
+    closeFile();
+}
+
+RC FileHandle::openFile(const string &fileName, unsigned openFlags, shared_ptr<CompressedPageMap> pageMap,
+                        shared_ptr<FileIOMetrics> metrics)
+{
+    if (file->isOpen()) {
+        return FAIL;
+    }
+    if (file->open(fileName, openFlags, pageMap, metrics) == FAIL) {
+        return FAIL;
+    }
+    this->metrics = metrics;
+    this->fileName = fileName;
+    byte header[PAGE_SIZE];
+    if (file->getFileId(fileId) == FAIL || readFilePage(0, header) == FAIL || header[0] != FILE_ID
+        || *((uint32_t*) (header + PAGE_SIZE_OFFSET)) != PAGE_SIZE) {
+        file->close();
+        return FAIL;
+    }
+    uint64_t numOfFilePages = *((uint64_t*) (header + NUM_OF_PAGES_OFFSET));
+    PageNum freeListHead = *((PageNum*) (header + FREE_LIST_OFFSET));
+    if (numOfFilePages > MAX_NUM_OF_PAGES || freeListHead > numOfFilePages) {
+        file->close();
+        return FAIL;
+    }
+    *readPageCounter = *((uint64_t*) (header + RD_OFFSET));
+    *writePageCounter = *((uint64_t*) (header + WR_OFFSET));
+    *appendPageCounter = *((uint64_t*) (header + APP_OFFSET));
+
+    // the page count and the free pages may be shared with other handles of the file, so they are not reused
+    numOfPages = make_shared<atomic<PageNum>>((PageNum) numOfFilePages);
+    freePages = make_shared<FreePageList>();
+    freePages->head = freeListHead;
+    freePages->numOfPages = *((PageNum*) (header + NUM_OF_FREE_PAGES_OFFSET));
+    return SUCCESS;
+}
+
+
+RC FileHandle::loadFreePages()
+{
+    byte page[PAGE_SIZE];
+    PageNum filePageNum = freePages->head;
+    for (; filePageNum != 0; filePageNum = *((PageNum*) page)) {
+        if (filePageNum > *numOfPages || freePages->filePageNums.size() >= freePages->numOfPages
+            || !freePages->filePageNums.insert(filePageNum).second || readFilePage(filePageNum, page) == FAIL) {
+            freePages->filePageNums.clear();
+            return FAIL;
+        }
+    }
+    if (freePages->filePageNums.size() != freePages->numOfPages) {
+        freePages->filePageNums.clear();
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+
+RC FileHandle::closeFile()
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    if (flushPages() == FAIL) {
+        return FAIL;
+    }
+    if (hotPages) {
+        hotPages->save();
+        hotPages.reset();
+    }
+    file = make_shared<FileBackend>();
+    wal.reset();
+    metrics.reset();
+    setReadaheadWindow(readahead->window);  // drop the pages read ahead
+    return SUCCESS;
+}
+
+
+RC FileHandle::readPage(PageNum pageNum, void *data)
+{
+    IOTimer timer(metrics.get(), IO_READ_PAGE);
+    if (pageNum >= getNumberOfPages()) {
+        return FAIL;
+    }
+    if (readahead->window > 0 && readFromReadahead(pageNum, data)) {
+        ++(*readPageCounter);
+        return SUCCESS;
+    }
+    if (hotPages) {
+        hotPages->recordAccess(pageNum);
+    }
+    return (readFilePage(pageNum + 1, data) == SUCCESS) ? (++(*readPageCounter), SUCCESS) : FAIL;
+}
+
+
+RC FileHandle::readPages(PageNum startPageNum, unsigned count, void *data)
+{
+    if (!file->isOpen() || startPageNum > getNumberOfPages() || count > getNumberOfPages() - startPageNum) {
+        return FAIL;
+    }
+    for (unsigned i = 0; i < count; i += MAX_PAGES_PER_IO) {
+        unsigned numOfPages = min(count - i, MAX_PAGES_PER_IO);
+        if (readFilePages(startPageNum + i + 1, numOfPages, (byte*) data + (size_t) i * PAGE_SIZE) == FAIL) {
+            return FAIL;
+        }
+        *readPageCounter += numOfPages;
+    }
+    return SUCCESS;
+}
+
+
+RC FileHandle::writePage(PageNum pageNum, const void *data)
+{
+    IOTimer timer(metrics.get(), IO_WRITE_PAGE);
+    if (pageNum >= getNumberOfPages()) {
+        return FAIL;
+    }
+    if (hotPages) {
+        hotPages->recordAccess(pageNum);
+    }
+    return (writeFilePage(pageNum + 1, data) == SUCCESS) ? (++(*writePageCounter), SUCCESS) : FAIL;
+}
+
+
+RC FileHandle::appendPage(const void *data)
+{
+    IOTimer timer(metrics.get(), IO_APPEND_PAGE);
+    PageNum pageNum;
+    return appendNewPage(data, pageNum);
+}
+
+
+RC FileHandle::appendNewPage(const void *data, PageNum &pageNum)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    // reserve the page number first, so that concurrent appends do not write the same page
+    pageNum = (*numOfPages)++;
+    if (pageNum >= MAX_NUM_OF_PAGES || file->reservePages(pageNum + 2) == FAIL
+        || writeFilePage(pageNum + 1, data) == FAIL) {
+        PageNum expected = pageNum + 1;
+        numOfPages->compare_exchange_strong(expected, pageNum);    // roll back unless another page has been appended since
+        return FAIL;
+    }
+    ++(*appendPageCounter);
+    return SUCCESS;
+}
+
+
+unsigned FileHandle::getNumberOfPages()
+{
+    return *numOfPages;
+}
+
+
+RC FileHandle::allocatePage(const void *data, PageNum &pageNum)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    {
+        lock_guard<mutex> lock(freePages->listMutex);
+        if (freePages->head != 0) {
+            byte page[PAGE_SIZE];
+            PageNum filePageNum = freePages->head;
+            if (readFilePage(filePageNum, page) == FAIL || writeFilePage(filePageNum, data) == FAIL) {
+                return FAIL;
+            }
+            freePages->head = *((PageNum*) page);
+            --freePages->numOfPages;
+            freePages->filePageNums.erase(filePageNum);
+            ++(*writePageCounter);
+            pageNum = filePageNum - 1;
+            return SUCCESS;
+        }
+    }
+    return appendNewPage(data, pageNum);
+}
+
+
+RC FileHandle::freePage(PageNum pageNum)
+{
+    if (pageNum >= getNumberOfPages()) {
+        return FAIL;
+    }
+
+    lock_guard<mutex> lock(freePages->listMutex);
+    if (freePages->filePageNums.count(pageNum + 1) > 0) {
+        return FAIL;    // a page freed twice would be allocated twice
+    }
+    byte page[PAGE_SIZE] = {0};
+    *((PageNum*) page) = freePages->head;
+    if (writeFilePage(pageNum + 1, page) == FAIL) {
+        return FAIL;
+    }
+    ++(*writePageCounter);
+    freePages->head = pageNum + 1;
+    ++freePages->numOfPages;
+    freePages->filePageNums.insert(pageNum + 1);
+    return SUCCESS;
+}
+
+
+unsigned FileHandle::getNumberOfFreePages()
+{
+    lock_guard<mutex> lock(freePages->listMutex);
+    return freePages->numOfPages;
+}
+
+
+RC FileHandle::shrink()
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    unique_lock<mutex> lock(freePages->listMutex);
+    vector<PageNum> filePageNums;       // in list order
+    unordered_set<PageNum> freeFilePageNums;
+    byte page[PAGE_SIZE];
+    for (PageNum filePageNum = freePages->head; filePageNum != 0; filePageNum = *((PageNum*) page)) {
+        if (filePageNums.size() >= freePages->numOfPages || readFilePage(filePageNum, page) == FAIL) {
+            return FAIL;    // the list is longer than it should be
+        }
+        filePageNums.push_back(filePageNum);
+        freeFilePageNums.insert(filePageNum);
+    }
+
+    // the last page of the file is file page numOfPages
+    PageNum newNumOfPages = *numOfPages;
+    while (newNumOfPages > 0 && freeFilePageNums.count(newNumOfPages) > 0) {
+        --newNumOfPages;
+    }
+    if (newNumOfPages == *numOfPages) {
+        return SUCCESS;
+    }
+
+    // unlink the truncated pages, rewriting the link of a kept page only if its successor is truncated
+    PageNum head = 0;
+    PageNum numOfFreePages = 0;
+    for (unsigned i = filePageNums.size(); i-- > 0;) {
+        PageNum filePageNum = filePageNums[i];
+        if (filePageNum > newNumOfPages) {
+            freePages->filePageNums.erase(filePageNum);
+            continue;
+        }
+        PageNum oldNext = (i + 1 < filePageNums.size()) ? filePageNums[i + 1] : 0;
+        if (oldNext != head) {
+            memset(page, 0, PAGE_SIZE);
+            *((PageNum*) page) = head;
+            if (writeFilePage(filePageNum, page) == FAIL) {
+                return FAIL;
+            }
+        }
+        head = filePageNum;
+        ++numOfFreePages;
+    }
+    freePages->head = head;
+    freePages->numOfPages = numOfFreePages;
+    lock.unlock();
+
+    BufferPool &bufferPool = PagedFileManager::instance()->bufferPool;
+    bufferPool.discardPages(fileId, newNumOfPages + 1);
+    *numOfPages = newNumOfPages;
+    setReadaheadWindow(readahead->window);  // drop the pages read ahead
+    if (flushPages() == FAIL || file->truncate(newNumOfPages + 1) == FAIL) {
+        return FAIL;
+    }
+
+    // the log may hold images of the truncated pages, which must not be replayed
+    return wal ? wal->checkpoint(bufferPool, fileId) : SUCCESS;
+}
+
+
+RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
+{
+    readPageCount = *readPageCounter;
+    writePageCount = *writePageCounter;
+    appendPageCount = *appendPageCounter;
+    return SUCCESS;
+}
+
+RC FileHandle::collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount)
+{
+    readPageCount = *readPageCounter;
+    writePageCount = *writePageCounter;
+    appendPageCount = *appendPageCounter;
+    return SUCCESS;
+}
+
+RC FileHandle::collectLogCounterValues(unsigned &recordCount, unsigned &flushCount, unsigned &recoveredCount)
+{
+    if (!wal) {
+        recordCount = flushCount = recoveredCount = 0;
+        return SUCCESS;
+    }
+    wal->collectCounterValues(recordCount, flushCount, recoveredCount);
+    return SUCCESS;
+}
+
+RC FileHandle::collectIOMetrics(IOMetricsSnapshot &snapshot)
+{
+    if (!metrics) {
+        return FAIL;
+    }
+    metrics->collect(snapshot);
+    return SUCCESS;
+}
+
+RC FileHandle::collectReadaheadCounterValues(unsigned &fillCount, unsigned &pageCount, unsigned &hitCount)
+{
+    lock_guard<mutex> lock(readahead->ringMutex);
+    fillCount = readahead->fillCounter;
+    pageCount = readahead->pageCounter;
+    hitCount = readahead->hitCounter;
+    return SUCCESS;
+}
+
+void FileHandle::setReadaheadWindow(unsigned numOfPages)
+{
+    lock_guard<mutex> lock(readahead->ringMutex);
+    free(readahead->buffer);
+    readahead->buffer = nullptr;
+    readahead->window = min(numOfPages, MAX_PAGES_PER_IO);
+    readahead->numOfPages = 0;
+}
+
+RC FileHandle::collectBufferCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount)
+{
+    hitCount = *bufferHitCounter;
+    missCount = *bufferMissCounter;
+    evictionCount = *bufferEvictionCounter;
+    return SUCCESS;
+}
+
+bool FileHandle::isDirectIO()
+{
+    return file->isDirectIO();
+}
+
+bool FileHandle::isCompressed()
+{
+    return file->isCompressed();
+}
+
+RC FileHandle::getFileId(FileId &id)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+    id = fileId;
+    return SUCCESS;
+}
+
+const string& FileHandle::getFileName()
+{
+    return fileName;
+}
+
+RC FileHandle::submitPages(AsyncPageIO *requests, unsigned count)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    BufferPool &bufferPool = PagedFileManager::instance()->bufferPool;
+    vector<AsyncPageIO*> pendingRequests;
+    pendingRequests.reserve(count);
+    RC rc = SUCCESS;
+    for (unsigned i = 0; i < count; ++i) {
+        AsyncPageIO &request = requests[i];
+        request.result = SUCCESS;
+        request.isDone = true;
+        request.iovs.clear();
+        if (request.numOfPages == 0 || request.numOfPages > MAX_PAGES_PER_IO
+            || request.pageNum > getNumberOfPages() || request.numOfPages > getNumberOfPages() - request.pageNum) {
+            request.result = rc = FAIL;
+            continue;
+        }
+
+        byte *data = (byte*) request.data;
+        size_t length = (size_t) request.numOfPages * PAGE_SIZE;
+        if (request.isWrite && wal) {
+            for (unsigned j = 0; j < request.numOfPages && request.result == SUCCESS; ++j) {
+                request.result = writeFilePage(request.pageNum + 1 + j, data + (size_t) j * PAGE_SIZE);
+            }
+            *writePageCounter += request.numOfPages;
+            rc = (request.result == FAIL) ? FAIL : rc;
+            continue;
+        }
+        if (file->isCompressed() || (file->isDirectIO() && (uintptr_t) data % DIRECT_IO_ALIGNMENT != 0)) {
+            // the engines need aligned buffers for direct I/O, so do it synchronously through an aligned copy;
+            // neither can they transfer compressed pages, which are not at fixed offsets
+            if (request.isWrite) {
+                unique_ptr<byte, void (*)(void*)> buffer(allocateAlignedBuffer(length), free);
+                memcpy(buffer.get(), data, length);
+                for (unsigned j = 0; j < request.numOfPages; ++j) {
+                    bufferPool.updateCachedPage(fileId, request.pageNum + 1 + j, data + (size_t) j * PAGE_SIZE);
+                }
+                struct iovec iov = {buffer.get(), length};
+                request.result = file->writePages(request.pageNum + 1, &iov, 1);
+                *writePageCounter += request.numOfPages;
+            } else {
+                request.result = readFilePages(request.pageNum + 1, request.numOfPages, data);
+                *readPageCounter += request.numOfPages;
+            }
+            rc = (request.result == FAIL) ? FAIL : rc;
+            continue;
+        }
+
+        if (request.isWrite) {
+            *writePageCounter += request.numOfPages;
+            for (unsigned j = 0; j < request.numOfPages; ++j) {
+                bufferPool.updateCachedPage(fileId, request.pageNum + 1 + j, data + (size_t) j * PAGE_SIZE);
+            }
+            request.filePageNum = request.pageNum + 1;
+            request.iovs.push_back({data, length});
+        } else {
+            *readPageCounter += request.numOfPages;
+            prepareReadVector(request.pageNum + 1, request.numOfPages, data, request.filePageNum, request.iovs);
+            if (request.iovs.empty()) {     // all pages are cached
+                continue;
+            }
+        }
+        request.length = 0;
+        for (const struct iovec &iov : request.iovs) {
+            request.length += iov.iov_len;
+        }
+        request.file = file;
+        request.isDone = false;
+        file->beginAsyncTransfer(request);
+        pendingRequests.push_back(&request);
+    }
+
+    if (!pendingRequests.empty()) {
+        AsyncIOEngine *engine = PagedFileManager::instance()->getAsyncIOEngine();
+        if (engine->submit(pendingRequests.data(), pendingRequests.size()) == FAIL) {
+            rc = FAIL;
+        }
+    }
+    return rc;
+}
+
+unsigned FileHandle::pollPages(AsyncPageIO *requests, unsigned count)
+{
+    PagedFileManager::instance()->getAsyncIOEngine()->poll();
+    unsigned numOfDone = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        if (requests[i].isDone.load(memory_order_acquire)) {
+            requests[i].file.reset();
+            ++numOfDone;
+        }
+    }
+    return numOfDone;
+}
+
+RC FileHandle::waitPages(AsyncPageIO *requests, unsigned count)
+{
+    AsyncIOEngine *engine = PagedFileManager::instance()->getAsyncIOEngine();
+    RC rc = SUCCESS;
+    for (unsigned i = 0; i < count; ++i) {
+        if (!requests[i].isDone.load(memory_order_acquire)) {
+            engine->wait(requests[i]);
+        }
+        requests[i].file.reset();
+        rc = (requests[i].result == FAIL) ? FAIL : rc;
+    }
+    return rc;
+}
+
+uint64_t FileHandle::getWriteVersion()
+{
+    return PagedFileManager::instance()->bufferPool.getFileVersion(fileId);
+}
+
+bool FileHandle::isMapped()
+{
+    return file->isMapped();
+}
+
+RC FileHandle::mapPage(PageNum pageNum, const byte *&page)
+{
+    if (!file->isMapped() || pageNum >= getNumberOfPages()) {
+        return FAIL;
+    }
+    // the mapping only sees what has been written to the file
+    if (PagedFileManager::instance()->bufferPool.flushPage(fileId, pageNum + 1) == FAIL
+        || file->getMappedPage(pageNum + 1, page) == FAIL) {
+        return FAIL;
+    }
+    ++(*readPageCounter);
+    return SUCCESS;
+}
+
+RC FileHandle::adviseSequential()
+{
+    if (!file->isMapped()) {
+        return FAIL;
+    }
+    // mapping the header page maps the whole file
+    const byte *page;
+    if (file->getMappedPage(0, page) == FAIL) {
+        return FAIL;
+    }
+    return file->adviseMappedPages(0, getNumberOfPages() + 1, MADV_SEQUENTIAL);
+}
+
+RC FileHandle::prefetchMappedPages(PageNum startPageNum, unsigned count)
+{
+    if (!file->isMapped()) {
+        return FAIL;
+    }
+    count = min(count, getNumberOfPages() - min(startPageNum, getNumberOfPages()));
+    return file->adviseMappedPages(startPageNum + 1, count, MADV_WILLNEED);
+}
+
+RC FileHandle::readHeaderPage(void *data)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+    return readFilePage(0, data);
+}
+
+RC FileHandle::writeHeaderPage(const void *data)
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+    return writeFilePage(0, data);
+}
+
+RC FileHandle::flushPages()
+{
+    if (!file->isOpen()) {
+        return FAIL;
+    }
+
+    // update the header page, so that the file is consistent on disk after flushing
+    byte header[PAGE_SIZE];
+    if (readFilePage(0, header) == FAIL) {
+        return FAIL;
+    }
+    *((uint64_t*) (header + RD_OFFSET)) = *readPageCounter;
+    *((uint64_t*) (header + WR_OFFSET)) = *writePageCounter;
+    *((uint64_t*) (header + APP_OFFSET)) = *appendPageCounter;
+    *((uint64_t*) (header + NUM_OF_PAGES_OFFSET)) = *numOfPages;
+    {
+        lock_guard<mutex> lock(freePages->listMutex);
+        *((PageNum*) (header + FREE_LIST_OFFSET)) = freePages->head;
+        *((PageNum*) (header + NUM_OF_FREE_PAGES_OFFSET)) = freePages->numOfPages;
+    }
+    if (writeFilePage(0, header) == FAIL) {
+        return FAIL;
+    }
+    if (PagedFileManager::instance()->bufferPool.flushFile(fileId) == FAIL) {
+        return FAIL;
+    }
+    return file->flushPageMap();
+}
+
+RC FileHandle::readFilePage(PageNum filePageNum, void *data)
+{
+    BufferPool &bufferPool = PagedFileManager::instance()->bufferPool;
+    byte *frame = bufferPool.pinPage(*this, filePageNum, true);
+    if (frame == nullptr) {
+        return FAIL;
+    }
+    memcpy(data, frame, PAGE_SIZE);
+    bufferPool.unpinPage(fileId, filePageNum, false);
+    return SUCCESS;
+}
+
+// Cached pages are read from the file into this page and discarded
+static byte* getScratchPage()
+{
+    static byte *scratchPage = allocateAlignedBuffer(PAGE_SIZE);
+    return scratchPage;
+}
+
+void FileHandle::prepareReadVector(PageNum filePageNum, unsigned count, byte *data,
+                                   PageNum &firstFilePageNum, vector<struct iovec> &iovs)
+{
+    BufferPool &bufferPool = PagedFileManager::instance()->bufferPool;
+    iovs.clear();
+    unsigned numOfTrailingCachedPages = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        byte *page = data + (size_t) i * PAGE_SIZE;
+        if (bufferPool.readCachedPage(*this, filePageNum + i, page)) {
+            if (!iovs.empty()) {    // leading cached pages are not read at all
+                iovs.push_back({getScratchPage(), PAGE_SIZE});
+                ++numOfTrailingCachedPages;
+            }
+            continue;
+        }
+
+        ++(*bufferMissCounter);
+        if (iovs.empty()) {
+            firstFilePageNum = filePageNum + i;
+        }
+        numOfTrailingCachedPages = 0;
+        if (!iovs.empty() && (byte*) iovs.back().iov_base + iovs.back().iov_len == page) {
+            iovs.back().iov_len += PAGE_SIZE;
+        } else {
+            iovs.push_back({page, PAGE_SIZE});
+        }
+    }
+    // neither are trailing cached pages
+    iovs.resize(iovs.size() - numOfTrailingCachedPages);
+}
+
+RC FileHandle::readFilePages(PageNum filePageNum, unsigned count, byte *data)
+{
+    if (file->isDirectIO() && (uintptr_t) data % DIRECT_IO_ALIGNMENT != 0) {
+        unique_ptr<byte, void (*)(void*)> buffer(allocateAlignedBuffer((size_t) count * PAGE_SIZE), free);
+        if (readFilePages(filePageNum, count, buffer.get()) == FAIL) {
+            return FAIL;
+        }
+        memcpy(data, buffer.get(), (size_t) count * PAGE_SIZE);
+        return SUCCESS;
+    }
+
+    PageNum firstFilePageNum;
+    vector<struct iovec> iovs;
+    prepareReadVector(filePageNum, count, data, firstFilePageNum, iovs);
+    if (iovs.empty()) {
+        return SUCCESS;
+    }
+    return file->readPages(firstFilePageNum, iovs.data(), iovs.size());
+}
+
+bool FileHandle::readFromReadahead(PageNum pageNum, void *data)
+{
+    ReadaheadRing &ring = *readahead;
+    lock_guard<mutex> lock(ring.ringMutex);
+
+    ring.sequentialRun = (pageNum == ring.lastPageNum + 1) ? ring.sequentialRun + 1 : 0;
+    ring.lastPageNum = pageNum;
+    if (ring.numOfPages > 0 && pageNum >= ring.firstPageNum && pageNum - ring.firstPageNum < ring.numOfPages) {
+        if (getWriteVersion() == ring.version) {
+            memcpy(data, ring.buffer + (size_t) (pageNum - ring.firstPageNum) * PAGE_SIZE, PAGE_SIZE);
+            ++ring.hitCounter;
+            return true;
+        }
+        ring.numOfPages = 0;    // the file has been modified since the ring was filled
+    }
+    if (ring.sequentialRun < READAHEAD_TRIGGER) {
+        return false;
+    }
+
+    if (ring.buffer == nullptr) {
+        ring.buffer = allocateAlignedBuffer((size_t) ring.window * PAGE_SIZE);
+    }
+    unsigned count = min(ring.window, getNumberOfPages() - pageNum);
+    uint64_t version = getWriteVersion();
+    if (readFilePages(pageNum + 1, count, ring.buffer) == FAIL) {
+        ring.numOfPages = 0;
+        return false;
+    }
+    ring.firstPageNum = pageNum;
+    ring.numOfPages = count;
+    ring.version = version;
+    ++ring.fillCounter;
+    ring.pageCounter += count;
+    memcpy(data, ring.buffer, PAGE_SIZE);
+    return true;
+}
+
+RC FileHandle::writeFilePage(PageNum filePageNum, const void *data)
+{
+    // the page is logged before it is pinned: a frame pinned without loading holds another page until it is
+    // overwritten, so it must not be given up if the write fails
+    if (wal && wal->logPages(filePageNum, data, 1) == FAIL) {
+        return FAIL;
+    }
+    // the whole page is overwritten, so there is no need to read it from the file on a miss
+    BufferPool &bufferPool = PagedFileManager::instance()->bufferPool;
+    byte *frame = bufferPool.pinPage(*this, filePageNum, false);
+    if (frame == nullptr) {
+        if (wal) {
+            wal->applied();     // the logged page is replayed if the process crashes before it is written again
+        }
+        return FAIL;
+    }
+    memcpy(frame, data, PAGE_SIZE);
+    bufferPool.unpinPage(fileId, filePageNum, true);
+    if (wal && wal->applied()) {
+        return wal->checkpoint(bufferPool, fileId);
+    }
+    return SUCCESS;
 }
@@ -1,11 +1,22 @@
 #ifndef _pfm_h_
 #define _pfm_h_
 
+#include <atomic>
 #include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <iostream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 using namespace std;
 
@@ -13,64 +24,839 @@ typedef unsigned PageNum;
 typedef int RC;
 typedef char byte;
 
-#define PAGE_SIZE 4096
+// The page size is chosen at build time (-DCS222_PAGE_SIZE=8192 etc.) and is the same for every layer.
+// It is stored in the header page of each file, and a file created with another page size cannot be opened.
+#ifndef CS222_PAGE_SIZE
+#define CS222_PAGE_SIZE 4096
+#endif
+constexpr int PAGE_SIZE = CS222_PAGE_SIZE;
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 65536 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+              "The page size must be 4, 8, 16, 32 or 64 KB");
+
 #define SUCCESS 0
 #define FAIL (-1)
 const byte FILE_ID = 0xaa;
+const PageNum MAX_NUM_OF_PAGES = UINT_MAX - 2;  // pages per file (16 TB of 4 KB pages); the top page numbers are sentinels
+const unsigned DEFAULT_NUM_OF_FRAMES = 1024;    // default capacity of the buffer pool (in pages)
+const unsigned DIRECT_IO_ALIGNMENT = 4096;      // alignment of buffers, offsets and sizes required by O_DIRECT
+
+// flags for opening a file (can be combined with |)
+const unsigned OPEN_DEFAULT = 0x0;
+const unsigned OPEN_DIRECT_IO = 0x1;            // bypass the OS page cache (O_DIRECT)
+const unsigned OPEN_MMAP = 0x2;                 // map the file into memory for zero-copy reads (not with OPEN_DIRECT_IO)
+const unsigned OPEN_NO_PREALLOCATION = 0x4;     // grow a direct I/O file one page at a time instead of by extents
+const unsigned OPEN_WAL = 0x8;                  // log every page write before it is applied, so that it survives a crash
+const unsigned OPEN_PREALLOCATE = 0x10;         // reserve extents for a buffered file as well
+
+// flags for creating a file
+const unsigned CREATE_DEFAULT = 0x0;
+const unsigned CREATE_COMPRESSED = 0x1;         // store the pages compressed (not with OPEN_DIRECT_IO, OPEN_MMAP or OPEN_WAL)
+const unsigned COMPRESSED_SLOT_UNIT = 256;      // the slot of a compressed page is a multiple of this many bytes
+const uint64_t WAL_CHECKPOINT_SIZE = 64 << 20;  // a log larger than this is checkpointed and emptied
+const size_t MIN_EXTENT_SIZE = 8 << 20;         // space reserved on disk ahead of appended pages; each extent is as large
+const size_t MAX_EXTENT_SIZE = 64 << 20;        // as the space already allocated, between these bounds
+const size_t MIN_MAPPING_SIZE = 1 << 20;        // initial size of the address space reserved for a mapped file
+const unsigned MAX_PAGES_PER_IO = 256;          // max number of pages read or written by one request
+const size_t ARENA_CHUNK_SIZE = 2 << 20;        // the page arena maps memory by chunks of one huge page
+const unsigned HOT_PAGE_LIST_SIZE = 1024;       // number of the most accessed pages of a file prefetched when it is reopened
+const unsigned HOT_PAGE_SAVE_INTERVAL = 256;    // accesses recorded before the hot page list is rewritten on close
+const unsigned MAX_NUM_OF_HOT_PAGE_COUNTS = 1 << 16;    // the access counts are halved when more pages are counted
+
+// readahead of FileHandle::readPage()
+const unsigned DEFAULT_READAHEAD_WINDOW = 32;   // number of pages read at once when a handle reads sequentially
+const unsigned READAHEAD_TRIGGER = 2;           // number of sequential reads before readahead starts
+
+// engines for asynchronous page I/O
+const unsigned ASYNC_IO_AUTO = 0;               // io_uring if the kernel supports it, otherwise a thread pool
+const unsigned ASYNC_IO_URING = 1;
+const unsigned ASYNC_IO_THREAD_POOL = 2;
+const unsigned ASYNC_IO_QUEUE_DEPTH = 64;       // number of submission queue entries of io_uring
+const unsigned NUM_OF_ASYNC_IO_THREADS = 4;     // number of workers of the thread pool engine
 
 class FileHandle;
+class FileBackend;
+class CompressedPageMap;
+class HotPageList;
+struct FreePageList;
+
+// Kinds of I/O timed for each file
+enum IOOperation
+{
+    IO_READ_PAGE = 0,           // FileHandle::readPage(), whether the page is cached or not
+    IO_WRITE_PAGE,              // FileHandle::writePage()
+    IO_APPEND_PAGE,             // FileHandle::appendPage()
+    IO_DISK_READ,               // a read of pages from the file, synchronous or asynchronous
+    IO_DISK_WRITE,              // a write of pages to the file, synchronous or asynchronous
+    IO_SYNC,                    // an fsync()/fdatasync() of the file or of its log
+    NUM_OF_IO_OPERATIONS
+};
+
+const char* getIOOperationName(unsigned operation);
+
+// bucket i of a latency histogram counts the operations which took [2^(i-1), 2^i) ns (bucket 0 those under 1 ns)
+const unsigned NUM_OF_LATENCY_BUCKETS = 40;
+
+struct LatencyHistogram
+{
+    uint64_t count = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+    uint64_t buckets[NUM_OF_LATENCY_BUCKETS] = {0};
+
+    // Upper bound of the latency of the given fraction (0 to 1) of the operations, at the precision of a bucket
+    uint64_t getPercentile(double fraction) const;
+};
+
+// Point-in-time copy of the I/O metrics of a file
+struct IOMetricsSnapshot
+{
+    string fileName;
+    LatencyHistogram latencies[NUM_OF_IO_OPERATIONS];
+    uint64_t bytesRead = 0;         // bytes of pages read from the file
+    uint64_t bytesWritten = 0;      // bytes of pages written to the file
+    unsigned queueDepth = 0;        // disk reads and writes in flight
+    unsigned maxQueueDepth = 0;
+};
+
+// I/O metrics of a file since it was first opened, shared by its handles, its backends and its log.
+// They are updated with atomics only, so recording never blocks the I/O path. Not persisted.
+class FileIOMetrics
+{
+public:
+    FileIOMetrics(const string &fileName);
+
+    FileIOMetrics(const FileIOMetrics&) = delete;
+    FileIOMetrics& operator=(const FileIOMetrics&) = delete;
+
+    void recordLatency(IOOperation operation, uint64_t nanos);
+
+    // A disk transfer starts / ends after the given time; bytes is the number of bytes transferred (0 if it failed)
+    void beginTransfer();
+    void endTransfer(bool isWrite, uint64_t bytes, uint64_t nanos);
+
+    void collect(IOMetricsSnapshot &snapshot) const;
+    void reset();
+
+private:
+    struct Histogram
+    {
+        atomic<uint64_t> count;
+        atomic<uint64_t> totalNanos;
+        atomic<uint64_t> maxNanos;
+        atomic<uint64_t> buckets[NUM_OF_LATENCY_BUCKETS];
+    };
+
+    const string fileName;
+    Histogram histograms[NUM_OF_IO_OPERATIONS];
+    atomic<uint64_t> bytesRead;
+    atomic<uint64_t> bytesWritten;
+    atomic<unsigned> queueDepth{0};
+    atomic<unsigned> maxQueueDepth;
+};
+
+// An asynchronous read or write of consecutive pages, submitted by FileHandle::submitPages().
+// The request object and its data buffer must stay valid until the request is done.
+class AsyncPageIO
+{
+    friend class FileHandle;
+    friend class FileBackend;
+    friend class IoUringEngine;
+    friend class ThreadPoolEngine;
+
+public:
+    PageNum pageNum = 0;
+    unsigned numOfPages = 1;            // the request covers [pageNum, pageNum + numOfPages), at most MAX_PAGES_PER_IO
+    void *data = nullptr;               // numOfPages * PAGE_SIZE bytes
+    bool isWrite = false;
+
+    // set when the request completes
+    atomic<bool> isDone{true};
+    RC result = SUCCESS;
+
+private:
+    shared_ptr<FileBackend> file;       // keep the file open while the request is in flight
+    PageNum filePageNum = 0;            // first page of the file to transfer
+    vector<struct iovec> iovs;
+    size_t length = 0;                  // number of bytes to transfer
+    uint64_t submitNanos = 0;           // time of submission, for the I/O metrics
+};
+
+// Interface of the engines which execute asynchronous page requests
+class AsyncIOEngine
+{
+public:
+    virtual ~AsyncIOEngine() {}
+
+    // Start the given requests. A request which cannot be started is completed with FAIL.
+    virtual RC submit(AsyncPageIO **requests, unsigned count) = 0;
+
+    // Complete the finished requests without blocking
+    virtual void poll() = 0;
+
+    // Block until the given request is done
+    virtual void wait(AsyncPageIO &request) = 0;
+
+    virtual unsigned getType() const = 0;
+};
+
+// Identity of a file on disk. FileHandles opened separately on the same file share the same FileId,
+// so that they also share the cached pages in the buffer pool.
+struct FileId
+{
+    dev_t device = 0;
+    ino_t inode = 0;
+
+    bool operator==(const FileId &other) const
+    {
+        return device == other.device && inode == other.inode;
+    }
+};
+
+struct FileIdHash
+{
+    size_t operator()(const FileId &fileId) const
+    {
+        return hash<dev_t>()(fileId.device) * 31 + hash<ino_t>()(fileId.inode);
+    }
+};
+
+// Page I/O on a raw file descriptor. Reads and writes are positional (pread/pwrite), so there is no shared
+// seek state and a backend can be used by copies of a FileHandle and by multiple threads at the same time.
+// The descriptor is closed when the last owner (FileHandle or buffer frame) releases the backend.
+class FileBackend
+{
+public:
+    FileBackend();
+    ~FileBackend();
+
+    // The pages of a compressed file go through its page map (see CompressedPageMap).
+    // The disk transfers and syncs are recorded in metrics if given.
+    RC open(const string &fileName, unsigned openFlags, shared_ptr<CompressedPageMap> pageMap = nullptr,
+            shared_ptr<FileIOMetrics> metrics = nullptr);
+    void close();
+    bool isOpen() const;
+    bool isDirectIO() const;
+    bool isCompressed() const;
+    RC getFileId(FileId &fileId) const;
+    int getFd() const { return fd; }
+    bool isMapped() const;
+
+    // Read/write the given page of the file (page 0 is the hidden header page).
+    // In direct I/O mode, a buffer which is not aligned to DIRECT_IO_ALIGNMENT goes through an aligned copy.
+    RC readPage(PageNum filePageNum, void *data);
+    RC writePage(PageNum filePageNum, const void *data);
+
+    // Read/write consecutive pages starting at filePageNum with one vectored call (preadv/pwritev).
+    // In direct I/O mode, all buffers must be aligned.
+    RC readPages(PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs);
+    RC writePages(PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs);
+
+    // Force the written pages to the storage device
+    RC sync();
+
+    // Write the page map of a compressed file (nothing to do for other files)
+    RC flushPageMap();
+
+    // Make sure that disk space is allocated for the first numOfFilePages pages. Space is reserved by extents
+    // (fallocate without changing the file size), so that appended pages are laid out contiguously and
+    // written back without extending the allocation each time. Fails if the disk is full.
+    RC reservePages(PageNum numOfFilePages);
+
+    // Cut the file after its first numOfFilePages pages, releasing their disk space and the space reserved beyond
+    RC truncate(PageNum numOfFilePages);
+
+    // Return a pointer to the given page in the mapping of the file. The mapping is extended when the page is
+    // beyond it; the old mapping is kept until the backend is closed, so earlier pointers stay valid.
+    RC getMappedPage(PageNum filePageNum, const byte *&page);
+
+    // madvise() the pages [filePageNum, filePageNum + count) of the mapping
+    RC adviseMappedPages(PageNum filePageNum, unsigned count, int advice);
+
+    // posix_fadvise() the given pages of the file (sorted), by runs of consecutive pages.
+    // Nothing is done for a compressed file, whose pages have no fixed offset.
+    RC adviseFilePages(const vector<PageNum> &filePageNums, int advice);
+
+    // Record an asynchronous transfer, which does not go through readPages()/writePages()
+    void beginAsyncTransfer(AsyncPageIO &request);
+    void endAsyncTransfer(const AsyncPageIO &request, RC result);
+
+private:
+    friend class ThreadPoolEngine;
+
+    int fd = -1;
+    bool directIO = false;
+    shared_ptr<CompressedPageMap> pageMap;
+    shared_ptr<FileIOMetrics> metrics;
+
+    // Record a transfer in the metrics: beginTransfer() returns its start time and endTransfer() returns rc
+    uint64_t beginTransfer();
+    RC endTransfer(bool isWrite, uint64_t bytes, uint64_t beginNanos, RC rc);
+
+    // Unrecorded transfers behind readPage()/writePage() and readPages()/writePages()
+    RC transferPage(bool isWrite, PageNum filePageNum, void *data);
+    RC transferPages(bool isWrite, PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs);
+
+    // Transfer whole pages of the I/O vector one by one through the page map
+    RC transferCompressedPages(bool isWrite, PageNum filePageNum, const struct iovec *iovs, unsigned numOfIovs);
+
+    mutex extentMutex;
+    bool preallocating = false;             // false if disabled or not supported by the file system
+    atomic<uint64_t> allocatedSize{0};      // bytes of the file known to have disk space
+
+    mutex mappingMutex;
+    bool mapped = false;
+    byte *mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t fileSize = 0;        // known size of the file, refreshed when a page beyond it is requested
+    vector<pair<byte*, size_t>> retiredMappings;
+
+    void unmap();
+};
+
+// Allocate a buffer aligned to DIRECT_IO_ALIGNMENT; release it with free()
+byte* allocateAlignedBuffer(size_t size);
+
+// Allocator of page buffers shared by all layers. Memory is mapped by ARENA_CHUNK_SIZE-aligned chunks, so that each
+// chunk can be backed by one huge page: a reserved huge page (MAP_HUGETLB) if the system has any, otherwise a
+// transparent huge page (MADV_HUGEPAGE). Chunks are carved into buffers of a power-of-two number of pages, and released
+// buffers are kept on a free list per size class, so that they are reused without going back to the system.
+// Buffers larger than a chunk are mapped and unmapped on their own. Every buffer is aligned to DIRECT_IO_ALIGNMENT.
+class PageArena
+{
+public:
+    static PageArena& instance();
+
+    // Return a buffer of at least size bytes; release() must be given the same size
+    byte* allocate(size_t size);
+    void release(byte *buffer, size_t size);
+
+    // mappedBytes: memory mapped by the arena, of which hugeTLBBytes are reserved huge pages;
+    // reuseCount: allocations served from a free list
+    void collectCounterValues(uint64_t &mappedBytes, uint64_t &hugeTLBBytes, uint64_t &allocationCount,
+                              uint64_t &reuseCount);
+
+private:
+    static const unsigned NUM_OF_SIZE_CLASSES = __builtin_ctzll(ARENA_CHUNK_SIZE / PAGE_SIZE) + 1;  // 1 page to a chunk
+
+    mutex arenaMutex;
+    byte *freeLists[NUM_OF_SIZE_CLASSES] = {nullptr};   // linked through the first bytes of the free buffers
+    byte *chunkCursor = nullptr;                        // unused part of the last chunk
+    size_t chunkRemaining = 0;
+    bool isHugeTLBAvailable = true;
+    unordered_set<byte*> hugeTLBMappings;              // buffers larger than a chunk backed by reserved huge pages
+
+    uint64_t mappedBytes = 0;
+    uint64_t hugeTLBBytes = 0;
+    uint64_t allocationCount = 0;
+    uint64_t reuseCount = 0;
+
+    PageArena() {}
+
+    // Map size bytes (a multiple of ARENA_CHUNK_SIZE) aligned to ARENA_CHUNK_SIZE; nullptr if out of memory
+    byte* mapChunks(size_t size, bool &isHugeTLB);
+
+    // Size class of a buffer of the given size, NUM_OF_SIZE_CLASSES if it is larger than a chunk
+    static unsigned getSizeClass(size_t size);
+};
+
+// A buffer of whole pages from the PageArena, released when it goes out of scope
+class PageBuffer
+{
+public:
+    explicit PageBuffer(size_t size = PAGE_SIZE): size(size), buffer(PageArena::instance().allocate(size)) {}
+    ~PageBuffer() { PageArena::instance().release(buffer, size); }
+
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+
+    byte* get() const { return buffer; }
+
+private:
+    size_t size;
+    byte *buffer;
+};
+
+// Built-in LZ77 codec of compressed files, with an LZ4-like block format: each sequence is a token (4 bits of literal
+// length, 4 bits of match length), the literals, then a 16-bit offset back into the output and the match.
+// lzCompress() returns the compressed size, or 0 if it would exceed dstCapacity. lzDecompress() fails unless the
+// block decodes to exactly dstSize bytes.
+size_t lzCompress(const byte *src, size_t srcSize, byte *dst, size_t dstCapacity);
+RC lzDecompress(const byte *src, size_t srcSize, byte *dst, size_t dstSize);
+
+// Location of the pages of a compressed file, shared by all its handles. The header page stays uncompressed at the
+// start of the file; every other page is compressed into a slot of COMPRESSED_SLOT_UNIT-byte units after it (or kept
+// raw if it does not compress). A page is rewritten in place while it fits in its slot, otherwise it moves to a free
+// run or to the end of the file. The map is kept in "<file name>.pmap" and replaced when the file is flushed; until
+// then the slots it points to are never overwritten, so that a crash leaves the pages as they were last flushed.
+class CompressedPageMap
+{
+public:
+    CompressedPageMap() {}
+    ~CompressedPageMap();
+
+    CompressedPageMap(const CompressedPageMap&) = delete;
+    CompressedPageMap& operator=(const CompressedPageMap&) = delete;
+
+    RC open(const string &fileName);
+
+    // Read/write the given page (not the header page) of the data file fd
+    RC readPage(int fd, PageNum filePageNum, void *data);
+    RC writePage(int fd, PageNum filePageNum, const void *data);
+
+    // Drop the pages from numOfFilePages on and cut the data file after the last slot in use (their slots are only
+    // released by the next flush)
+    RC truncate(int fd, PageNum numOfFilePages);
+
+    // Sync the data file and replace the map file if the map has changed, then cut the data file after the last slot
+    RC flush();
+
+    static string getMapFileName(const string &fileName) { return fileName + ".pmap"; }
+
+private:
+    struct Slot
+    {
+        uint64_t offset;
+        uint32_t length;            // compressed size; PAGE_SIZE if the page is stored raw, 0 if never written
+        uint32_t capacity;
+    };
+
+    string mapFileName;
+    int dataFd = -1;                            // to sync and cut the data file when the map is written
+    mutex mapMutex;
+    vector<Slot> slots;                         // indexed by file page number (slot 0 is unused)
+    vector<Slot> durableSlots;                  // the map in the map file
+    multimap<uint64_t, uint64_t> freeRuns;      // size -> offset of the unused space between slots
+    uint64_t endOffset = PAGE_SIZE;             // end of the last slot
+    bool isDirty = false;
+
+    // Recompute the free runs and the end of the slots from the map and the map on disk
+    void rebuildFreeRuns();
+
+    uint64_t allocateRun(uint64_t size);
+};
+
+// Access counts of the pages of a file which are read or written one at a time (FileHandle::readPage()/writePage()
+// not served by readahead), shared by all its handles; scans read by batches, so they do not wash out the hot set.
+// The HOT_PAGE_LIST_SIZE most accessed pages are kept in "<file name>.hot" when the file is closed and at exit, and are
+// prefetched into the OS page cache when the next process first opens the file.
+class HotPageList
+{
+public:
+    HotPageList(const string &fileName): fileName(fileName) {}
+
+    HotPageList(const HotPageList&) = delete;
+    HotPageList& operator=(const HotPageList&) = delete;
+
+    static string getListFileName(const string &fileName) { return fileName + ".hot"; }
+
+    void recordAccess(PageNum pageNum);
+
+    // Read the list written by the last process, hottest page first. The pages are counted as accessed once,
+    // so that they are not dropped from the list if this process closes the file soon.
+    RC load(vector<PageNum> &pageNums);
+
+    // Write the list if at least minNumOfAccesses accesses have been recorded since it was last written
+    RC save(uint64_t minNumOfAccesses = HOT_PAGE_SAVE_INTERVAL);
+
+    // The most accessed pages, hottest first
+    void getHotPages(vector<PageNum> &pageNums, unsigned maxNumOfPages = HOT_PAGE_LIST_SIZE);
+
+private:
+    const string fileName;
+    mutex listMutex;
+    unordered_map<PageNum, uint32_t> accessCounts;
+    uint64_t numOfUnsavedAccesses = 0;
+};
+
+// Process-wide page cache shared by all open files.
+// A page is pinned while it is being accessed and cannot be evicted until it is unpinned.
+// Dirty pages are written back to their file when they are evicted or flushed explicitly.
+// Victims are chosen by the clock (second chance) replacement policy.
+// A page is read on a miss, and a dirty victim written back, without holding the pool lock: the frame is pinned and
+// marked in transit meanwhile, and other requesters of the page wait until the I/O is done.
+class BufferPool
+{
+public:
+    BufferPool(unsigned numOfFrames);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Pin the given page of the file (page 0 is the hidden header page) and return its frame.
+    // If the page is not cached and loadPage is true, the page is read from the file.
+    // Return nullptr if the page cannot be read or all frames are pinned.
+    byte* pinPage(FileHandle &fileHandle, PageNum filePageNum, bool loadPage);
+
+    void unpinPage(const FileId &fileId, PageNum filePageNum, bool isDirty);
+
+    // Write all dirty pages of the given file back to disk
+    RC flushFile(const FileId &fileId);
+
+    // Write the given page back to disk if it is cached and dirty
+    RC flushPage(const FileId &fileId, PageNum filePageNum);
+
+    // Write all dirty pages back to disk
+    RC flushAll();
+
+    // Drop all cached pages of the given file without writing them back (e.g., the file has been destroyed)
+    void discardFile(const FileId &fileId);
+
+    // Drop the cached pages of the given file from firstFilePageNum on without writing them back (e.g., the file is
+    // being truncated)
+    void discardPages(const FileId &fileId, PageNum firstFilePageNum);
+
+    // Change the number of frames. All dirty pages are flushed first and no page may be pinned.
+    RC resize(unsigned numOfFrames);
+
+    unsigned getNumberOfFrames();
+
+    // Copy the given page into data if it is cached. Return false if it is not cached.
+    bool readCachedPage(FileHandle &fileHandle, PageNum filePageNum, void *data);
+
+    // Overwrite the given page if it is cached (the page is being written to the file directly)
+    void updateCachedPage(const FileId &fileId, PageNum filePageNum, const void *data);
+
+    // Return a number which changes whenever a page of the given file is modified
+    uint64_t getFileVersion(const FileId &fileId);
+
+private:
+    struct FrameKey
+    {
+        FileId fileId;
+        PageNum filePageNum;
+
+        bool operator==(const FrameKey &other) const
+        {
+            return fileId == other.fileId && filePageNum == other.filePageNum;
+        }
+    };
+
+    struct FrameKeyHash
+    {
+        size_t operator()(const FrameKey &key) const
+        {
+            return FileIdHash()(key.fileId) * 31 + hash<PageNum>()(key.filePageNum);
+        }
+    };
+
+    struct Frame
+    {
+        FrameKey key;
+        shared_ptr<FileBackend> file;   // the file used to write back this page when it is dirty
+        unsigned pinCount = 0;
+        bool isValid = false;
+        bool isDirty = false;
+        bool isReferenced = false;  // reference bit of the clock policy
+        bool isInTransit = false;   // the page is being read into the frame or written back from it
+    };
+
+    mutex poolMutex;
+    condition_variable transitCondition;    // signaled when the I/O of a frame in transit is done
+    vector<Frame> frames;
+    byte *frameData = nullptr;      // from the page arena, aligned so that frames can be the target of direct I/O
+    unordered_map<FrameKey, unsigned, FrameKeyHash> pageTable;     // (file, page) -> frame number
+    unordered_map<FileId, uint64_t, FileIdHash> fileVersions;
+    unsigned clockHand = 0;
+
+    byte* getFrameData(unsigned frameNum)
+    {
+        return frameData + (size_t) frameNum * PAGE_SIZE;
+    }
+
+    // Wait until the frame of the given page, if it is cached, is not in transit and return its entry
+    unordered_map<FrameKey, unsigned, FrameKeyHash>::iterator waitForTransit(const FrameKey &key,
+                                                                             unique_lock<mutex> &lock);
+
+    // Return the number of a free frame or of the (possibly dirty) frame to evict, or frames.size() if all frames are
+    // pinned
+    unsigned findVictim();
+
+    RC writeBack(unsigned frameNum);
+
+    // Write the frame back if it is dirty, releasing the lock during the write
+    RC writeBackInTransit(unsigned frameNum, unique_lock<mutex> &lock);
+};
+
+// Redo log of a file, kept in "<file name>.wal" next to it. Each record is the after-image of a page, tagged with an LSN.
+// A page write is logged and made durable before it reaches the buffer pool, so a dirty page never needs a log flush
+// to be written back. Concurrent writers share one fdatasync() of the log (group commit): while one writer syncs a
+// batch, the records of the others are buffered and synced together by the next one.
+class WriteAheadLog
+{
+public:
+    WriteAheadLog() {}
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Open the log of the given file, first replaying the records left by a crash into the file.
+    // The syncs of the log and of the file are recorded in metrics if given.
+    RC open(const string &fileName, shared_ptr<FileIOMetrics> metrics = nullptr);
+
+    // Log the after-images of the consecutive pages starting at filePageNum, and wait until they are durable.
+    // On success, applied() must be called once the pages are in the buffer pool.
+    RC logPages(PageNum filePageNum, const void *data, unsigned count);
+
+    // Return true if the log should be checkpointed
+    bool applied();
+
+    // Write the dirty pages of the file back, sync the file and empty the log
+    RC checkpoint(BufferPool &bufferPool, const FileId &fileId);
+
+    void collectCounterValues(unsigned &recordCount, unsigned &flushCount, unsigned &recoveredCount);
+
+    static string getLogFileName(const string &fileName) { return fileName + ".wal"; }
+
+    // Return true if the log of the given file holds records to be replayed
+    static bool hasRecords(const string &fileName);
+
+private:
+    struct RecordHeader
+    {
+        uint64_t lsn;
+        PageNum filePageNum;
+        uint32_t checksum;          // of the LSN, the page number and the page
+    };
+
+    int logFd = -1;
+    int dataFd = -1;
+    shared_ptr<FileIOMetrics> metrics;
+
+    mutex logMutex;
+    condition_variable flushedCondition;    // signaled when a batch has been synced
+    condition_variable appliedCondition;    // signaled when no logged page is waiting to be applied
+    vector<byte> buffer;                    // records not written to the log file yet
+    uint64_t lastLSN = 0;                   // LSN of the last record logged
+    uint64_t durableLSN = 0;                // LSN of the last record synced
+    bool isFlushing = false;
+    bool isBroken = false;                  // the log could not be written; no write can be logged any more
+    bool isCheckpointing = false;
+    unsigned numOfUnapplied = 0;
+    uint64_t logSize = 0;
+
+    unsigned recordCounter = 0;
+    unsigned flushCounter = 0;
+    unsigned recoveredCounter = 0;
+
+    static uint32_t computeChecksum(const RecordHeader &header, const byte *page);
+
+    RC recover();
+};
 
 class PagedFileManager
 {
+    friend class FileHandle;
+
 public:
     static PagedFileManager* instance();                                  // Access to the _pf_manager instance
 
-    RC createFile    (const string &fileName);                            // Create a new file
+    RC createFile    (const string &fileName,
+                      unsigned createFlags = CREATE_DEFAULT);             // Create a new file
     RC destroyFile   (const string &fileName);                            // Destroy a file
-    RC openFile      (const string &fileName, FileHandle &fileHandle);    // Open a file
+    RC openFile      (const string &fileName, FileHandle &fileHandle,
+                      unsigned openFlags = OPEN_DEFAULT);                 // Open a file
     RC closeFile     (FileHandle &fileHandle);                            // Close a file
 
+    RC setBufferPoolSize(unsigned numOfFrames);                           // Change the number of frames in the buffer pool
+    RC flushAllPages();                                                   // Write all dirty pages back to disk
+    RC shrinkFile(const string &fileName);                                // Return the free pages at the end of a closed file
+
+    // Snapshot the I/O metrics of every file opened since it was created or since the process started
+    RC collectIOMetrics(vector<IOMetricsSnapshot> &snapshots);
+    void resetIOMetrics();
+
+    // Write the hot page list of every file with accesses not yet saved (done at exit)
+    RC saveHotPageLists();
+
+    // Select the engine for asynchronous page I/O (ASYNC_IO_*). No request may be in flight.
+    RC setAsyncIOEngine(unsigned engineType);
+    unsigned getAsyncIOEngineType();
+
 protected:
     PagedFileManager();                                                   // Constructor
     ~PagedFileManager();                                                  // Destructor
 
 private:
     static PagedFileManager *_pf_manager;
+
+    BufferPool bufferPool;
+
+    mutex engineMutex;
+    unique_ptr<AsyncIOEngine> asyncIOEngine;    // created on first use
+
+    mutex logsMutex;
+    unordered_map<FileId, shared_ptr<WriteAheadLog>, FileIdHash> logs;     // files with a write-ahead log
+
+    mutex pageMapsMutex;
+    unordered_map<FileId, shared_ptr<CompressedPageMap>, FileIdHash> pageMaps;     // compressed files opened so far
+
+    mutex metricsMutex;
+    unordered_map<FileId, shared_ptr<FileIOMetrics>, FileIdHash> ioMetrics;       // files opened so far
+
+    mutex hotPagesMutex;
+    unordered_map<FileId, shared_ptr<HotPageList>, FileIdHash> hotPageLists;     // files opened so far
+
+    // Forget the state kept for a file which is created or destroyed
+    void forgetFile(const FileId &fileId);
+
+    // The state of an open file which is persisted in its header page is shared by all its handles,
+    // so that a handle never writes back a stale page count or free page list
+    struct SharedFileState
+    {
+        weak_ptr<atomic<PageNum>> numOfPages;
+        weak_ptr<FreePageList> freePages;
+    };
+    mutex openFilesMutex;
+    unordered_map<FileId, SharedFileState, FileIdHash> openFiles;
+
+    AsyncIOEngine* getAsyncIOEngine();
 };
 
 
+// Pages read ahead by a FileHandle which reads sequentially
+struct ReadaheadRing
+{
+    mutex ringMutex;
+    unsigned window = DEFAULT_READAHEAD_WINDOW;     // 0 disables readahead
+    byte *buffer = nullptr;
+    PageNum firstPageNum = 0;
+    unsigned numOfPages = 0;
+    uint64_t version = 0;                   // write version of the file when the ring was filled
+    PageNum lastPageNum = UINT_MAX - 1;     // the last page read by readPage()
+    unsigned sequentialRun = 0;             // number of sequential reads up to the last one
+
+    unsigned fillCounter = 0;               // number of readahead I/Os
+    unsigned pageCounter = 0;               // number of pages read ahead
+    unsigned hitCounter = 0;                // number of readPage() calls served by the ring
+
+    ~ReadaheadRing() { free(buffer); }
+};
+
+// Pages given back by FileHandle::freePage(), linked through their first bytes. The head and the number of pages
+// are stored in the header page. The list is walked when the file is first opened, so that a broken list is found
+// then and a page already on it is not freed twice.
+struct FreePageList
+{
+    mutex listMutex;
+    PageNum head = 0;                       // file page number of the first free page (0 if none)
+    PageNum numOfPages = 0;
+    unordered_set<PageNum> filePageNums;    // the pages on the list
+};
+
 class FileHandle
 {
     friend class PagedFileManager;
+    friend class BufferPool;
+    friend class WriteAheadLog;
 
 public:
     // variables to keep the counter for each operation
-    shared_ptr<unsigned> readPageCounter = make_shared<unsigned>(0);
-    shared_ptr<unsigned> writePageCounter = make_shared<unsigned>(0);
-    shared_ptr<unsigned> appendPageCounter = make_shared<unsigned>(0);
-    shared_ptr<unsigned> numOfPages = make_shared<unsigned>(0);
+    shared_ptr<atomic<uint64_t>> readPageCounter = make_shared<atomic<uint64_t>>(0);
+    shared_ptr<atomic<uint64_t>> writePageCounter = make_shared<atomic<uint64_t>>(0);
+    shared_ptr<atomic<uint64_t>> appendPageCounter = make_shared<atomic<uint64_t>>(0);
+    shared_ptr<atomic<PageNum>> numOfPages = make_shared<atomic<PageNum>>(0);
+
+    // variables to keep the counter for buffer pool activity caused by this file (not persisted)
+    shared_ptr<atomic<unsigned>> bufferHitCounter = make_shared<atomic<unsigned>>(0);
+    shared_ptr<atomic<unsigned>> bufferMissCounter = make_shared<atomic<unsigned>>(0);
+    shared_ptr<atomic<unsigned>> bufferEvictionCounter = make_shared<atomic<unsigned>>(0);
     
     FileHandle();                                                         // Default constructor
     ~FileHandle();                                                        // Destructor
 
     RC readPage(PageNum pageNum, void *data);                             // Get a specific page
+    RC readPages(PageNum startPageNum, unsigned count, void *data);       // Get consecutive pages with vectored I/O
     RC writePage(PageNum pageNum, const void *data);                      // Write a specific page
     RC appendPage(const void *data);                                      // Append a specific page
     unsigned getNumberOfPages();                                          // Get the number of pages in the file
+
+    // Free page management. allocatePage() writes the page into a freed page if there is one, otherwise appends it.
+    // shrink() truncates the free pages at the end of the file; no page may be appended to the file meanwhile.
+    RC allocatePage(const void *data, PageNum &pageNum);
+    RC freePage(PageNum pageNum);
+    unsigned getNumberOfFreePages();
+    RC shrink();
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);  // Put the current counter values into variables
+    RC collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount);  // Same, without truncating to 32 bits
+    RC collectBufferCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount);
+    RC collectReadaheadCounterValues(unsigned &fillCount, unsigned &pageCount, unsigned &hitCount);
+    RC collectLogCounterValues(unsigned &recordCount, unsigned &flushCount, unsigned &recoveredCount);
+    RC collectIOMetrics(IOMetricsSnapshot &snapshot);                     // Latencies, bytes and queue depth of the file's I/O
+    void setReadaheadWindow(unsigned numOfPages);                         // 0 disables readahead
     RC readHeaderPage(void *data);
     RC writeHeaderPage(const void *data);
+    RC flushPages();                                                      // Update the header page and write the dirty pages of this file back to disk
+    bool isDirectIO();                                                    // Whether the file bypasses the OS page cache
+    bool isCompressed();                                                  // Whether the file was created with CREATE_COMPRESSED
+    RC getFileId(FileId &id);                                             // Identity of the open file, shared by its handles
+    const string& getFileName();                                          // Name the file was opened with
+
+    // Asynchronous page I/O. submitPages() starts the requests and returns immediately,
+    // pollPages() returns the number of done requests, and waitPages() blocks until all requests are done
+    // (FAIL if any of them failed). A read returns the cached page if it is in the buffer pool.
+    // A write to a file with a write-ahead log is done synchronously through the log and the buffer pool.
+    RC submitPages(AsyncPageIO *requests, unsigned count);
+    unsigned pollPages(AsyncPageIO *requests, unsigned count);
+    RC waitPages(AsyncPageIO *requests, unsigned count);
+
+    uint64_t getWriteVersion();                                           // Changes whenever a page of the file is modified
+
+    // Zero-copy reads of a file opened with OPEN_MMAP. The page pointer reflects all writes made before the call
+    // and stays valid until the file is closed. It must not be written through.
+    bool isMapped();
+    RC mapPage(PageNum pageNum, const byte *&page);
+    RC adviseSequential();                                                // The pages will be read in order
+    RC prefetchMappedPages(PageNum startPageNum, unsigned count);        // The pages will be read soon
 
 private:
-    static const int RD_OFFSET = sizeof(FILE_ID);
-    static const int WR_OFFSET = RD_OFFSET + sizeof(unsigned);
-    static const int APP_OFFSET = WR_OFFSET + sizeof(unsigned);
-    static const int NUM_OF_PAGES_OFFSET = APP_OFFSET + sizeof(unsigned);
+    // the counters are stored as 64-bit values, aligned after the file fingerprint
+    static const int RD_OFFSET = sizeof(uint64_t);
+    static const int WR_OFFSET = RD_OFFSET + sizeof(uint64_t);
+    static const int APP_OFFSET = WR_OFFSET + sizeof(uint64_t);
+    static const int NUM_OF_PAGES_OFFSET = APP_OFFSET + sizeof(uint64_t);
+    static const int PAGE_SIZE_OFFSET = NUM_OF_PAGES_OFFSET + sizeof(uint64_t);
+    static const int FREE_LIST_OFFSET = PAGE_SIZE_OFFSET + sizeof(uint32_t);
+    static const int NUM_OF_FREE_PAGES_OFFSET = FREE_LIST_OFFSET + sizeof(PageNum);
+    static const int CREATE_FLAGS_OFFSET = NUM_OF_FREE_PAGES_OFFSET + sizeof(PageNum);
 
-    shared_ptr<fstream> file = make_shared<fstream>();
+    shared_ptr<FileBackend> file = make_shared<FileBackend>();
+    FileId fileId;
+    string fileName;
+    shared_ptr<ReadaheadRing> readahead = make_shared<ReadaheadRing>();
+    shared_ptr<WriteAheadLog> wal;      // set if the writes to the file are logged
+    shared_ptr<FreePageList> freePages = make_shared<FreePageList>();
+    shared_ptr<FileIOMetrics> metrics;
+    shared_ptr<HotPageList> hotPages;
 
-    RC openFile(const string &fileName);
+    RC openFile(const string &fileName, unsigned openFlags, shared_ptr<CompressedPageMap> pageMap,
+                shared_ptr<FileIOMetrics> metrics);
     RC closeFile();
+
+    // Read the pages of the free list into freePages->filePageNums; FAIL if the list has a link out of the file,
+    // a cycle, or not the length stored in the header page
+    RC loadFreePages();
+
+    // Append the page and return its number
+    RC appendNewPage(const void *data, PageNum &pageNum);
+
+    // Copy between data and the given page of the file through the buffer pool (page 0 is the header page)
+    RC readFilePage(PageNum filePageNum, void *data);
+    RC writeFilePage(PageNum filePageNum, const void *data);
+
+    // Read consecutive pages into data. Cached pages are copied from the buffer pool,
+    // and the others are read with vectored I/O. No page counter is updated.
+    RC readFilePages(PageNum filePageNum, unsigned count, byte *data);
+
+    // Copy the cached pages of [filePageNum, filePageNum + count) into data, and build the I/O vector for the rest
+    // (cached pages are read into a scratch page). firstFilePageNum is set to the first page to be read from the file;
+    // iovs is empty if all pages are cached.
+    void prepareReadVector(PageNum filePageNum, unsigned count, byte *data,
+                           PageNum &firstFilePageNum, vector<struct iovec> &iovs);
+
+    // Serve the page from the readahead ring, filling the ring if the handle is reading sequentially
+    bool readFromReadahead(PageNum pageNum, void *data);
 };
 
 #endif
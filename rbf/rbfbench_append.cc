@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
+#include "pfm.h"
+
+using namespace std;
+
+// Append throughput with and without extent preallocation.
+// Pages are appended round-robin to several files at once, as when a join writes its partitions,
+// so that the file system interleaves the space of the files unless it is reserved ahead.
+//
+// Usage: cs222_rbfbench_append [pages per file] [number of files]
+
+const unsigned NUM_OF_RUNS = 3;
+
+// Number of extents of the file on disk (0 if FIEMAP is not supported)
+unsigned countExtents(const string &fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct fiemap fileMap;
+    memset(&fileMap, 0, sizeof(fileMap));
+    fileMap.fm_length = FIEMAP_MAX_OFFSET;
+    fileMap.fm_flags = FIEMAP_FLAG_SYNC;
+    fileMap.fm_extent_count = 0;    // only count the extents
+    unsigned numOfExtents = (ioctl(fd, FS_IOC_FIEMAP, &fileMap) == 0) ? fileMap.fm_mapped_extents : 0;
+    close(fd);
+    return numOfExtents;
+}
+
+// Append the pages and flush them to disk; return the elapsed seconds
+double runAppend(PagedFileManager *pfm, unsigned numOfPages, unsigned numOfFiles, unsigned openFlags,
+                 unsigned &numOfExtents)
+{
+    vector<string> fileNames;
+    vector<FileHandle> fileHandles(numOfFiles);
+    for (unsigned i = 0; i < numOfFiles; i++) {
+        fileNames.push_back("bench_append_" + to_string(i));
+        remove(fileNames[i].c_str());
+        RC rc = pfm->createFile(fileNames[i]);
+        assert(rc == SUCCESS && "Creating the file should not fail.");
+        rc = pfm->openFile(fileNames[i], fileHandles[i], openFlags);
+        assert(rc == SUCCESS && "Opening the file should not fail.");
+    }
+
+    byte *data = allocateAlignedBuffer(PAGE_SIZE);
+    memset(data, 'a', PAGE_SIZE);
+    auto begin = chrono::steady_clock::now();
+    for (unsigned pageNum = 0; pageNum < numOfPages; pageNum++) {
+        for (unsigned i = 0; i < numOfFiles; i++) {
+            RC rc = fileHandles[i].appendPage(data);
+            assert(rc == SUCCESS && "Appending a page should not fail.");
+        }
+    }
+    for (unsigned i = 0; i < numOfFiles; i++) {
+        RC rc = pfm->closeFile(fileHandles[i]);
+        assert(rc == SUCCESS && "Closing the file should not fail.");
+    }
+    for (unsigned i = 0; i < numOfFiles; i++) {
+        int fd = open(fileNames[i].c_str(), O_RDONLY);
+        fsync(fd);
+        close(fd);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    free(data);
+
+    numOfExtents = 0;
+    for (unsigned i = 0; i < numOfFiles; i++) {
+        numOfExtents += countExtents(fileNames[i]);
+        pfm->destroyFile(fileNames[i]);
+    }
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned numOfPages = (argc > 1) ? atoi(argv[1]) : (64 << 20) / PAGE_SIZE;
+    unsigned numOfFiles = (argc > 2) ? atoi(argv[2]) : 8;
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    // a small pool, so that pages are written back while the files grow
+    pfm->setBufferPoolSize(256);
+
+    cout << "Appending " << numOfPages << " pages to each of " << numOfFiles << " files ("
+         << (double) numOfPages * numOfFiles * PAGE_SIZE / (1 << 20) << " MB), best of " << NUM_OF_RUNS << " runs"
+         << endl << endl;
+    cout << left << setw(28) << "mode" << right << setw(12) << "MB/s" << setw(12) << "extents" << endl;
+
+    const char *modeNames[] = {"buffered, page by page", "buffered, extents", "direct I/O, page by page",
+                               "direct I/O, extents"};
+    const unsigned modeFlags[] = {OPEN_DEFAULT, OPEN_PREALLOCATE, OPEN_DIRECT_IO | OPEN_NO_PREALLOCATION,
+                                  OPEN_DIRECT_IO};
+    double throughputs[4];
+    for (unsigned mode = 0; mode < 4; mode++) {
+        double bestSeconds = 0;
+        unsigned numOfExtents = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            double seconds = runAppend(pfm, numOfPages, numOfFiles, modeFlags[mode], numOfExtents);
+            if (run == 0 || seconds < bestSeconds) {
+                bestSeconds = seconds;
+            }
+        }
+        throughputs[mode] = (double) numOfPages * numOfFiles * PAGE_SIZE / (1 << 20) / bestSeconds;
+        cout << left << setw(28) << modeNames[mode] << right << setw(12) << fixed << setprecision(1)
+             << throughputs[mode] << setw(12) << numOfExtents << endl;
+    }
+
+    cout << endl << "Speedup with extents: buffered " << setprecision(2) << throughputs[1] / throughputs[0]
+         << "x, direct I/O " << throughputs[3] / throughputs[2] << "x" << endl;
+
+    pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Write and scan throughput of compressed files against uncompressed ones.
+// The pages hold repetitive text with some noise, like the varchar fields of a cold table. Before each scan, the
+// buffer pool is emptied and the file is dropped from the OS page cache, so that every page is read from disk.
+//
+// Usage: cs222_rbfbench_compress [number of pages]
+
+const unsigned NUM_OF_RUNS = 3;
+
+// Records of a few words and numbers, separated by random bytes in one case out of eight
+void prepareTablePage(unsigned seed, byte *data)
+{
+    const char *words[] = {"Irvine", "Los Angeles", "San Diego", "Riverside", "Santa Barbara", "Davis", "Merced"};
+    srand(seed);
+    unsigned pos = 0;
+    while (pos < PAGE_SIZE) {
+        string record = string("name=") + words[rand() % 7] + ";age=" + to_string(rand() % 100) + ";city="
+                        + words[rand() % 7] + ";";
+        if (rand() % 8 == 0) {
+            record += to_string(rand());
+        }
+        for (unsigned j = 0; j < record.size() && pos < PAGE_SIZE; j++) {
+            data[pos++] = record[j];
+        }
+    }
+}
+
+uint64_t getDiskSize(const string &fileName)
+{
+    struct stat fileStat;
+    return (stat(fileName.c_str(), &fileStat) == 0) ? fileStat.st_size : 0;
+}
+
+// Append the pages and flush them to disk; return the elapsed seconds
+double runWrite(PagedFileManager *pfm, const string &fileName, unsigned createFlags, const byte *pages,
+                unsigned numOfPages)
+{
+    pfm->destroyFile(fileName);
+    RC rc = pfm->createFile(fileName, createFlags);
+    assert(rc == SUCCESS && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == SUCCESS && "Opening the file should not fail.");
+
+    auto begin = chrono::steady_clock::now();
+    for (unsigned pageNum = 0; pageNum < numOfPages; pageNum++) {
+        rc = fileHandle.appendPage(pages + (size_t) (pageNum % 64) * PAGE_SIZE);
+        assert(rc == SUCCESS && "Appending a page should not fail.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == SUCCESS && "Closing the file should not fail.");
+    dropCachedFile(fileName);
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+// Read every page of the file from disk; return the elapsed seconds
+double runScan(PagedFileManager *pfm, const string &fileName, unsigned numOfPages)
+{
+    pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    dropCachedFile(fileName);
+    FileHandle fileHandle;
+    RC rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == SUCCESS && "Opening the file should not fail.");
+
+    byte *data = allocateAlignedBuffer(PAGE_SIZE);
+    auto begin = chrono::steady_clock::now();
+    for (unsigned pageNum = 0; pageNum < numOfPages; pageNum++) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == SUCCESS && "Reading a page should not fail.");
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    free(data);
+    pfm->closeFile(fileHandle);
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned numOfPages = (argc > 1) ? atoi(argv[1]) : (64 << 20) / PAGE_SIZE;
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    byte *pages = allocateAlignedBuffer((size_t) 64 * PAGE_SIZE);
+    for (unsigned i = 0; i < 64; i++) {
+        prepareTablePage(i, pages + (size_t) i * PAGE_SIZE);
+    }
+
+    cout << "Writing and scanning " << numOfPages << " pages ("
+         << (double) numOfPages * PAGE_SIZE / (1 << 20) << " MB), best of " << NUM_OF_RUNS << " runs" << endl << endl;
+    cout << left << setw(16) << "format" << right << setw(14) << "write MB/s" << setw(14) << "scan MB/s"
+         << setw(16) << "MB on disk" << endl;
+
+    const char *formatNames[] = {"uncompressed", "compressed"};
+    const unsigned formatFlags[] = {CREATE_DEFAULT, CREATE_COMPRESSED};
+    double scanThroughputs[2];
+    uint64_t diskSizes[2];
+    for (unsigned format = 0; format < 2; format++) {
+        string fileName = string("bench_compress_") + formatNames[format];
+        double bestWriteSeconds = 0, bestScanSeconds = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            double seconds = runWrite(pfm, fileName, formatFlags[format], pages, numOfPages);
+            bestWriteSeconds = (run == 0 || seconds < bestWriteSeconds) ? seconds : bestWriteSeconds;
+            seconds = runScan(pfm, fileName, numOfPages);
+            bestScanSeconds = (run == 0 || seconds < bestScanSeconds) ? seconds : bestScanSeconds;
+        }
+        diskSizes[format] = getDiskSize(fileName);
+        double size = (double) numOfPages * PAGE_SIZE / (1 << 20);
+        scanThroughputs[format] = size / bestScanSeconds;
+        cout << left << setw(16) << formatNames[format] << right << fixed << setprecision(1) << setw(14)
+             << size / bestWriteSeconds << setw(14) << scanThroughputs[format] << setw(16)
+             << (double) diskSizes[format] / (1 << 20) << endl;
+        pfm->destroyFile(fileName);
+    }
+
+    cout << endl << "Bytes read per scan: " << setprecision(2) << (double) diskSizes[1] / diskSizes[0]
+         << "x, scan speedup " << scanThroughputs[1] / scanThroughputs[0] << "x" << endl;
+
+    free(pages);
+    return 0;
+}
@@ -0,0 +1,275 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+
+using namespace std;
+
+// Scan throughput of the RBFM with and without a condition, record by record and by batches, then of the parallel
+// scan by number of threads. The conjunctions are scanned with their predicates in two orders, which the scan
+// reorders by selectivity. A range of salaries, which follow the order of insertion, is scanned without then with a
+// zone map of the salaries.
+// The file holds employee records of a name, an age, a height and a salary; each condition selects about a tenth of
+// them, so that the time goes into evaluating the condition rather than into copying the selected records out. The
+// scans return the salaries, which the batch scans sum in a loop over the column. The file is cached, so that the
+// parallel scans are bound by the CPU.
+//
+// Usage: cs222_rbfbench_scan [number of records]
+
+const unsigned NUM_OF_RUNS = 3;
+
+void createRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+    Attribute attr;
+    attr.name = "EmpName";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength) 30;
+    recordDescriptor.push_back(attr);
+
+    attr.name = "Age";
+    attr.type = TypeInt;
+    attr.length = (AttrLength) 4;
+    recordDescriptor.push_back(attr);
+
+    attr.name = "Height";
+    attr.type = TypeReal;
+    attr.length = (AttrLength) 4;
+    recordDescriptor.push_back(attr);
+
+    attr.name = "Salary";
+    attr.type = TypeInt;
+    attr.length = (AttrLength) 4;
+    recordDescriptor.push_back(attr);
+}
+
+// One of ten names, an age in [0, 100), a height in [150, 200) and a salary growing with recordNum
+void prepareRecord(unsigned recordNum, byte *record)
+{
+    unsigned pos = 1;
+    record[0] = 0;  // nulls indicator
+    string name = "Employee" + string(recordNum % 10 + 1, 'a' + recordNum % 10);
+    *((uint32_t*) (record + pos)) = name.size();
+    pos += sizeof(uint32_t);
+    memcpy(record + pos, name.data(), name.size());
+    pos += name.size();
+    *((int32_t*) (record + pos)) = (recordNum * 37) % 100;
+    pos += sizeof(int32_t);
+    *((float*) (record + pos)) = 150 + (recordNum * 13) % 50;
+    pos += sizeof(float);
+    *((int32_t*) (record + pos)) = 1000 + recordNum;
+}
+
+// Scan the file with the condition, by batches or not; return the elapsed seconds and the number of records returned
+double runScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+               const string &conditionAttribute, CompOp compOp, const void *value, bool useBatches,
+               unsigned &numOfResults)
+{
+    vector<string> attributeNames(1, "Salary");
+    RBFM_ScanIterator scanIterator;
+    byte data[PAGE_SIZE];
+    RID rid;
+    RecordBatch batch;
+    int64_t totalSalary = 0;
+
+    auto begin = chrono::steady_clock::now();
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames,
+                       scanIterator);
+    assert(rc == SUCCESS && "Scanning the file should not fail.");
+    numOfResults = 0;
+    if (useBatches) {
+        while (scanIterator.getNextBatch(batch) != RBFM_EOF) {
+            const int32_t *salaries = batch.getInts(0);
+            for (unsigned i = 0; i < batch.getNumOfRecords(); i++) {
+                totalSalary += salaries[i];
+            }
+            numOfResults += batch.getNumOfRecords();
+        }
+    } else {
+        while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+            totalSalary += *((int32_t*) (data + 1));
+            numOfResults++;
+        }
+    }
+    scanIterator.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    assert(totalSalary > 0 && "The salaries should be read.");
+    return seconds;
+}
+
+// Scan the file with the condition of several predicates; return the elapsed seconds and the stats of the scan
+double runConditionScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle,
+                        const vector<Attribute> &recordDescriptor, const ScanCondition &condition, ScanStats &stats)
+{
+    vector<string> attributeNames(1, "Salary");
+    RBFM_ScanIterator scanIterator;
+    RecordBatch batch;
+    unsigned numOfResults = 0;
+
+    auto begin = chrono::steady_clock::now();
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, condition, attributeNames, scanIterator);
+    assert(rc == SUCCESS && "Scanning the file should not fail.");
+    while (scanIterator.getNextBatch(batch) != RBFM_EOF) {
+        numOfResults += batch.getNumOfRecords();
+    }
+    scanIterator.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    stats = scanIterator.getStats();
+    assert(numOfResults > 0 && "The condition should select records.");
+    return seconds;
+}
+
+// Scan the file with no condition by numOfThreads threads; return the elapsed seconds
+double runParallelScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle,
+                       const vector<Attribute> &recordDescriptor, unsigned numOfThreads)
+{
+    vector<string> attributeNames(1, "Salary");
+    RBFM_ParallelScanIterator scanIterator;
+    RecordBatch batch;
+    int64_t totalSalary = 0;
+
+    auto begin = chrono::steady_clock::now();
+    RC rc = rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, numOfThreads, false,
+                               scanIterator);
+    assert(rc == SUCCESS && "Scanning the file should not fail.");
+    while (scanIterator.getNextBatch(batch) != RBFM_EOF) {
+        const int32_t *salaries = batch.getInts(0);
+        for (unsigned i = 0; i < batch.getNumOfRecords(); i++) {
+            totalSalary += salaries[i];
+        }
+    }
+    scanIterator.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    assert(totalSalary > 0 && "The salaries should be read.");
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned numOfRecords = (argc > 1) ? atoi(argv[1]) : 1000000;
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    string fileName = "bench_scan";
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    rbfm->destroyFile(fileName);
+    RC rc = rbfm->createFile(fileName);
+    assert(rc == SUCCESS && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == SUCCESS && "Opening the file should not fail.");
+
+    const unsigned batchSize = 1000;
+    vector<byte> records((size_t) batchSize * PAGE_SIZE);
+    vector<const void*> data(batchSize);
+    vector<RID> rids;
+    for (unsigned i = 0; i < numOfRecords; i += batchSize) {
+        data.resize(min(batchSize, numOfRecords - i));
+        for (unsigned j = 0; j < data.size(); j++) {
+            prepareRecord(i + j, &records[(size_t) j * PAGE_SIZE]);
+            data[j] = &records[(size_t) j * PAGE_SIZE];
+        }
+        rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, rids);
+        assert(rc == SUCCESS && "Inserting the records should not fail.");
+    }
+
+    int32_t age = 10;
+    float height = 195;
+    string name = "Employee" + string(3, 'c');
+    vector<byte> nameValue(sizeof(uint32_t) + name.size());
+    *((uint32_t*) nameValue.data()) = name.size();
+    memcpy(nameValue.data() + sizeof(uint32_t), name.data(), name.size());
+
+    const char *scanNames[] = {"no condition", "Age < 10", "Height >= 195", "EmpName = Employeeccc"};
+    const char *conditionAttributes[] = {"", "Age", "Height", "EmpName"};
+    const CompOp compOps[] = {NO_OP, LT_OP, GE_OP, EQ_OP};
+    const void *values[] = {NULL, &age, &height, nameValue.data()};
+
+    cout << "Scanning " << numOfRecords << " records in " << fileHandle.getNumberOfPages() << " pages, best of "
+         << NUM_OF_RUNS << " runs" << endl << endl;
+    cout << left << setw(24) << "condition" << right << setw(12) << "results" << setw(20) << "records/s"
+         << setw(20) << "batch records/s" << endl;
+    for (unsigned scan = 0; scan < 4; scan++) {
+        double bestSeconds[2] = {0, 0};
+        unsigned numOfResults = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            for (unsigned useBatches = 0; useBatches < 2; useBatches++) {
+                double seconds = runScan(rbfm, fileHandle, recordDescriptor, conditionAttributes[scan],
+                                         compOps[scan], values[scan], useBatches, numOfResults);
+                bestSeconds[useBatches] = (run == 0 || seconds < bestSeconds[useBatches])
+                                          ? seconds : bestSeconds[useBatches];
+            }
+        }
+        cout << left << setw(24) << scanNames[scan] << right << setw(12) << numOfResults << fixed
+             << setprecision(0) << setw(20) << numOfRecords / bestSeconds[0] << setw(20)
+             << numOfRecords / bestSeconds[1] << endl;
+    }
+
+    // the same conjunction, with its most selective predicate last then first
+    int32_t salary = 1000;
+    Predicate salaryPredicate = {COMPARE_PRED, "Salary", GE_OP, &salary};
+    Predicate heightPredicate = {COMPARE_PRED, "Height", GE_OP, &height};
+    Predicate agePredicate = {COMPARE_PRED, "Age", LT_OP, &age};
+    ScanCondition conditions[] = {{{salaryPredicate}, {heightPredicate}, {agePredicate}},
+                                  {{agePredicate}, {heightPredicate}, {salaryPredicate}}};
+    const char *conditionNames[] = {"Salary, Height, Age", "Age, Height, Salary"};
+    ScanStats stats;
+    cout << endl << left << setw(24) << "conjunction" << right << setw(20) << "records/s" << endl;
+    for (unsigned scan = 0; scan < 2; scan++) {
+        double bestSeconds = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            double seconds = runConditionScan(rbfm, fileHandle, recordDescriptor, conditions[scan], stats);
+            bestSeconds = (run == 0 || seconds < bestSeconds) ? seconds : bestSeconds;
+        }
+        cout << left << setw(24) << conditionNames[scan] << right << setw(20) << setprecision(0)
+             << numOfRecords / bestSeconds << endl;
+    }
+
+    // a hundredth of the salaries
+    int32_t maxSalary = 1000 + numOfRecords / 100;
+    ScanCondition rangeCondition = {{{COMPARE_PRED, "Salary", LT_OP, &maxSalary}}};
+    cout << endl << left << setw(24) << "Salary range" << right << setw(20) << "records/s" << setw(16)
+         << "pages skipped" << endl;
+    for (unsigned hasZoneMap = 0; hasZoneMap < 2; hasZoneMap++) {
+        if (hasZoneMap) {
+            rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Salary");
+            assert(rc == SUCCESS && "Creating the zone map should not fail.");
+        }
+        double bestSeconds = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            double seconds = runConditionScan(rbfm, fileHandle, recordDescriptor, rangeCondition, stats);
+            bestSeconds = (run == 0 || seconds < bestSeconds) ? seconds : bestSeconds;
+        }
+        cout << left << setw(24) << (hasZoneMap ? "zone map" : "no zone map") << right << setw(20)
+             << setprecision(0) << numOfRecords / bestSeconds << setw(16) << stats.numOfPagesSkipped << endl;
+    }
+
+    cout << endl << left << setw(24) << "parallel threads" << right << setw(20) << "records/s" << setw(12)
+         << "speedup" << endl;
+    unsigned maxNumOfThreads = max(8u, thread::hardware_concurrency());
+    double serialThroughput = 0;
+    for (unsigned numOfThreads = 1; numOfThreads <= maxNumOfThreads; numOfThreads *= 2) {
+        double bestSeconds = 0;
+        for (unsigned run = 0; run < NUM_OF_RUNS; run++) {
+            double seconds = runParallelScan(rbfm, fileHandle, recordDescriptor, numOfThreads);
+            bestSeconds = (run == 0 || seconds < bestSeconds) ? seconds : bestSeconds;
+        }
+        double throughput = numOfRecords / bestSeconds;
+        serialThroughput = (numOfThreads == 1) ? throughput : serialThroughput;
+        cout << left << setw(24) << numOfThreads << right << setw(20) << setprecision(0) << throughput << setw(11)
+             << setprecision(2) << throughput / serialThroughput << "x" << endl;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == SUCCESS && "Closing the file should not fail.");
+    rbfm->destroyFile(fileName);
+    return 0;
+}
@@ -1,8 +1,16 @@
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "pfm.h"
 #include "rbfm.h"
 using namespace std;
@@ -25,19 +33,72 @@ RecordBasedFileManager::~RecordBasedFileManager()
 {
 }
 
-RC RecordBasedFileManager::createFile(const string &fileName)
+RC RecordBasedFileManager::createFile(const string &fileName, unsigned createFlags)
 {
-    return PagedFileManager::instance()->createFile(fileName);
+    if (PagedFileManager::instance()->createFile(fileName, createFlags) == FAIL) {
+        return FAIL;
+    }
+    forgetFileMaps(fileName);   // the inode of a destroyed file may be reused
+    remove(ZoneMap::getMapFileName(fileName).c_str());
+    return SUCCESS;
 }
 
 RC RecordBasedFileManager::destroyFile(const string &fileName)
 {
+    forgetFileMaps(fileName);
+    remove(ZoneMap::getMapFileName(fileName).c_str());
     return PagedFileManager::instance()->destroyFile(fileName);
 }
 
-RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+void RecordBasedFileManager::forgetFileMaps(const string &fileName)
+{
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        return;
+    }
+    FileId fileId;
+    fileId.device = fileStat.st_dev;
+    fileId.inode = fileStat.st_ino;
+    {
+        lock_guard<mutex> lock(freeSpaceMapsMutex);
+        freeSpaceMaps.erase(fileId);
+    }
+    lock_guard<mutex> lock(zoneMapsMutex);
+    zoneMaps.erase(fileId);
+}
+
+shared_ptr<FreeSpaceMap> RecordBasedFileManager::getFreeSpaceMap(FileHandle &fileHandle)
+{
+    FileId fileId;
+    if (fileHandle.getFileId(fileId) == FAIL) {
+        return nullptr;
+    }
+    shared_ptr<FreeSpaceMap> freeSpaceMap;
+    {
+        lock_guard<mutex> lock(freeSpaceMapsMutex);
+        shared_ptr<FreeSpaceMap> &fileFreeSpaceMap = freeSpaceMaps[fileId];
+        if (!fileFreeSpaceMap) {
+            fileFreeSpaceMap = make_shared<FreeSpaceMap>();
+        }
+        freeSpaceMap = fileFreeSpaceMap;
+    }
+    return (freeSpaceMap->prepare(fileHandle) == SUCCESS) ? freeSpaceMap : nullptr;
+}
+
+shared_ptr<FreeSpaceMap> RecordBasedFileManager::findFreeSpaceMap(FileHandle &fileHandle)
+{
+    FileId fileId;
+    if (fileHandle.getFileId(fileId) == FAIL) {
+        return nullptr;
+    }
+    lock_guard<mutex> lock(freeSpaceMapsMutex);
+    auto it = freeSpaceMaps.find(fileId);
+    return (it != freeSpaceMaps.end()) ? it->second : nullptr;
+}
+
+RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle, unsigned openFlags)
 {
-    if (PagedFileManager::instance()->openFile(fileName, fileHandle) == FAIL) {
+    if (PagedFileManager::instance()->openFile(fileName, fileHandle, openFlags) == FAIL) {
         return FAIL;
     }
     if (fileHandle.getNumberOfPages() == 0) {
@@ -50,6 +111,9 @@ RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHand
 
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle)
 {
+    if (flushFreeSpace(fileHandle) == FAIL) {
+        return FAIL;
+    }
     return PagedFileManager::instance()->closeFile(fileHandle);
 }
 
@@ -60,13 +124,20 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
 {
     // compute the length of the new record
     unsigned recordLength = max(RID_SZ, computeRecordLength(recordDescriptor, data));
-    if (recordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ > PAGE_SIZE - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ) {
+    if (recordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ > PAGE_SIZE - PAGE_TRAILER_SZ) {
+        return FAIL;
+    }
+
+    shared_ptr<ZoneMap> zoneMap = findZoneMap(fileHandle);
+    if (zoneMap && zoneMap->markChanged(fileHandle) == FAIL) {
         return FAIL;
     }
 
     // look for a page with enough free space for the new record
     PageNum pageNum;
-    seekFreePage(fileHandle, recordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ, pageNum);
+    if (seekFreePage(fileHandle, recordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ, pageNum) == FAIL) {
+        return FAIL;
+    }
     PageNum numOfPages = fileHandle.getNumberOfPages();
     byte page[PAGE_SIZE];
     unsigned freeBytes;
@@ -74,53 +145,89 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
         memset(page, 0, PAGE_SIZE);
 
         // initialize the free space for a new page
-        freeBytes = PAGE_SIZE - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ;
+        freeBytes = PAGE_SIZE - PAGE_TRAILER_SZ;
     } else {
         // read the free page from disk
         fileHandle.readPage(pageNum, page);
         freeBytes = getFreeBytes(page);
     }
 
-    SlotNum numOfSlots = getNumOfSlots(page);    // number of slots (including slots that don't contain a valid record)
-    unsigned recordOffset = PAGE_SIZE
-                            - freeBytes
-                            - FREE_SPACE_SZ
-                            - NUM_OF_SLOTS_SZ
-                            - numOfSlots*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ);   // offset of the new record in the page
-
-    // add offset and length info of the new record to slot directory
     rid.pageNum = pageNum;
-    SlotNum slotNum = 0;   // slot number starts from 1 (not from 0)
-    for (; slotNum < numOfSlots; ++slotNum) {
-        unsigned sLength = getRecordLength(page, slotNum);
-        if (sLength == 0) {
-            break;
-        }
-    }
-    rid.slotNum = slotNum;
-    setRecordOffset(page, slotNum, recordOffset);
-    setRecordLength(page, slotNum, recordLength);
-
-    // update number of free space and number of slots in slot directory and directory header page
-    if (slotNum >= numOfSlots) {
-        freeBytes -= recordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ;
-        setNumOfSlots(page, numOfSlots + 1);
-    } else {
-        freeBytes -= recordLength;
-    }
+    rid.slotNum = addRecordToPage(page, recordDescriptor, data, recordLength, freeBytes);
     updateFreeSpace(fileHandle, page, pageNum, freeBytes);
-
-    // write the new record to page
-    writeRecord(page, recordOffset, recordDescriptor, data);
+    if (zoneMap) {
+        zoneMap->addRecord(pageNum, page, getRecordOffset(page, rid.slotNum), recordDescriptor.size());
+    }
 
     // write the updated page to disk
     if (pageNum >= numOfPages) {
-        fileHandle.appendPage(page);
-    } else {
-        fileHandle.writePage(pageNum, page);
+        return fileHandle.appendPage(page);
     }
+    return fileHandle.writePage(pageNum, page);
+}
 
-    return SUCCESS;
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle,
+                                         const vector<Attribute> &recordDescriptor,
+                                         const vector<const void*> &data,
+                                         vector<RID> &rids)
+{
+    vector<unsigned> recordLengths(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        recordLengths[i] = max(RID_SZ, computeRecordLength(recordDescriptor, data[i]));
+        if (recordLengths[i] + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ > PAGE_SIZE - PAGE_TRAILER_SZ) {
+            return FAIL;
+        }
+    }
+    rids.resize(data.size());
+    shared_ptr<ZoneMap> zoneMap = findZoneMap(fileHandle);
+    if (zoneMap && zoneMap->markChanged(fileHandle) == FAIL) {
+        return FAIL;
+    }
+
+    PageBuffer page;
+    PageNum pageNum = 0;
+    bool hasPage = false;
+    bool isNewPage = false;
+    unsigned freeBytes = 0;
+    for (size_t i = 0; i < data.size(); ++i) {
+        unsigned size = recordLengths[i] + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ;
+        if (hasPage && size > freeBytes) {
+            // the page is full, so it is written before the next one is looked for. The batch only moves forward,
+            // so that the later (smaller) records do not go back to a page already written.
+            updateFreeSpace(fileHandle, page.get(), pageNum, freeBytes);
+            if ((isNewPage ? fileHandle.appendPage(page.get()) : fileHandle.writePage(pageNum, page.get())) == FAIL) {
+                return FAIL;
+            }
+            hasPage = false;
+        }
+        if (!hasPage) {
+            if (seekFreePage(fileHandle, size, pageNum, (i == 0) ? 0 : pageNum + 1) == FAIL) {
+                return FAIL;
+            }
+            isNewPage = pageNum >= fileHandle.getNumberOfPages();
+            if (isNewPage) {
+                memset(page.get(), 0, PAGE_SIZE);
+                freeBytes = PAGE_SIZE - PAGE_TRAILER_SZ;
+            } else {
+                if (fileHandle.readPage(pageNum, page.get()) == FAIL) {
+                    return FAIL;
+                }
+                freeBytes = getFreeBytes(page.get());
+            }
+            hasPage = true;
+        }
+        rids[i].pageNum = pageNum;
+        rids[i].slotNum = addRecordToPage(page.get(), recordDescriptor, data[i], recordLengths[i], freeBytes);
+        if (zoneMap) {
+            zoneMap->addRecord(pageNum, page.get(), getRecordOffset(page.get(), rids[i].slotNum),
+                               recordDescriptor.size());
+        }
+    }
+    if (!hasPage) {
+        return SUCCESS;
+    }
+    updateFreeSpace(fileHandle, page.get(), pageNum, freeBytes);
+    return isNewPage ? fileHandle.appendPage(page.get()) : fileHandle.writePage(pageNum, page.get());
 }
 
 RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
@@ -129,7 +236,10 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
                                       void *data)
 {
     byte page[PAGE_SIZE];
-    fileHandle.readPage(rid.pageNum, page);
+    // the page may have been released and its slots dropped since the record was deleted
+    if (fileHandle.readPage(rid.pageNum, page) == FAIL || rid.slotNum >= getNumOfSlots(page)) {
+        return FAIL;
+    }
     unsigned recordLength = getRecordLength(page, rid.slotNum);
     if (recordLength == 0) {    // the record in this slot is invalid (deleted)
         return FAIL;
@@ -195,13 +305,20 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
     PageNum pageNum = rid.pageNum;
     SlotNum slotNum = rid.slotNum;
     byte page[PAGE_SIZE];
-    fileHandle.readPage(pageNum, page);
+    if (fileHandle.readPage(pageNum, page) == FAIL || slotNum >= getNumOfSlots(page)) {
+        return FAIL;
+    }
 
     unsigned recordLength = getRecordLength(page, slotNum);
     if (recordLength == 0) {    // this record has been deleted and should not be deleted again
         return FAIL;
     }
+    shared_ptr<ZoneMap> zoneMap = findZoneMap(fileHandle);
+    if (zoneMap && zoneMap->markChanged(fileHandle) == FAIL) {
+        return FAIL;
+    }
 
+    // the freed bytes are left where they are, until an insert or an update needs them
     unsigned recordOffset = getRecordOffset(page, slotNum);
     if (recordOffset >= PAGE_SIZE) {    // this record has been moved to another page (not in the original page)
         recordOffset -= PAGE_SIZE;
@@ -209,49 +326,41 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
         slotNum = *((SlotNum*) (page + recordOffset + PAGE_NUM_SZ));
 
         // delete the pointer in the original page
-        setRecordLength(page, rid.slotNum, 0);
-        unsigned freeBytes = getFreeBytes(page);
-        unsigned numOfSlots = getNumOfSlots(page);
-        unsigned numOfShift = PAGE_SIZE
-                              - freeBytes
-                              - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
-                              - numOfSlots*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
-                              - recordOffset - RID_SZ;
-        memmove(page + recordOffset, page + recordOffset + RID_SZ, numOfShift);
-        for (unsigned slot = 0; slot < numOfSlots; ++slot) {
-            unsigned offset = getRecordOffset(page, slot);
-            if (offset > PAGE_SIZE + recordOffset || (offset < PAGE_SIZE && offset > recordOffset)) {
-                setRecordOffset(page, slot, offset - RID_SZ);
-            }
-        }
-
-        updateFreeSpace(fileHandle, page, rid.pageNum, freeBytes + RID_SZ);
+        releaseSlot(page, rid.slotNum);
+        freeRecordSpace(page, recordOffset, RID_SZ);
+        updateFreeSpace(fileHandle, page, rid.pageNum, getFreeBytes(page));
         fileHandle.writePage(rid.pageNum, page);
 
         fileHandle.readPage(pageNum, page);
         recordOffset = getRecordOffset(page, slotNum);
+        recordLength = getRecordLength(page, slotNum);
     }
 
-    setRecordLength(page, slotNum, 0);
-    unsigned freeBytes = getFreeBytes(page);
-    unsigned numOfSlots = getNumOfSlots(page);
-    unsigned numOfShift = PAGE_SIZE
-                          - freeBytes
-                          - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
-                          - numOfSlots*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
-                          - recordOffset - recordLength;
+    if (zoneMap) {
+        zoneMap->removeRecord(pageNum, page, recordOffset, recordDescriptor.size());
+    }
+    releaseSlot(page, slotNum);
+    freeRecordSpace(page, recordOffset, recordLength);
 
-    memmove(page + recordOffset, page + recordOffset + recordLength, numOfShift);
-    for (unsigned slot = 0; slot < numOfSlots; ++slot) {
-        unsigned offset = getRecordOffset(page, slot);
-        if (offset > PAGE_SIZE + recordOffset || (offset < PAGE_SIZE && offset > recordOffset)) {
-            setRecordOffset(page, slot, offset - recordLength);
+    // all the bytes but the slot directory are free when no slot is referenced any more
+    unsigned numOfSlots = getNumOfSlots(page);
+    bool isEmpty = getFreeBytes(page) == PAGE_SIZE - PAGE_TRAILER_SZ - numOfSlots*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ);
+    if (isEmpty) {
+        // so the slot directory is dropped as well
+        setNumOfSlots(page, 0);
+        setFreeSlotHead(page, 0);
+        setFragmentedBytes(page, 0);
+        setFreeBytes(page, PAGE_SIZE - PAGE_TRAILER_SZ);
+        if (zoneMap) {
+            zoneMap->clearPage(pageNum);
         }
     }
-
-    updateFreeSpace(fileHandle, page, pageNum, freeBytes + recordLength);
+    updateFreeSpace(fileHandle, page, pageNum, getFreeBytes(page));
     fileHandle.writePage(pageNum, page);
 
+    if (isEmpty && pageNum == fileHandle.getNumberOfPages() - 1) {
+        return releaseTrailingPages(fileHandle);
+    }
     return SUCCESS;
 }
 
@@ -263,7 +372,9 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
     PageNum pageNum = rid.pageNum;
     SlotNum slotNum = rid.slotNum;
     byte page[PAGE_SIZE];
-    fileHandle.readPage(pageNum, page);
+    if (fileHandle.readPage(pageNum, page) == FAIL || slotNum >= getNumOfSlots(page)) {
+        return FAIL;
+    }
 
     // length of the old record
     unsigned recordLength = getRecordLength(page, slotNum);
@@ -274,7 +385,11 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
     // length of the updated record
     unsigned newRecordLength = max(RID_SZ, computeRecordLength(recordDescriptor, data));
 
-    if (newRecordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ > PAGE_SIZE - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ) {
+    if (newRecordLength + SLOT_OFFSET_SZ + SLOT_LENGTH_SZ > PAGE_SIZE - PAGE_TRAILER_SZ) {
+        return FAIL;
+    }
+    shared_ptr<ZoneMap> zoneMap = findZoneMap(fileHandle);
+    if (zoneMap && zoneMap->markChanged(fileHandle) == FAIL) {
         return FAIL;
     }
 
@@ -289,11 +404,13 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
     PageNum dataPageNum;
     SlotNum dataSlotNum;
     byte *dataPage = nullptr;     // the page that contains the actual record data
+    unique_ptr<PageBuffer> movedPage;   // holds dataPage if the record has been moved
     if (recordOffset >= PAGE_SIZE) {    // this record has been moved to another page (not in the original page)
         recordOffset -= PAGE_SIZE;
         dataPageNum = *((PageNum*) (page + recordOffset));
         dataSlotNum = *((SlotNum*) (page + recordOffset + PAGE_NUM_SZ));
-        dataPage = new byte[PAGE_SIZE];
+        movedPage.reset(new PageBuffer());
+        dataPage = movedPage->get();
         fileHandle.readPage(dataPageNum, dataPage);
         recordOffset = getRecordOffset(dataPage, dataSlotNum);
     } else {    // this record is in the original page
@@ -302,60 +419,57 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
         dataPage = page;
     }
     unsigned freeBytes = getFreeBytes(dataPage);
-    unsigned numOfSlots = getNumOfSlots(dataPage);
 
-    // number of bytes shifted when updating or removing the record
-    unsigned numOfShift = PAGE_SIZE
-                          - freeBytes
-                          - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
-                          - numOfSlots*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
-                          - recordOffset
-                          - recordLength;
+    // the zones of the page lose the old record, and the updated one is added where it is written
+    if (zoneMap) {
+        zoneMap->removeRecord(dataPageNum, dataPage, recordOffset, recordDescriptor.size());
+    }
 
     if (freeBytes + recordLength >= newRecordLength) {  // update the record in place
         if (recordLength != newRecordLength) {
             if (dataPage != page) { // this record has been moved to another page
                 fileHandle.writePage(pageNum, page);
-                setRecordLength(dataPage, dataSlotNum, newRecordLength);
             }
 
-            // shift records on the right of the updated record to their new positions
-            memmove(dataPage + recordOffset + newRecordLength, dataPage + recordOffset + recordLength, numOfShift);
-
-            // update offset of the shifted records
-            for (unsigned slot = 0; slot < numOfSlots; ++slot) {
-                unsigned offset = getRecordOffset(dataPage, slot);
-                if (offset > PAGE_SIZE + recordOffset || (offset < PAGE_SIZE && offset > recordOffset)) {
-                    setRecordOffset(dataPage, slot, offset + newRecordLength - recordLength);
+            if (newRecordLength < recordLength) {
+                // the end of the old record is freed
+                freeRecordSpace(dataPage, recordOffset + newRecordLength, recordLength - newRecordLength);
+            } else if (recordOffset + recordLength == getFreeSpaceOffset(dataPage)
+                       && freeBytes - getFragmentedBytes(dataPage) >= newRecordLength - recordLength) {
+                // the record is the last one and grows into the free space after it
+                setFreeBytes(dataPage, freeBytes + recordLength - newRecordLength);
+            } else {
+                // the record is moved after the other ones, which are compacted first if the free space is short
+                setRecordLength(dataPage, dataSlotNum, 0);
+                freeRecordSpace(dataPage, recordOffset, recordLength);
+                if (getFreeBytes(dataPage) - getFragmentedBytes(dataPage) < newRecordLength) {
+                    compactPage(dataPage);
                 }
+                recordOffset = getFreeSpaceOffset(dataPage);
+                setRecordOffset(dataPage, dataSlotNum, recordOffset);
+                setFreeBytes(dataPage, getFreeBytes(dataPage) - newRecordLength);
             }
+            setRecordLength(dataPage, dataSlotNum, newRecordLength);
 
-            updateFreeSpace(fileHandle, dataPage, dataPageNum, freeBytes + recordLength - newRecordLength);
+            updateFreeSpace(fileHandle, dataPage, dataPageNum, getFreeBytes(dataPage));
         }
         writeRecord(dataPage, recordOffset, recordDescriptor, data);
+        if (zoneMap) {
+            zoneMap->addRecord(dataPageNum, dataPage, recordOffset, recordDescriptor.size());
+        }
 
         fileHandle.writePage(dataPageNum, dataPage);
     } else {    // move the updated record to another page with enough space
-        unsigned ptrLength = 0;
         if (dataPage == page) { // replace the old record with a pointer to updated record
-            ptrLength = RID_SZ;  // pointer: (page number, slot number)
+            // pointer: (page number, slot number)
             setRecordOffset(page, slotNum, recordOffset + PAGE_SIZE);
+            freeRecordSpace(page, recordOffset + RID_SZ, recordLength - RID_SZ);
         } else {
-            setRecordLength(dataPage, dataSlotNum, 0);
-        }
-
-        // move left to remove the old record
-        memmove(dataPage + recordOffset + ptrLength, dataPage + recordOffset + recordLength, numOfShift);
-
-        // update offset of the shifted records
-        for (unsigned slot = 0; slot < numOfSlots; ++slot) {
-            unsigned offset = getRecordOffset(dataPage, slot);
-            if (offset > PAGE_SIZE + recordOffset || (offset < PAGE_SIZE && offset > recordOffset)) {
-                setRecordOffset(dataPage, slot, offset + ptrLength - recordLength);
-            }
+            releaseSlot(dataPage, dataSlotNum);
+            freeRecordSpace(dataPage, recordOffset, recordLength);
         }
 
-        updateFreeSpace(fileHandle, dataPage, dataPageNum, freeBytes + recordLength - ptrLength);
+        updateFreeSpace(fileHandle, dataPage, dataPageNum, getFreeBytes(dataPage));
         if (dataPage != page) {
             fileHandle.writePage(dataPageNum, dataPage);
         }
@@ -371,10 +485,6 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
         fileHandle.writePage(pageNum, page);
     }
 
-    if (dataPage != page) {
-        delete[] dataPage;
-    }
-
     return SUCCESS;
 }
 
@@ -398,7 +508,9 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle,
     PageNum pageNum = rid.pageNum;
     SlotNum slotNum = rid.slotNum;
     byte page[PAGE_SIZE];
-    fileHandle.readPage(pageNum, page);
+    if (fileHandle.readPage(pageNum, page) == FAIL || slotNum >= getNumOfSlots(page)) {
+        return FAIL;
+    }
     unsigned recordLength = getRecordLength(page, slotNum);
     if (recordLength == 0) {
         return FAIL;
@@ -422,6 +534,16 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle,
     return SUCCESS;
 }
 
+// The condition of a scan by one comparison, or no condition if compOp is NO_OP
+static ScanCondition getComparisonCondition(const string &conditionAttribute, CompOp compOp, const void *value)
+{
+    ScanCondition condition;
+    if (compOp != NO_OP) {
+        condition.push_back(vector<Predicate>(1, Predicate{COMPARE_PRED, conditionAttribute, compOp, value}));
+    }
+    return condition;
+}
+
 RC RecordBasedFileManager::scan(FileHandle &fileHandle,
                                 const vector<Attribute> &recordDescriptor,
                                 const string &conditionAttribute,
@@ -429,6 +551,16 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
                                 const void *value,
                                 const vector<string> &attributeNames,
                                 RBFM_ScanIterator &rbfm_ScanIterator)
+{
+    return scan(fileHandle, recordDescriptor, getComparisonCondition(conditionAttribute, compOp, value),
+                attributeNames, rbfm_ScanIterator);
+}
+
+RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+                                const vector<Attribute> &recordDescriptor,
+                                const ScanCondition &condition,
+                                const vector<string> &attributeNames,
+                                RBFM_ScanIterator &rbfm_ScanIterator)
 {
     if (!rbfm_ScanIterator.attrNums.empty()) {
         rbfm_ScanIterator.attrNums.clear();
@@ -446,25 +578,60 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
         return FAIL;
     }
 
-    if (compOp != NO_OP) {
-        auto &conditionAttrNum = rbfm_ScanIterator.conditionAttrNum;
-        for (conditionAttrNum = 0; conditionAttrNum < recordDescriptor.size(); ++conditionAttrNum) {
-            if (recordDescriptor[conditionAttrNum].name == conditionAttribute) {
-                break;
+    // bind each predicate to its attribute, and its value to the type of the attribute
+    vector<RBFM_ScanIterator::PredicateGroup> conditionGroups(condition.size());
+    for (unsigned groupNum = 0; groupNum < condition.size(); ++groupNum) {
+        conditionGroups[groupNum].numOfTests = 0;
+        conditionGroups[groupNum].numOfMatches = 0;
+        for (const Predicate &predicate : condition[groupNum]) {
+            RBFM_ScanIterator::BoundPredicate bound;
+            for (bound.attrNum = 0; bound.attrNum < recordDescriptor.size(); ++bound.attrNum) {
+                if (recordDescriptor[bound.attrNum].name == predicate.attributeName) {
+                    break;
+                }
             }
-        }
-        if (conditionAttrNum == recordDescriptor.size()) {
-            return FAIL;
+            if (bound.attrNum == recordDescriptor.size()
+                || (predicate.type == COMPARE_PRED && predicate.compOp == NO_OP)) {
+                return FAIL;
+            }
+
+            bound.type = predicate.type;
+            bound.attrType = recordDescriptor[bound.attrNum].type;
+            bound.compOp = predicate.compOp;
+            bound.isValueNull = predicate.value == nullptr;
+            bound.intValue = 0;
+            bound.realValue = 0;
+            if (predicate.type == COMPARE_PRED && predicate.value != nullptr) {
+                if (bound.attrType == TypeInt) {
+                    bound.intValue = *((const int32_t*) predicate.value);
+                } else if (bound.attrType == TypeReal) {
+                    bound.realValue = *((const float*) predicate.value);
+                } else {
+                    bound.varCharValue.assign((const char*) predicate.value + 4,
+                                              *((const uint32_t*) predicate.value));
+                }
+            }
+            bound.numOfTests = 0;
+            bound.numOfMatches = 0;
+            conditionGroups[groupNum].predicates.push_back(move(bound));
         }
     }
 
+    rbfm_ScanIterator.cancelPrefetch();
     rbfm_ScanIterator.recordDescriptor = recordDescriptor;
-    rbfm_ScanIterator.compOp = compOp;
-    rbfm_ScanIterator.value = value;
+    rbfm_ScanIterator.conditionGroups = move(conditionGroups);
+    rbfm_ScanIterator.numOfTestsBeforeReorder = PREDICATE_REORDER_INTERVAL;
+    rbfm_ScanIterator.zoneMap = condition.empty() ? nullptr : findZoneMap(fileHandle);
+    rbfm_ScanIterator.pageStates.assign(rbfm_ScanIterator.zoneMap ? fileHandle.getNumberOfPages() : 0,
+                                        RBFM_ScanIterator::PAGE_UNKNOWN);
+    rbfm_ScanIterator.stats = ScanStats();
     rbfm_ScanIterator.fileHandle = fileHandle;
     rbfm_ScanIterator.containData = false;
     rbfm_ScanIterator.numOfPages = fileHandle.getNumberOfPages();
     rbfm_ScanIterator.pageNum = 0;
+    if (fileHandle.isMapped()) {
+        rbfm_ScanIterator.fileHandle.adviseSequential();
+    }
 
     return SUCCESS;
 }
@@ -505,151 +672,941 @@ unsigned RecordBasedFileManager::computeRecordLength(const vector<Attribute> &re
     return recordLength;
 }
 
-RC RecordBasedFileManager::seekFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum)
+// Whether the flag (DIRECTORY_ENTRIES_BUFFERED or DIRECTORY_ZONES_CHANGED) is set for the file, i.e., the changes it
+// stands for were not written when the file was last used
+static bool isDirectoryOutOfDate(FileHandle &fileHandle, uint32_t flag)
 {
-    auto numOfPages = fileHandle.getNumberOfPages();
-    bool hasFreeHeader = false;
-    bool hasFreePage = false;
+    byte header[PAGE_SIZE];
+    return fileHandle.readHeaderPage(header) == SUCCESS && (*((uint32_t*) (header + DIRECTORY_STATE_OFFSET)) & flag);
+}
+
+static RC setDirectoryOutOfDate(FileHandle &fileHandle, uint32_t flag, bool isOutOfDate)
+{
+    byte header[PAGE_SIZE];
+    if (fileHandle.readHeaderPage(header) == FAIL) {
+        return FAIL;
+    }
+    uint32_t &state = *((uint32_t*) (header + DIRECTORY_STATE_OFFSET));
+    state = isOutOfDate ? (state | flag) : (state & ~flag);
+    return fileHandle.writeHeaderPage(header);
+}
+
+RC FreeSpaceMap::prepare(FileHandle &fileHandle)
+{
+    lock_guard<mutex> lock(mapMutex);
+    PageNum numOfFilePages = fileHandle.getNumberOfPages();
+    if (isBuilt && numOfPages == numOfFilePages) {
+        return SUCCESS;
+    }
+
+    isBuilt = false;
+    numOfPages = 0;
+    numOfLeaves = 0;
+    maxFreeBytes.clear();
+    changedPageNums.clear();
+    numOfChanges = 0;
+    if (isDirectoryOutOfDate(fileHandle, DIRECTORY_ENTRIES_BUFFERED)) {
+        if (readRecordPages(fileHandle, numOfFilePages) == FAIL || flushChanges(fileHandle) == FAIL) {
+            return FAIL;
+        }
+        numOfPages = numOfFilePages;
+        isBuilt = true;
+        return SUCCESS;
+    }
 
-    // scan all the directory header pages to look for a page with enough free space
-    PageNum headerNum = 0;
     byte header[PAGE_SIZE];
-    while (headerNum < numOfPages) {
-        fileHandle.readPage(headerNum, header);
+    for (PageNum headerNum = 0; headerNum < numOfFilePages;) {
+        if (fileHandle.readPage(headerNum, header) == FAIL) {
+            return FAIL;
+        }
         for (unsigned entryNum = 0; entryNum < MAX_NUM_OF_ENTRIES; ++entryNum) {
-            pageNum = *((PageNum*) (header + 6*entryNum));
+            PageNum pageNum = *((PageNum*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ)));
             if (pageNum == 0) {
-                hasFreeHeader = true;
-                break;
-            }
-            unsigned freeBytes = *((uint16_t*) (header + 6*entryNum + sizeof(PageNum)));
-            if (freeBytes >= size) {
-                hasFreePage = true;
                 break;
             }
+            setFreeBytes(pageNum, *((PageOffset*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ) + PAGE_NUM_SZ)));
         }
-        // if hasFreePage is true, there is no need to continue scanning
-        // if hasFreeHeader is true, we have reached the last directory header page
-        if (hasFreePage || hasFreeHeader) {
-            break;
+        PageNum nextHeaderNum = *((PageNum*) (header + PAGE_SIZE - sizeof(PageNum)));
+        headerNum = (nextHeaderNum == 0) ? numOfFilePages : nextHeaderNum;
+    }
+    numOfPages = numOfFilePages;
+    isBuilt = true;
+    return SUCCESS;
+}
+
+RC FreeSpaceMap::readRecordPages(FileHandle &fileHandle, PageNum numOfFilePages)
+{
+    const unsigned numOfPagesPerRead = 64;
+    PageBuffer pages(numOfPagesPerRead * PAGE_SIZE);
+    for (PageNum firstPageNum = 0; firstPageNum < numOfFilePages; firstPageNum += numOfPagesPerRead) {
+        unsigned count = min(numOfFilePages - firstPageNum, (PageNum) numOfPagesPerRead);
+        if (fileHandle.readPages(firstPageNum, count, pages.get()) == FAIL) {
+            return FAIL;
         }
-        PageNum nextHeaderNum = *((PageNum*) (header + PAGE_SIZE - sizeof(PageNum)));   // next directory header page
-        if (nextHeaderNum == 0) {
-            // we have reached the last directory header page
-            break;
+        for (unsigned i = 0; i < count; ++i) {
+            PageNum pageNum = firstPageNum + i;
+            if (!isHeaderPage(pageNum)) {
+                const byte *page = pages.get() + (size_t) i * PAGE_SIZE;
+                setFreeBytes(pageNum, *((const PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ)));
+                changedPageNums.insert(pageNum);
+            }
         }
-        headerNum = nextHeaderNum;
     }
+    return SUCCESS;
+}
 
-    if (!hasFreePage) {
-        if (!hasFreeHeader) {
-            // update the pointer to the next directory header page
-            *((PageNum*) (header + PAGE_SIZE - sizeof(PageNum))) = numOfPages;
-            fileHandle.writePage(headerNum, header);
-
-            // set numbers for new record page
-            memset(header, 0, PAGE_SIZE);
-            fileHandle.appendPage(header);
-            pageNum = numOfPages + 1;
-        } else {
-            // set number for new record page
-            pageNum = numOfPages;
-        }
+bool FreeSpaceMap::findPage(unsigned size, PageNum &pageNum, PageNum firstPageNum)
+{
+    lock_guard<mutex> lock(mapMutex);
+    if (maxFreeBytes.empty()) {
+        return false;
     }
+    return findLeaf(1, 0, numOfLeaves, size, firstPageNum, pageNum);
+}
 
-    return SUCCESS;
+bool FreeSpaceMap::findLeaf(size_t node, size_t nodeFirstPageNum, size_t nodeNumOfPages, unsigned size,
+                            PageNum firstPageNum, PageNum &pageNum) const
+{
+    // the subtree has no room or ends before firstPageNum
+    if (maxFreeBytes[node] < size || nodeFirstPageNum + nodeNumOfPages <= firstPageNum) {
+        return false;
+    }
+    if (node >= numOfLeaves) {
+        pageNum = node - numOfLeaves;
+        return true;
+    }
+    size_t half = nodeNumOfPages / 2;
+    return findLeaf(2 * node, nodeFirstPageNum, half, size, firstPageNum, pageNum)
+           || findLeaf(2 * node + 1, nodeFirstPageNum + half, half, size, firstPageNum, pageNum);
 }
 
-RC RecordBasedFileManager::updateFreeSpace(FileHandle &fileHandle, byte *page, PageNum pageNum, unsigned freeBytes)
+RC FreeSpaceMap::update(FileHandle &fileHandle, PageNum pageNum, unsigned freeBytes)
 {
-    *((uint16_t*) (page + PAGE_SIZE - FREE_SPACE_SZ)) = freeBytes;
-    unsigned entryNum = pageNum % (MAX_NUM_OF_ENTRIES + 1) - 1;
-    PageNum headerNum = pageNum - (entryNum + 1);
-    byte header[PAGE_SIZE];
-    fileHandle.readPage(headerNum, header);
-    *((PageNum*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ))) = pageNum;
-    *((uint16_t*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ) + PAGE_NUM_SZ)) = freeBytes;
-    fileHandle.writePage(headerNum, header);
+    lock_guard<mutex> lock(mapMutex);
+    setFreeBytes(pageNum, freeBytes);
+    if (pageNum >= numOfPages) {
+        numOfPages = pageNum + 1;
+        return writeEntry(fileHandle, pageNum, freeBytes);
+    }
 
+    // the file is marked before its directory falls behind
+    if (changedPageNums.empty() && setDirectoryOutOfDate(fileHandle, DIRECTORY_ENTRIES_BUFFERED, true) == FAIL) {
+        return FAIL;
+    }
+    changedPageNums.insert(pageNum);
+    if (++numOfChanges >= DIRECTORY_FLUSH_INTERVAL) {
+        return flushChanges(fileHandle);
+    }
     return SUCCESS;
 }
 
-void RecordBasedFileManager::writeRecord(byte *page,
-                                         unsigned recordOffset,
-                                         const vector<Attribute> &recordDescriptor,
-                                         const void *data)
+void FreeSpaceMap::addHeaderPage(PageNum pageNum)
 {
-    auto numOfFields = recordDescriptor.size();
+    lock_guard<mutex> lock(mapMutex);
+    numOfPages = max(numOfPages, pageNum + 1);
+}
 
-    // copy the null flags from record data in memory to page
-    memcpy(page + recordOffset, data, getBytesOfNullIndicator(numOfFields));
+RC FreeSpaceMap::flush(FileHandle &fileHandle)
+{
+    lock_guard<mutex> lock(mapMutex);
+    return flushChanges(fileHandle);
+}
 
-    // pointers to page data read from disk
-    byte *pOffset = page + recordOffset + getBytesOfNullIndicator(numOfFields);   // pointer to field offset
-    byte *pField = pOffset + numOfFields*FIELD_OFFSET_SZ;     // pointer to actual field data
-    unsigned fieldBegin = 0;    // begin offset of a field (relative to the start position of actual field data)
+RC FreeSpaceMap::writeEntry(FileHandle &fileHandle, PageNum pageNum, unsigned freeBytes)
+{
+    PageNum headerNum = getHeaderPageNum(pageNum);
+    unsigned entryNum = pageNum - headerNum - 1;
+    byte header[PAGE_SIZE];
+    if (fileHandle.readPage(headerNum, header) == FAIL) {
+        return FAIL;
+    }
+    *((PageNum*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ))) = pageNum;
+    *((PageOffset*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ) + PAGE_NUM_SZ)) = freeBytes;
+    return fileHandle.writePage(headerNum, header);
+}
 
-    // pointers to record data in memory
-    const byte *pFlag = (const byte*) data;
-    const byte *pData = pFlag + getBytesOfNullIndicator(numOfFields);
-    uint8_t flagMask = 0x80;
+RC FreeSpaceMap::flushChanges(FileHandle &fileHandle)
+{
+    if (changedPageNums.empty()) {
+        return SUCCESS;
+    }
 
-    for (const Attribute &attr : recordDescriptor) {
-        if (*pFlag & flagMask) {    // this field is NULL
-            *((uint16_t*) pOffset) = fieldBegin;
-        } else {
-            unsigned fieldLength;
-            switch (attr.type) {
-                case TypeInt:
-                case TypeReal:
-                    fieldLength = attr.length;
-                    break;
-                case TypeVarChar:
-                    fieldLength = *((const uint32_t*) pData);
-                    pData += 4;
-                    break;
+    // the changed pages are in order, so each directory header page is read and written once
+    byte header[PAGE_SIZE];
+    PageNum headerNum = 0;
+    bool isHeaderRead = false;
+    for (PageNum pageNum : changedPageNums) {
+        if (!isHeaderRead || getHeaderPageNum(pageNum) != headerNum) {
+            if (isHeaderRead && fileHandle.writePage(headerNum, header) == FAIL) {
+                return FAIL;
             }
-            *((uint16_t*) pOffset) = (fieldBegin += fieldLength);
-            memcpy(pField, pData, fieldLength);
-            pField += fieldLength;
-            pData += fieldLength;
+            headerNum = getHeaderPageNum(pageNum);
+            if (fileHandle.readPage(headerNum, header) == FAIL) {
+                return FAIL;
+            }
+            isHeaderRead = true;
         }
+        unsigned entryNum = pageNum - headerNum - 1;
+        *((PageNum*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ))) = pageNum;
+        *((PageOffset*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ) + PAGE_NUM_SZ)) = getFreeBytes(pageNum);
+    }
+    if (fileHandle.writePage(headerNum, header) == FAIL) {
+        return FAIL;
+    }
 
-        pOffset += FIELD_OFFSET_SZ;
-        if (flagMask == 0x01) {
-            flagMask = 0x80;
-            ++pFlag;
-        } else {
-            flagMask = flagMask >> 1;
-        }
+    changedPageNums.clear();
+    numOfChanges = 0;
+    return setDirectoryOutOfDate(fileHandle, DIRECTORY_ENTRIES_BUFFERED, false);
+}
+
+void FreeSpaceMap::truncate(PageNum numOfFilePages)
+{
+    lock_guard<mutex> lock(mapMutex);
+    for (PageNum pageNum = numOfFilePages; pageNum < numOfPages && pageNum < numOfLeaves; ++pageNum) {
+        setFreeBytes(pageNum, 0);
     }
+    changedPageNums.erase(changedPageNums.lower_bound(numOfFilePages), changedPageNums.end());
+    numOfPages = numOfFilePages;
 }
 
-void RecordBasedFileManager::readRecord(const byte *page,
-                                        unsigned recordOffset,
-                                        const vector<Attribute> &recordDescriptor,
-                                        void *data)
+unsigned FreeSpaceMap::getFreeBytes(PageNum pageNum) const
 {
-    auto numOfFields = recordDescriptor.size();
+    return (pageNum < numOfLeaves) ? maxFreeBytes[numOfLeaves + pageNum] : 0;
+}
 
-    // copy the null flags from page to record data returned to caller
-    memcpy(data, page + recordOffset, getBytesOfNullIndicator(numOfFields));
+void FreeSpaceMap::setFreeBytes(PageNum pageNum, unsigned freeBytes)
+{
+    if (pageNum >= numOfLeaves) {
+        if (freeBytes == 0) {
+            return;     // pages beyond the leaves have no free space
+        }
 
-    // pointers to page data
-    const byte *pOffset = page + recordOffset + getBytesOfNullIndicator(numOfFields);
-    const byte *pField = pOffset + numOfFields * FIELD_OFFSET_SZ;
-    unsigned fieldBegin = 0;    // begin offset of a field (relative to the start position of fields)
+        // double the number of leaves until the page fits, moving every level of the tree down by one
+        size_t newNumOfLeaves = max(numOfLeaves, (size_t) 1024);
+        while (newNumOfLeaves <= pageNum) {
+            newNumOfLeaves *= 2;
+        }
+        vector<PageOffset> newMaxFreeBytes(2 * newNumOfLeaves, 0);
+        for (size_t i = 0; i < numOfLeaves; ++i) {
+            newMaxFreeBytes[newNumOfLeaves + i] = maxFreeBytes[numOfLeaves + i];
+        }
+        for (size_t node = newNumOfLeaves - 1; node >= 1; --node) {
+            newMaxFreeBytes[node] = max(newMaxFreeBytes[2 * node], newMaxFreeBytes[2 * node + 1]);
+        }
+        maxFreeBytes.swap(newMaxFreeBytes);
+        numOfLeaves = newNumOfLeaves;
+    }
 
-    // pointers to record data that are returned to caller
-    byte *pFlag = (byte*) data;
-    byte *pData = pFlag + getBytesOfNullIndicator(numOfFields);
-    uint8_t flagMask = 0x80;
+    size_t node = numOfLeaves + pageNum;
+    maxFreeBytes[node] = freeBytes;
+    for (node /= 2; node >= 1; node /= 2) {
+        PageOffset maxOfChildren = max(maxFreeBytes[2 * node], maxFreeBytes[2 * node + 1]);
+        if (maxFreeBytes[node] == maxOfChildren) {
+            break;
+        }
+        maxFreeBytes[node] = maxOfChildren;
+    }
+}
 
-    for (const auto &attr : recordDescriptor) {
-        if (!(*pFlag & flagMask)) {
-            unsigned fieldEnd = *((uint16_t*) pOffset);    // end offset of the current field
-            unsigned fieldLength = fieldEnd - fieldBegin;
-            switch (attr.type) {
+RC ZoneMap::addAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned attrNum)
+{
+    {
+        lock_guard<mutex> lock(zoneMutex);
+        for (const Column &column : columns) {
+            if (column.attrNum == attrNum && column.numOfFields == recordDescriptor.size()) {
+                return SUCCESS;
+            }
+        }
+    }
+
+    Column column;
+    column.attrNum = attrNum;
+    column.numOfFields = recordDescriptor.size();
+    column.type = recordDescriptor[attrNum].type;
+    PageNum numOfPages = fileHandle.getNumberOfPages();
+    column.zones.resize(numOfPages);
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    byte page[PAGE_SIZE];
+    for (PageNum pageNum = 0; pageNum < numOfPages; ++pageNum) {
+        if (isHeaderPage(pageNum)) {
+            continue;
+        }
+        if (fileHandle.readPage(pageNum, page) == FAIL) {
+            return FAIL;
+        }
+        unsigned numOfSlots = rbfm->getNumOfSlots(page);
+        for (SlotNum slotNum = 0; slotNum < numOfSlots; ++slotNum) {
+            unsigned recordOffset = rbfm->getRecordOffset(page, slotNum);
+            if (rbfm->getRecordLength(page, slotNum) != 0 && recordOffset < PAGE_SIZE) {
+                addValue(column, column.zones[pageNum], page, recordOffset);
+            }
+        }
+    }
+
+    lock_guard<mutex> lock(zoneMutex);
+    columns.push_back(move(column));
+    isChanged = true;
+    return SUCCESS;
+}
+
+void ZoneMap::addRecord(PageNum pageNum, const byte *page, unsigned recordOffset, unsigned numOfFields)
+{
+    lock_guard<mutex> lock(zoneMutex);
+    isChanged = isChanged || !columns.empty();
+    for (Column &column : columns) {
+        if (pageNum >= column.zones.size()) {
+            column.zones.resize(pageNum + 1);
+        }
+        Zone &zone = column.zones[pageNum];
+        if (numOfFields != column.numOfFields) {
+            zone.isUnknown = true;
+        } else {
+            addValue(column, zone, page, recordOffset);
+        }
+    }
+}
+
+void ZoneMap::removeRecord(PageNum pageNum, const byte *page, unsigned recordOffset, unsigned numOfFields)
+{
+    // the bounds are kept: whether the record held one of them would take the other records of the page to tell
+    lock_guard<mutex> lock(zoneMutex);
+    isChanged = isChanged || !columns.empty();
+    for (Column &column : columns) {
+        if (pageNum >= column.zones.size() || numOfFields != column.numOfFields) {
+            continue;
+        }
+        Zone &zone = column.zones[pageNum];
+        unsigned attrNum = column.attrNum;
+        if (zone.numOfNulls > 0 && (page[recordOffset + attrNum / 8] & (0x80 >> (attrNum % 8)))) {
+            --zone.numOfNulls;
+        }
+    }
+}
+
+void ZoneMap::clearPage(PageNum pageNum)
+{
+    lock_guard<mutex> lock(zoneMutex);
+    isChanged = isChanged || !columns.empty();
+    for (Column &column : columns) {
+        if (pageNum < column.zones.size()) {
+            column.zones[pageNum] = Zone();
+        }
+    }
+}
+
+// Write data to a new file and rename it to fileName, syncing the file and then its directory, so that a crash
+// leaves either the old file or the whole new one behind, and the new one once this returns
+static bool replaceFileDurably(const string &fileName, const string &data)
+{
+    string tempFileName = fileName + ".tmp";
+    int fd = ::open(tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t length = ::write(fd, data.data() + offset, data.size() - offset);
+        if (length < 0 && errno != EINTR) {
+            break;
+        }
+        offset += (length > 0) ? length : 0;
+    }
+    bool isWritten = offset == data.size() && fsync(fd) == 0;
+    ::close(fd);
+    if (!isWritten || rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+        remove(tempFileName.c_str());
+        return false;
+    }
+
+    size_t slash = fileName.rfind('/');
+    string dirName = (slash == string::npos) ? "." : fileName.substr(0, max(slash, (size_t) 1));
+    int dirFd = ::open(dirName.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0) {
+        return false;
+    }
+    bool isSynced = fsync(dirFd) == 0;
+    ::close(dirFd);
+    return isSynced;
+}
+
+RC ZoneMap::load(FileHandle &fileHandle)
+{
+    string mapFileName = getMapFileName(fileHandle.getFileName());
+    if (isDirectoryOutOfDate(fileHandle, DIRECTORY_ZONES_CHANGED)) {
+        // the records changed after the zones were saved
+        remove(mapFileName.c_str());
+        setDirectoryOutOfDate(fileHandle, DIRECTORY_ZONES_CHANGED, false);
+        return FAIL;
+    }
+    ifstream file(mapFileName, fstream::in | fstream::binary);
+    if (!file) {
+        return FAIL;
+    }
+
+    auto readWord = [&file]() {
+        uint32_t word = 0;
+        file.read((char*) &word, sizeof(word));
+        return word;
+    };
+    auto readVarChar = [&file, &readWord](string &value) {
+        uint32_t length = readWord();
+        if (file && length <= PAGE_SIZE) {
+            value.resize(length);
+            file.read(&value[0], length);
+        } else {
+            file.setstate(ios::failbit);
+        }
+    };
+    // the pages released at the end of the file since the zones were saved have empty zones, which are dropped
+    PageNum numOfPages = fileHandle.getNumberOfPages();
+    uint32_t numOfColumns = readWord();
+    vector<Column> newColumns;
+    for (uint32_t columnNum = 0; columnNum < numOfColumns && file; ++columnNum) {
+        Column column;
+        column.attrNum = readWord();
+        column.numOfFields = readWord();
+        column.type = (AttrType) readWord();
+        uint32_t numOfZones = readWord();
+        if (!file || column.attrNum >= column.numOfFields || column.type > TypeVarChar) {
+            return FAIL;
+        }
+        for (uint32_t zoneNum = 0; zoneNum < numOfZones && file; ++zoneNum) {
+            Zone zone;
+            uint32_t flags = readWord();
+            zone.isUnknown = flags & 0x1;
+            zone.hasValues = flags & 0x2;
+            zone.numOfNulls = readWord();
+            if (zone.hasValues) {
+                switch (column.type) {
+                    case TypeInt:
+                        file.read((char*) &zone.minInt, sizeof(zone.minInt));
+                        file.read((char*) &zone.maxInt, sizeof(zone.maxInt));
+                        break;
+                    case TypeReal:
+                        file.read((char*) &zone.minReal, sizeof(zone.minReal));
+                        file.read((char*) &zone.maxReal, sizeof(zone.maxReal));
+                        break;
+                    case TypeVarChar:
+                        readVarChar(zone.minVarChar);
+                        readVarChar(zone.maxVarChar);
+                        break;
+                }
+            }
+            if (zoneNum < numOfPages) {
+                column.zones.push_back(move(zone));
+            }
+        }
+        newColumns.push_back(move(column));
+    }
+    if (!file) {
+        return FAIL;
+    }
+
+    lock_guard<mutex> lock(zoneMutex);
+    columns.swap(newColumns);
+    isChanged = false;
+    return SUCCESS;
+}
+
+RC ZoneMap::save(FileHandle &fileHandle)
+{
+    lock_guard<mutex> lock(zoneMutex);
+    if (!isChanged && !isMarked) {
+        return SUCCESS;
+    }
+
+    ostringstream buffer(ios::out | ios::binary);
+    auto writeWord = [&buffer](uint32_t word) {
+        buffer.write((const char*) &word, sizeof(word));
+    };
+    auto writeVarChar = [&buffer, &writeWord](const string &value) {
+        writeWord(value.size());
+        buffer.write(value.data(), value.size());
+    };
+    writeWord(columns.size());
+    for (const Column &column : columns) {
+        writeWord(column.attrNum);
+        writeWord(column.numOfFields);
+        writeWord(column.type);
+        writeWord(column.zones.size());
+        for (const Zone &zone : column.zones) {
+            writeWord((zone.isUnknown ? 0x1 : 0) | (zone.hasValues ? 0x2 : 0));
+            writeWord(zone.numOfNulls);
+            if (!zone.hasValues) {
+                continue;
+            }
+            switch (column.type) {
+                case TypeInt:
+                    buffer.write((const char*) &zone.minInt, sizeof(zone.minInt));
+                    buffer.write((const char*) &zone.maxInt, sizeof(zone.maxInt));
+                    break;
+                case TypeReal:
+                    buffer.write((const char*) &zone.minReal, sizeof(zone.minReal));
+                    buffer.write((const char*) &zone.maxReal, sizeof(zone.maxReal));
+                    break;
+                case TypeVarChar:
+                    writeVarChar(zone.minVarChar);
+                    writeVarChar(zone.maxVarChar);
+                    break;
+            }
+        }
+    }
+    if (!buffer || !replaceFileDurably(getMapFileName(fileHandle.getFileName()), buffer.str())) {
+        return FAIL;
+    }
+    isChanged = false;
+    if (isMarked) {
+        if (setDirectoryOutOfDate(fileHandle, DIRECTORY_ZONES_CHANGED, false) == FAIL) {
+            return FAIL;
+        }
+        isMarked = false;
+    }
+    return SUCCESS;
+}
+
+RC ZoneMap::markChanged(FileHandle &fileHandle)
+{
+    lock_guard<mutex> lock(zoneMutex);
+    if (isMarked || columns.empty()) {
+        return SUCCESS;
+    }
+    if (setDirectoryOutOfDate(fileHandle, DIRECTORY_ZONES_CHANGED, true) == FAIL) {
+        return FAIL;
+    }
+    isMarked = true;
+    return SUCCESS;
+}
+
+bool ZoneMap::canSkipPage(PageNum pageNum, unsigned numOfFields,
+                          const vector<RBFM_ScanIterator::PredicateGroup> &conditionGroups)
+{
+    lock_guard<mutex> lock(zoneMutex);
+    for (const RBFM_ScanIterator::PredicateGroup &group : conditionGroups) {
+        bool mayGroupMatch = false;
+        for (const RBFM_ScanIterator::BoundPredicate &predicate : group.predicates) {
+            const Zone *zone = nullptr;
+            for (const Column &column : columns) {
+                if (column.attrNum == predicate.attrNum && column.numOfFields == numOfFields
+                    && pageNum < column.zones.size()) {
+                    zone = &column.zones[pageNum];
+                    break;
+                }
+            }
+            if (zone == nullptr || mayMatch(*zone, predicate)) {
+                mayGroupMatch = true;
+                break;
+            }
+        }
+        if (!mayGroupMatch) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ZoneMap::addValue(Column &column, Zone &zone, const byte *page, unsigned recordOffset)
+{
+    unsigned attrNum = column.attrNum;
+    if (page[recordOffset + attrNum / 8] & (0x80 >> (attrNum % 8))) {
+        ++zone.numOfNulls;
+        return;
+    }
+
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    unsigned beginOffset = rbfm->getFieldBeginOffset(page, recordOffset, attrNum, column.numOfFields);
+    unsigned fieldLength = rbfm->getFieldEndOffset(page, recordOffset, attrNum, column.numOfFields) - beginOffset;
+    const byte *field = page + recordOffset + beginOffset;
+    bool isFirstValue = !zone.hasValues;
+    zone.hasValues = true;
+    switch (column.type) {
+        case TypeInt: {
+            int32_t i;
+            memcpy(&i, field, sizeof(i));
+            zone.minInt = isFirstValue ? i : min(zone.minInt, i);
+            zone.maxInt = isFirstValue ? i : max(zone.maxInt, i);
+            break;
+        }
+        case TypeReal: {
+            float r;
+            memcpy(&r, field, sizeof(r));
+            zone.minReal = isFirstValue ? r : min(zone.minReal, r);
+            zone.maxReal = isFirstValue ? r : max(zone.maxReal, r);
+            break;
+        }
+        case TypeVarChar: {
+            const string &minValue = zone.minVarChar;
+            const string &maxValue = zone.maxVarChar;
+            if (isFirstValue || compareVarChar(field, fieldLength, minValue.data(), minValue.size()) < 0) {
+                zone.minVarChar.assign((const char*) field, fieldLength);
+            }
+            if (isFirstValue || compareVarChar(field, fieldLength, maxValue.data(), maxValue.size()) > 0) {
+                zone.maxVarChar.assign((const char*) field, fieldLength);
+            }
+            break;
+        }
+    }
+}
+
+bool ZoneMap::mayMatch(const Zone &zone, const RBFM_ScanIterator::BoundPredicate &predicate) const
+{
+    if (zone.isUnknown) {
+        return true;
+    }
+    if (predicate.type == IS_NULL_PRED) {
+        return zone.numOfNulls > 0;
+    }
+    if (predicate.type == NOT_NULL_PRED) {
+        return zone.hasValues;
+    }
+
+    // a comparison is only satisfied by non-NULL fields, and a NULL value only by !=
+    if (!zone.hasValues || predicate.isValueNull) {
+        return zone.hasValues && predicate.compOp == NE_OP;
+    }
+
+    // compare the smallest and the largest values of the page with the value
+    int minComparison = 0;
+    int maxComparison = 0;
+    switch (predicate.attrType) {
+        case TypeInt:
+            minComparison = (zone.minInt > predicate.intValue) - (zone.minInt < predicate.intValue);
+            maxComparison = (zone.maxInt > predicate.intValue) - (zone.maxInt < predicate.intValue);
+            break;
+        case TypeReal:
+            minComparison = (zone.minReal > predicate.realValue) - (zone.minReal < predicate.realValue);
+            maxComparison = (zone.maxReal > predicate.realValue) - (zone.maxReal < predicate.realValue);
+            break;
+        case TypeVarChar: {
+            const string &value = predicate.varCharValue;
+            minComparison = compareVarChar(zone.minVarChar.data(), zone.minVarChar.size(), value.data(), value.size());
+            maxComparison = compareVarChar(zone.maxVarChar.data(), zone.maxVarChar.size(), value.data(), value.size());
+            break;
+        }
+    }
+    switch (predicate.compOp) {
+        case EQ_OP: return minComparison <= 0 && maxComparison >= 0;
+        case LT_OP: return minComparison < 0;
+        case LE_OP: return minComparison <= 0;
+        case GT_OP: return maxComparison > 0;
+        case GE_OP: return maxComparison >= 0;
+        case NE_OP: return minComparison != 0 || maxComparison != 0;
+        default: return true;
+    }
+}
+
+RC RecordBasedFileManager::createZoneMap(FileHandle &fileHandle,
+                                         const vector<Attribute> &recordDescriptor,
+                                         const string &attributeName)
+{
+    unsigned attrNum = 0;
+    while (attrNum < recordDescriptor.size() && recordDescriptor[attrNum].name != attributeName) {
+        ++attrNum;
+    }
+    FileId fileId;
+    if (attrNum == recordDescriptor.size() || fileHandle.getFileId(fileId) == FAIL) {
+        return FAIL;
+    }
+    findZoneMap(fileHandle);    // the saved zones of the other attributes are kept
+    shared_ptr<ZoneMap> zoneMap;
+    {
+        lock_guard<mutex> lock(zoneMapsMutex);
+        shared_ptr<ZoneMap> &fileZoneMap = zoneMaps[fileId];
+        if (!fileZoneMap) {
+            fileZoneMap = make_shared<ZoneMap>();
+        }
+        zoneMap = fileZoneMap;
+    }
+    return zoneMap->addAttribute(fileHandle, recordDescriptor, attrNum);
+}
+
+shared_ptr<ZoneMap> RecordBasedFileManager::findZoneMap(FileHandle &fileHandle)
+{
+    FileId fileId;
+    if (fileHandle.getFileId(fileId) == FAIL) {
+        return nullptr;
+    }
+    lock_guard<mutex> lock(zoneMapsMutex);
+    auto it = zoneMaps.find(fileId);
+    if (it != zoneMaps.end()) {
+        return it->second;
+    }
+
+    // a file without saved zones keeps a null entry, so that it is looked for once
+    shared_ptr<ZoneMap> zoneMap = make_shared<ZoneMap>();
+    if (zoneMap->load(fileHandle) == FAIL) {
+        zoneMap = nullptr;
+    }
+    zoneMaps[fileId] = zoneMap;
+    return zoneMap;
+}
+
+RC RecordBasedFileManager::seekFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum, PageNum firstPageNum)
+{
+    shared_ptr<FreeSpaceMap> freeSpaceMap = getFreeSpaceMap(fileHandle);
+    if (!freeSpaceMap) {
+        return FAIL;
+    }
+    if (freeSpaceMap->findPage(size, pageNum, firstPageNum)) {
+        return SUCCESS;
+    }
+
+    // no record page has enough free space, so a new one is appended after the last page
+    PageNum numOfPages = fileHandle.getNumberOfPages();
+    bool hasFreeHeader = !isHeaderPage(numOfPages);
+
+    // the file must have room for the new record page (and a new directory header page if needed)
+    if (numOfPages >= MAX_NUM_OF_PAGES - (hasFreeHeader ? 0 : 1)) {
+        return FAIL;
+    }
+    if (!hasFreeHeader) {
+        // update the pointer to the next directory header page
+        PageNum headerNum = getHeaderPageNum(numOfPages - 1);
+        byte header[PAGE_SIZE];
+        if (fileHandle.readPage(headerNum, header) == FAIL) {
+            return FAIL;
+        }
+        *((PageNum*) (header + PAGE_SIZE - sizeof(PageNum))) = numOfPages;
+        if (fileHandle.writePage(headerNum, header) == FAIL) {
+            return FAIL;
+        }
+
+        // set numbers for new record page
+        memset(header, 0, PAGE_SIZE);
+        if (fileHandle.appendPage(header) == FAIL) {
+            return FAIL;
+        }
+        freeSpaceMap->addHeaderPage(numOfPages);
+        pageNum = numOfPages + 1;
+    } else {
+        // set number for new record page
+        pageNum = numOfPages;
+    }
+
+    return SUCCESS;
+}
+
+RC RecordBasedFileManager::updateFreeSpace(FileHandle &fileHandle, byte *page, PageNum pageNum, unsigned freeBytes)
+{
+    *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ)) = freeBytes;
+    shared_ptr<FreeSpaceMap> freeSpaceMap = getFreeSpaceMap(fileHandle);
+    if (!freeSpaceMap) {
+        return FAIL;
+    }
+    return freeSpaceMap->update(fileHandle, pageNum, freeBytes);
+}
+
+SlotNum RecordBasedFileManager::addRecordToPage(byte *page,
+                                                const vector<Attribute> &recordDescriptor,
+                                                const void *data,
+                                                unsigned recordLength,
+                                                unsigned &freeBytes)
+{
+    setFreeBytes(page, freeBytes);
+    SlotNum numOfSlots = getNumOfSlots(page);    // number of slots (including slots that don't contain a valid record)
+
+    // take the first free slot, or add a new one to slot directory
+    SlotNum slotNum = numOfSlots;
+    if (getFreeSlotHead(page) != 0) {
+        slotNum = getFreeSlotHead(page) - 1;
+        setFreeSlotHead(page, getRecordOffset(page, slotNum));
+    }
+    unsigned size = recordLength + ((slotNum >= numOfSlots) ? SLOT_OFFSET_SZ + SLOT_LENGTH_SZ : 0);
+    if (freeBytes - getFragmentedBytes(page) < size) {
+        compactPage(page);
+    }
+    unsigned recordOffset = getFreeSpaceOffset(page);   // offset of the new record in the page
+    setRecordOffset(page, slotNum, recordOffset);
+    setRecordLength(page, slotNum, recordLength);
+
+    // update number of free space and number of slots in slot directory
+    if (slotNum >= numOfSlots) {
+        setNumOfSlots(page, numOfSlots + 1);
+    }
+    freeBytes -= size;
+    setFreeBytes(page, freeBytes);
+
+    // write the new record to page
+    writeRecord(page, recordOffset, recordDescriptor, data);
+    return slotNum;
+}
+
+void RecordBasedFileManager::releaseSlot(byte *page, SlotNum slotNum)
+{
+    setRecordLength(page, slotNum, 0);
+    setRecordOffset(page, slotNum, getFreeSlotHead(page));
+    setFreeSlotHead(page, slotNum + 1);
+}
+
+void RecordBasedFileManager::freeRecordSpace(byte *page, unsigned offset, unsigned length)
+{
+    if (offset + length != getFreeSpaceOffset(page)) {
+        setFragmentedBytes(page, getFragmentedBytes(page) + length);
+    }
+    setFreeBytes(page, getFreeBytes(page) + length);
+}
+
+void RecordBasedFileManager::compactPage(byte *page)
+{
+    // (offset, slot) of the records and pointers in the page, in the order they are stored
+    vector<pair<unsigned, SlotNum>> records;
+    SlotNum numOfSlots = getNumOfSlots(page);
+    for (SlotNum slotNum = 0; slotNum < numOfSlots; ++slotNum) {
+        if (getRecordLength(page, slotNum) != 0) {
+            records.push_back(make_pair(getRecordOffset(page, slotNum) % PAGE_SIZE, slotNum));
+        }
+    }
+    sort(records.begin(), records.end());
+
+    unsigned nextOffset = 0;
+    for (const pair<unsigned, SlotNum> &record : records) {
+        bool isPointer = getRecordOffset(page, record.second) >= PAGE_SIZE;
+        unsigned length = isPointer ? RID_SZ : getRecordLength(page, record.second);
+        memmove(page + nextOffset, page + record.first, length);
+        setRecordOffset(page, record.second, isPointer ? nextOffset + PAGE_SIZE : nextOffset);
+        nextOffset += length;
+    }
+    setFragmentedBytes(page, 0);
+}
+
+RC RecordBasedFileManager::flushFreeSpace(FileHandle &fileHandle)
+{
+    shared_ptr<FreeSpaceMap> freeSpaceMap = findFreeSpaceMap(fileHandle);
+    if (freeSpaceMap && freeSpaceMap->flush(fileHandle) == FAIL) {
+        return FAIL;
+    }
+    shared_ptr<ZoneMap> zoneMap = findZoneMap(fileHandle);
+    return zoneMap ? zoneMap->save(fileHandle) : SUCCESS;
+}
+
+RC RecordBasedFileManager::releaseTrailingPages(FileHandle &fileHandle)
+{
+    // the entries of the released pages are cleared in the directory itself
+    if (flushFreeSpace(fileHandle) == FAIL) {
+        return FAIL;
+    }
+
+    byte page[PAGE_SIZE];
+    byte header[PAGE_SIZE];
+    PageNum pageNum = fileHandle.getNumberOfPages() - 1;
+    for (; pageNum > 0; --pageNum) {
+        PageNum headerNum = getHeaderPageNum(pageNum);
+        if (pageNum == headerNum) {
+            // all the pages of this directory have been released, so unlink it from the previous one
+            PageNum prevHeaderNum = headerNum - (MAX_NUM_OF_ENTRIES + 1);
+            if (fileHandle.readPage(prevHeaderNum, header) == FAIL) {
+                return FAIL;
+            }
+            *((PageNum*) (header + PAGE_SIZE - sizeof(PageNum))) = 0;
+            if (fileHandle.writePage(prevHeaderNum, header) == FAIL) {
+                return FAIL;
+            }
+        } else {
+            if (fileHandle.readPage(pageNum, page) == FAIL) {
+                return FAIL;
+            }
+            if (getNumOfSlots(page) != 0) {
+                break;
+            }
+
+            // the directory entries of released pages are cleared, so that the entries still end at the first 0
+            unsigned entryNum = pageNum - headerNum - 1;
+            if (fileHandle.readPage(headerNum, header) == FAIL) {
+                return FAIL;
+            }
+            memset(header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ), 0, PAGE_NUM_SZ + FREE_SPACE_SZ);
+            if (fileHandle.writePage(headerNum, header) == FAIL) {
+                return FAIL;
+            }
+        }
+        if (fileHandle.freePage(pageNum) == FAIL) {
+            return FAIL;
+        }
+    }
+
+    RC rc = fileHandle.shrink();
+    shared_ptr<FreeSpaceMap> freeSpaceMap = findFreeSpaceMap(fileHandle);
+    if (freeSpaceMap) {
+        freeSpaceMap->truncate(fileHandle.getNumberOfPages());
+    }
+    return rc;
+}
+
+void RecordBasedFileManager::writeRecord(byte *page,
+                                         unsigned recordOffset,
+                                         const vector<Attribute> &recordDescriptor,
+                                         const void *data)
+{
+    auto numOfFields = recordDescriptor.size();
+
+    // copy the null flags from record data in memory to page
+    memcpy(page + recordOffset, data, getBytesOfNullIndicator(numOfFields));
+
+    // pointers to page data read from disk
+    byte *pOffset = page + recordOffset + getBytesOfNullIndicator(numOfFields);   // pointer to field offset
+    byte *pField = pOffset + numOfFields*FIELD_OFFSET_SZ;     // pointer to actual field data
+    unsigned fieldBegin = 0;    // begin offset of a field (relative to the start position of actual field data)
+
+    // pointers to record data in memory
+    const byte *pFlag = (const byte*) data;
+    const byte *pData = pFlag + getBytesOfNullIndicator(numOfFields);
+    uint8_t flagMask = 0x80;
+
+    for (const Attribute &attr : recordDescriptor) {
+        if (*pFlag & flagMask) {    // this field is NULL
+            *((PageOffset*) pOffset) = fieldBegin;
+        } else {
+            unsigned fieldLength;
+            switch (attr.type) {
+                case TypeInt:
+                case TypeReal:
+                    fieldLength = attr.length;
+                    break;
+                case TypeVarChar:
+                    fieldLength = *((const uint32_t*) pData);
+                    pData += 4;
+                    break;
+            }
+            *((PageOffset*) pOffset) = (fieldBegin += fieldLength);
+            memcpy(pField, pData, fieldLength);
+            pField += fieldLength;
+            pData += fieldLength;
+        }
+
+        pOffset += FIELD_OFFSET_SZ;
+        if (flagMask == 0x01) {
+            flagMask = 0x80;
+            ++pFlag;
+        } else {
+            flagMask = flagMask >> 1;
+        }
+    }
+}
+
+void RecordBasedFileManager::readRecord(const byte *page,
+                                        unsigned recordOffset,
+                                        const vector<Attribute> &recordDescriptor,
+                                        void *data)
+{
+    auto numOfFields = recordDescriptor.size();
+
+    // copy the null flags from page to record data returned to caller
+    memcpy(data, page + recordOffset, getBytesOfNullIndicator(numOfFields));
+
+    // pointers to page data
+    const byte *pOffset = page + recordOffset + getBytesOfNullIndicator(numOfFields);
+    const byte *pField = pOffset + numOfFields * FIELD_OFFSET_SZ;
+    unsigned fieldBegin = 0;    // begin offset of a field (relative to the start position of fields)
+
+    // pointers to record data that are returned to caller
+    byte *pFlag = (byte*) data;
+    byte *pData = pFlag + getBytesOfNullIndicator(numOfFields);
+    uint8_t flagMask = 0x80;
+
+    for (const auto &attr : recordDescriptor) {
+        if (!(*pFlag & flagMask)) {
+            unsigned fieldEnd = *((PageOffset*) pOffset);    // end offset of the current field
+            unsigned fieldLength = fieldEnd - fieldBegin;
+            switch (attr.type) {
                 case TypeInt:
                 case TypeReal:
                     break;
@@ -710,18 +1667,77 @@ RBFM_ScanIterator::RBFM_ScanIterator(): rbfm(RecordBasedFileManager::instance())
 RBFM_ScanIterator::~RBFM_ScanIterator()
 {
     close();
+    PageArena::instance().release(prefetchBuffer, SCAN_PREFETCH_DEPTH * PAGE_SIZE);
+}
+
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+                                        const vector<Attribute> &recordDescriptor,
+                                        const string &conditionAttribute,
+                                        const CompOp compOp,
+                                        const void *value,
+                                        const vector<string> &attributeNames,
+                                        unsigned numOfThreads,
+                                        bool isOrdered,
+                                        RBFM_ParallelScanIterator &rbfm_ParallelScanIterator)
+{
+    return parallelScan(fileHandle, recordDescriptor, getComparisonCondition(conditionAttribute, compOp, value),
+                        attributeNames, numOfThreads, isOrdered, rbfm_ParallelScanIterator);
+}
+
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+                                        const vector<Attribute> &recordDescriptor,
+                                        const ScanCondition &condition,
+                                        const vector<string> &attributeNames,
+                                        unsigned numOfThreads,
+                                        bool isOrdered,
+                                        RBFM_ParallelScanIterator &rbfm_ParallelScanIterator)
+{
+    rbfm_ParallelScanIterator.close();
+    if (numOfThreads == 0) {
+        numOfThreads = max(1u, thread::hardware_concurrency());
+    }
+
+    auto &iterators = rbfm_ParallelScanIterator.iterators;
+    for (unsigned i = 0; i < numOfThreads; ++i) {
+        iterators.emplace_back(new RBFM_ScanIterator());
+        if (scan(fileHandle, recordDescriptor, condition, attributeNames, *iterators.back()) == FAIL) {
+            rbfm_ParallelScanIterator.close();
+            return FAIL;
+        }
+    }
+    rbfm_ParallelScanIterator.isOrdered = isOrdered;
+    rbfm_ParallelScanIterator.numOfPages = fileHandle.getNumberOfPages();
+    rbfm_ParallelScanIterator.start(numOfThreads);
+    return SUCCESS;
 }
 
 RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data)
 {
+    RecordView view;
+    if (getNextRecord(rid, view) == RBFM_EOF) {
+        return RBFM_EOF;
+    }
+    view.materialize(data);
+    return SUCCESS;
+}
+
+RC RBFM_ScanIterator::getNextRecord(RID &rid, RecordView &view)
+{
+    // the file may have been truncated by deletes since the scan started
+    numOfPages = min(numOfPages, fileHandle.getNumberOfPages());
     for (; pageNum < numOfPages; ++pageNum) {
         if (isHeaderPage(pageNum)) {
             continue;
         }
 
+        if (!containData && isPageSkipped(pageNum)) {
+            ++stats.numOfPagesSkipped;
+            continue;
+        }
+
         if (!containData) {
             containData = true;
-            fileHandle.readPage(pageNum, page);
+            loadPage();
             numOfSlots = rbfm->getNumOfSlots(page);
             slotNum = 0;
         }
@@ -736,20 +1752,9 @@ RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data)
                 continue;
             }
 
-            bool compareResult;
-            if (compOp == NO_OP) {
-                compareResult = true;
-            } else {
-                unique_ptr<byte[]> field(new byte[recordLength]);
-                Attribute conditionAttr = recordDescriptor[conditionAttrNum];
-                auto numOfFields = recordDescriptor.size();
-                if (!rbfm->readField(page, recordOffset, conditionAttrNum, numOfFields, conditionAttr, field.get())) {
-                    field.reset();
-                }
-                compareResult = compareAttribute(conditionAttr.type, compOp, field.get(), value);
-            }
-            if (compareResult) {
-                readRecord(recordOffset, data);
+            if (satisfiesCondition(recordOffset)) {
+                view.iterator = this;
+                view.recordOffset = recordOffset;
                 rid.pageNum = pageNum;
                 rid.slotNum = slotNum++;
                 return SUCCESS;
@@ -758,33 +1763,154 @@ RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data)
 
         // have scanned all slots in this page
         containData = false;
+        releasePage();
     }
 
     return RBFM_EOF;
 }
 
+RC RBFM_ScanIterator::getNextBatch(RecordBatch &batch)
+{
+    batch.reset(recordDescriptor, attrNums);
+    RID rid;
+    RecordView view;
+    while (batch.numOfRecords < batch.capacity && getNextRecord(rid, view) != RBFM_EOF) {
+        batch.append(rid, view);
+    }
+    return (batch.numOfRecords == 0) ? RBFM_EOF : SUCCESS;
+}
+
 RC RBFM_ScanIterator::close()
 {
+    cancelPrefetch();
     containData = false;
     numOfPages = 0;
     pageNum = 0;
     numOfSlots = 0;
     slotNum = 0;
+    zoneMap = nullptr;
+    pageStates.clear();
     rbfm->closeFile(fileHandle);
     return SUCCESS;
 }
 
-void RBFM_ScanIterator::readRecord(unsigned recordOffset, void *data)
+void RBFM_ScanIterator::setPageRange(PageNum firstPageNum, PageNum endPageNum)
+{
+    cancelPrefetch();
+    containData = false;
+    numOfPages = endPageNum;
+    pageNum = firstPageNum;
+    nextPrefetchNum = firstPageNum;
+}
+
+void RBFM_ScanIterator::loadPage()
+{
+    ++stats.numOfPagesRead;
+    if (prefetchBuffer == nullptr) {
+        prefetchBuffer = PageArena::instance().allocate(SCAN_PREFETCH_DEPTH * PAGE_SIZE);
+    }
+
+    if (fileHandle.isMapped()) {
+        if (pageNum >= nextPrefetchNum) {
+            fileHandle.prefetchMappedPages(pageNum, SCAN_MADVISE_WINDOW);
+            nextPrefetchNum = pageNum + SCAN_MADVISE_WINDOW;
+        }
+        if (fileHandle.mapPage(pageNum, page) == FAIL) {
+            fileHandle.readPage(pageNum, prefetchBuffer);
+            page = prefetchBuffer;
+        }
+        return;
+    }
+
+    prefetchPages();
+    unsigned requestSlot = requestSlots[prefetchHead];
+    byte *buffer = prefetchBuffer + prefetchHead * PAGE_SIZE;
+    if (fileHandle.waitPages(&prefetchRequests[requestSlot], 1) == FAIL
+        || fileHandle.getWriteVersion() != prefetchVersions[requestSlot]) {
+        // the page may have been modified since it was requested
+        fileHandle.readPage(pageNum, buffer);
+    }
+    page = buffer;
+}
+
+void RBFM_ScanIterator::releasePage()
+{
+    if (numOfPrefetched > 0) {
+        prefetchHead = (prefetchHead + 1) % SCAN_PREFETCH_DEPTH;
+        --numOfPrefetched;
+    }
+}
+
+void RBFM_ScanIterator::prefetchPages()
+{
+    // refill the ring only when half of it is free, so that the requests are large
+    if (numOfPrefetched > SCAN_PREFETCH_DEPTH / 2) {
+        return;
+    }
+
+    uint64_t version = fileHandle.getWriteVersion();
+    while (numOfPrefetched < SCAN_PREFETCH_DEPTH && nextPrefetchNum < numOfPages) {
+        if (isHeaderPage(nextPrefetchNum) || isPageSkipped(nextPrefetchNum)) {
+            ++nextPrefetchNum;
+            continue;
+        }
+
+        // a request stops at a directory page, a skipped page and at the end of the ring
+        unsigned firstSlot = (prefetchHead + numOfPrefetched) % SCAN_PREFETCH_DEPTH;
+        unsigned count = 0;
+        while (numOfPrefetched < SCAN_PREFETCH_DEPTH && firstSlot + count < SCAN_PREFETCH_DEPTH
+               && nextPrefetchNum < numOfPages && !isHeaderPage(nextPrefetchNum)
+               && !isPageSkipped(nextPrefetchNum)) {
+            requestSlots[firstSlot + count] = firstSlot;
+            ++count;
+            ++numOfPrefetched;
+            ++nextPrefetchNum;
+        }
+
+        AsyncPageIO &request = prefetchRequests[firstSlot];
+        request.pageNum = nextPrefetchNum - count;
+        request.numOfPages = count;
+        request.data = prefetchBuffer + firstSlot * PAGE_SIZE;
+        request.isWrite = false;
+        prefetchVersions[firstSlot] = version;
+        fileHandle.submitPages(&request, 1);
+    }
+}
+
+bool RBFM_ScanIterator::isPageSkipped(PageNum pageNum)
 {
+    if (pageNum >= pageStates.size()) {
+        return false;
+    }
+    if (pageStates[pageNum] == PAGE_UNKNOWN) {
+        bool canSkip = zoneMap->canSkipPage(pageNum, recordDescriptor.size(), conditionGroups);
+        pageStates[pageNum] = canSkip ? PAGE_SKIPPED : PAGE_READ;
+    }
+    return pageStates[pageNum] == PAGE_SKIPPED;
+}
+
+void RBFM_ScanIterator::cancelPrefetch()
+{
+    for (unsigned i = 0; i < numOfPrefetched; ++i) {
+        fileHandle.waitPages(&prefetchRequests[requestSlots[(prefetchHead + i) % SCAN_PREFETCH_DEPTH]], 1);
+    }
+    prefetchHead = 0;
+    numOfPrefetched = 0;
+    nextPrefetchNum = 0;
+}
+
+void RecordView::materialize(void *data) const
+{
+    const vector<unsigned> &attrNums = iterator->attrNums;
     memset(data, 0, getBytesOfNullIndicator(attrNums.size()));
 
     byte *pFlag = (byte*) data;
     byte *pData = pFlag + getBytesOfNullIndicator(attrNums.size());
     uint8_t flagMask = 0x80;
-    auto numOfFields = recordDescriptor.size();
+    auto numOfFields = iterator->recordDescriptor.size();
     for (auto attrNum : attrNums) {
-        Attribute attr = recordDescriptor[attrNum];
-        void *pNext = rbfm->readField(page, recordOffset, attrNum, numOfFields, attr, pData);
+        const Attribute &attr = iterator->recordDescriptor[attrNum];
+        void *pNext = iterator->rbfm->readField(iterator->page, recordOffset, attrNum, numOfFields, attr, pData);
         if (pNext == nullptr) {
             *pFlag = *pFlag | flagMask;
         } else {
@@ -800,6 +1926,275 @@ void RBFM_ScanIterator::readRecord(unsigned recordOffset, void *data)
     }
 }
 
+RecordBatch::RecordBatch(unsigned capacity): capacity(capacity), rids(capacity)
+{
+    assert(capacity > 0);
+}
+
+void RecordBatch::reset(const vector<Attribute> &recordDescriptor, const vector<unsigned> &attrNums)
+{
+    numOfRecords = 0;
+    columns.resize(attrNums.size());
+    for (unsigned columnNum = 0; columnNum < attrNums.size(); columnNum++) {
+        Column &column = columns[columnNum];
+        column.type = recordDescriptor[attrNums[columnNum]].type;
+        column.nulls.assign((capacity + 7) / 8, 0);
+        switch (column.type) {
+            case TypeInt:
+                column.ints.resize(capacity);
+                break;
+            case TypeReal:
+                column.reals.resize(capacity);
+                break;
+            case TypeVarChar:
+                column.offsets.assign(1, 0);
+                column.offsets.reserve(capacity + 1);
+                column.bytes.clear();
+                break;
+        }
+    }
+}
+
+void RecordBatch::append(const RID &rid, const RecordView &view)
+{
+    rids[numOfRecords] = rid;
+    for (unsigned columnNum = 0; columnNum < columns.size(); columnNum++) {
+        Column &column = columns[columnNum];
+        bool isNull = view.isNull(columnNum);
+        if (isNull) {
+            column.nulls[numOfRecords / 8] |= 0x80 >> (numOfRecords % 8);
+        }
+        switch (column.type) {
+            case TypeInt:
+                column.ints[numOfRecords] = isNull ? 0 : view.getInt(columnNum);
+                break;
+            case TypeReal:
+                column.reals[numOfRecords] = isNull ? 0 : view.getReal(columnNum);
+                break;
+            case TypeVarChar: {
+                if (!isNull) {
+                    unsigned length;
+                    const char *value = view.getVarChar(columnNum, length);
+                    column.bytes.insert(column.bytes.end(), value, value + length);
+                }
+                column.offsets.push_back(column.bytes.size());
+                break;
+            }
+        }
+    }
+    numOfRecords++;
+}
+
+RBFM_ParallelScanIterator::~RBFM_ParallelScanIterator()
+{
+    close();
+}
+
+RC RBFM_ParallelScanIterator::getNextBatch(RecordBatch &batch)
+{
+    unique_lock<mutex> lock(morselMutex);
+    while (numOfConsumedMorsels < numOfMorsels) {
+        auto morsel = isOrdered ? doneMorsels.find(nextOrderedMorselNum) : doneMorsels.begin();
+        if (morsel == doneMorsels.end()) {
+            doneCondition.wait(lock);
+            continue;
+        }
+
+        // the batches of a morsel are stored last first
+        vector<RecordBatch> &batches = morsel->second;
+        if (!batches.empty()) {
+            swap(batch, batches.back());
+            freeBatches.push_back(move(batches.back()));
+            batches.pop_back();
+            return SUCCESS;
+        }
+
+        doneMorsels.erase(morsel);
+        ++numOfConsumedMorsels;
+        nextOrderedMorselNum += isOrdered ? 1 : 0;
+        consumedCondition.notify_all();
+    }
+    batch.numOfRecords = 0;
+    return RBFM_EOF;
+}
+
+ScanStats RBFM_ParallelScanIterator::getStats() const
+{
+    ScanStats stats;
+    for (const auto &iterator : iterators) {
+        stats.numOfPagesRead += iterator->getStats().numOfPagesRead;
+        stats.numOfPagesSkipped += iterator->getStats().numOfPagesSkipped;
+    }
+    return stats;
+}
+
+RC RBFM_ParallelScanIterator::close()
+{
+    {
+        lock_guard<mutex> lock(morselMutex);
+        isClosed = true;
+    }
+    consumedCondition.notify_all();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    for (auto &iterator : iterators) {
+        iterator->close();
+    }
+    iterators.clear();
+
+    doneMorsels.clear();
+    freeBatches.clear();
+    numOfPages = 0;
+    numOfMorsels = 0;
+    nextMorselNum = 0;
+    numOfConsumedMorsels = 0;
+    nextOrderedMorselNum = 0;
+    isClosed = false;
+    return SUCCESS;
+}
+
+void RBFM_ParallelScanIterator::start(unsigned numOfWorkers)
+{
+    numOfMorsels = (numOfPages + PARALLEL_SCAN_MORSEL_PAGES - 1) / PARALLEL_SCAN_MORSEL_PAGES;
+    maxNumOfMorselsAhead = numOfWorkers * PARALLEL_SCAN_MORSELS_AHEAD;
+    for (unsigned i = 0; i < numOfWorkers; ++i) {
+        workers.emplace_back(&RBFM_ParallelScanIterator::runWorker, this, iterators[i].get());
+    }
+}
+
+void RBFM_ParallelScanIterator::runWorker(RBFM_ScanIterator *iterator)
+{
+    unique_lock<mutex> lock(morselMutex);
+    while (true) {
+        // take the next morsel, unless the reader is too far behind
+        while (!isClosed && nextMorselNum < numOfMorsels
+               && nextMorselNum >= numOfConsumedMorsels + maxNumOfMorselsAhead) {
+            consumedCondition.wait(lock);
+        }
+        if (isClosed || nextMorselNum == numOfMorsels) {
+            return;
+        }
+        unsigned morselNum = nextMorselNum++;
+
+        vector<RecordBatch> batches;
+        RecordBatch batch;
+        lock.unlock();
+        PageNum firstPageNum = morselNum * PARALLEL_SCAN_MORSEL_PAGES;
+        iterator->setPageRange(firstPageNum, min(numOfPages, firstPageNum + PARALLEL_SCAN_MORSEL_PAGES));
+        while (iterator->getNextBatch(batch) != RBFM_EOF) {
+            batches.push_back(move(batch));
+            lock.lock();
+            if (freeBatches.empty()) {
+                batch = RecordBatch();
+            } else {
+                batch = move(freeBatches.back());
+                freeBatches.pop_back();
+            }
+            lock.unlock();
+        }
+        reverse(batches.begin(), batches.end());
+
+        lock.lock();
+        freeBatches.push_back(move(batch));
+        doneMorsels[morselNum] = move(batches);
+        doneCondition.notify_all();
+    }
+}
+
+bool RBFM_ScanIterator::satisfiesCondition(unsigned recordOffset)
+{
+    if (conditionGroups.empty()) {
+        return true;
+    }
+    if (--numOfTestsBeforeReorder == 0) {
+        reorderPredicates();
+    }
+
+    for (PredicateGroup &group : conditionGroups) {
+        ++group.numOfTests;
+        bool isGroupMatched = false;
+        for (BoundPredicate &predicate : group.predicates) {
+            ++predicate.numOfTests;
+            if (matchesPredicate(predicate, recordOffset)) {
+                ++predicate.numOfMatches;
+                isGroupMatched = true;
+                break;
+            }
+        }
+        if (!isGroupMatched) {
+            return false;
+        }
+        ++group.numOfMatches;
+    }
+    return true;
+}
+
+bool RBFM_ScanIterator::matchesPredicate(const BoundPredicate &predicate, unsigned recordOffset) const
+{
+    unsigned attrNum = predicate.attrNum;
+    bool isFieldNull = page[recordOffset + attrNum / 8] & (0x80 >> (attrNum % 8));
+    if (predicate.type != COMPARE_PRED) {
+        return isFieldNull == (predicate.type == IS_NULL_PRED);
+    }
+
+    // a NULL field or value only satisfies != (unless both are NULL), as in compareAttribute()
+    if (isFieldNull || predicate.isValueNull) {
+        return !(isFieldNull && predicate.isValueNull) && predicate.compOp == NE_OP;
+    }
+
+    auto numOfFields = recordDescriptor.size();
+    unsigned beginOffset = rbfm->getFieldBeginOffset(page, recordOffset, attrNum, numOfFields);
+    unsigned fieldLength = rbfm->getFieldEndOffset(page, recordOffset, attrNum, numOfFields) - beginOffset;
+    const byte *field = page + recordOffset + beginOffset;
+    switch (predicate.attrType) {
+        case TypeInt: {
+            int32_t i;
+            memcpy(&i, field, sizeof(i));
+            return compare(predicate.compOp, i, predicate.intValue);
+        }
+        case TypeReal: {
+            float r;
+            memcpy(&r, field, sizeof(r));
+            return compare(predicate.compOp, r, predicate.realValue);
+        }
+        case TypeVarChar: {
+            const string &value = predicate.varCharValue;
+            return compare(predicate.compOp, compareVarChar(field, fieldLength, value.data(), value.size()), 0);
+        }
+    }
+    return false;
+}
+
+void RBFM_ScanIterator::reorderPredicates()
+{
+    numOfTestsBeforeReorder = PREDICATE_REORDER_INTERVAL;
+
+    // compare the rates a / b and c / d, counting an untested group or predicate as always matching
+    auto isLowerRate = [](uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
+        return (b == 0 || d == 0) ? (b != 0 && d == 0 && a < b) : a * d < c * b;
+    };
+    for (PredicateGroup &group : conditionGroups) {
+        stable_sort(group.predicates.begin(), group.predicates.end(),
+                    [&](const BoundPredicate &p1, const BoundPredicate &p2) {
+                        return isLowerRate(p2.numOfMatches, p2.numOfTests, p1.numOfMatches, p1.numOfTests);
+                    });
+        for (BoundPredicate &predicate : group.predicates) {
+            predicate.numOfTests /= 2;
+            predicate.numOfMatches /= 2;
+        }
+    }
+    stable_sort(conditionGroups.begin(), conditionGroups.end(),
+                [&](const PredicateGroup &g1, const PredicateGroup &g2) {
+                    return isLowerRate(g1.numOfMatches, g1.numOfTests, g2.numOfMatches, g2.numOfTests);
+                });
+    for (PredicateGroup &group : conditionGroups) {
+        group.numOfTests /= 2;
+        group.numOfMatches /= 2;
+    }
+}
+
 int compare(RID o1, RID o2)
 {
     if (o1.pageNum < o2.pageNum) return -1;
@@ -835,9 +2230,16 @@ bool compareAttribute(AttrType type, CompOp compOp, const void *op1, const void
         case TypeVarChar: {
             uint32_t len1 = *((const uint32_t*) op1);
             uint32_t len2 = *((const uint32_t*) op2);
-            string vc1((const char*) op1 + 4, len1);
-            string vc2((const char*) op2 + 4, len2);
-            return compare(compOp, vc1, vc2);
+            return compare(compOp, compareVarChar((const byte*) op1 + 4, len1, (const byte*) op2 + 4, len2), 0);
         }
     }
 }
+
+int compareVarChar(const void *op1, unsigned length1, const void *op2, unsigned length2)
+{
+    int result = memcmp(op1, op2, min(length1, length2));
+    if (result != 0) {
+        return result;
+    }
+    return (length1 < length2) ? -1 : (length1 > length2) ? 1 : 0;
+}
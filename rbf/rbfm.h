@@ -4,25 +4,68 @@
 #include <cassert>
 #include <climits>
 #include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include "../rbf/pfm.h"
 using namespace std;
 
 typedef unsigned SlotNum;
 
+// Offsets, lengths and free space stored in a page. A moved record has its offset stored as (offset + PAGE_SIZE),
+// which fits in 16 bits up to 32 KB pages.
+typedef conditional<(PAGE_SIZE <= 32768), uint16_t, uint32_t>::type PageOffset;
+
 // size of page space that stores page or record metadata
-const unsigned FIELD_OFFSET_SZ = 2;      // size of space storing the offset of a field in a record
-const unsigned FREE_SPACE_SZ = 2;        // size of space storing the number of free bytes in a page
+const unsigned FIELD_OFFSET_SZ = sizeof(PageOffset);     // size of space storing the offset of a field in a record
+const unsigned FREE_SPACE_SZ = sizeof(PageOffset);       // size of space storing the number of free bytes in a page
 const unsigned NUM_OF_SLOTS_SZ = sizeof(SlotNum);      // size of space storing the number of slots in a page
-const unsigned SLOT_OFFSET_SZ = 2;       // size of space storing the offset of a record in a page
-const unsigned SLOT_LENGTH_SZ = 2;       // size of space storing the length of a record in a page
+const unsigned FRAGMENTED_BYTES_SZ = sizeof(PageOffset); // size of space storing the fragmented bytes of a page
+const unsigned FREE_SLOT_HEAD_SZ = sizeof(PageOffset);   // size of space storing the first free slot of a page
+const unsigned SLOT_OFFSET_SZ = sizeof(PageOffset);      // size of space storing the offset of a record in a page
+const unsigned SLOT_LENGTH_SZ = sizeof(PageOffset);      // size of space storing the length of a record in a page
 const unsigned PAGE_NUM_SZ = sizeof(PageNum);
 const unsigned SLOT_NUM_SZ = NUM_OF_SLOTS_SZ;
 const unsigned RID_SZ = PAGE_NUM_SZ + SLOT_NUM_SZ;
 
+// A record page ends with the slot directory, the number of slots, the first free slot, the fragmented bytes and the
+// free bytes. The free bytes include the fragmented ones, which are only made contiguous when an insert or an update
+// needs the room. The free slots are chained through their offsets; the chain stores slot numbers plus one, so that
+// 0 ends it.
+const unsigned PAGE_TRAILER_SZ = NUM_OF_SLOTS_SZ + FREE_SLOT_HEAD_SZ + FRAGMENTED_BYTES_SZ + FREE_SPACE_SZ;
+
 const unsigned MAX_NUM_OF_ENTRIES = (PAGE_SIZE - PAGE_NUM_SZ) / (PAGE_NUM_SZ + FREE_SPACE_SZ);  // max number of entries in a directory page
 
+// Directory header pages are every (MAX_NUM_OF_ENTRIES + 1) pages, each one followed by the record pages it describes
+inline bool isHeaderPage(PageNum pageNum)
+{
+    return pageNum % (MAX_NUM_OF_ENTRIES + 1) == 0;
+}
+
+inline PageNum getHeaderPageNum(PageNum pageNum)
+{
+    return pageNum - pageNum % (MAX_NUM_OF_ENTRIES + 1);
+}
+const unsigned SCAN_PREFETCH_DEPTH = 32; // number of data pages a scan keeps in flight
+const unsigned SCAN_MADVISE_WINDOW = 64; // number of pages a scan of a mapped file asks the kernel to read ahead
+const unsigned RECORD_BATCH_CAPACITY = 1024;   // records returned by a batch of a scan unless told otherwise
+const unsigned PREDICATE_REORDER_INTERVAL = 1024; // records tested by a scan between reorderings of its predicates
+const unsigned PARALLEL_SCAN_MORSEL_PAGES = 64;  // pages a worker of a parallel scan takes at a time
+const unsigned PARALLEL_SCAN_MORSELS_AHEAD = 2;  // morsels each worker of a parallel scan may be ahead of the reader
+const unsigned DIRECTORY_FLUSH_INTERVAL = 1024;     // changes of free space buffered before the directory is written
+
+// The last word of the hidden header page of a record-based file has a flag set while directory entries are buffered,
+// so that a file which was not closed has its directory rebuilt from the record pages, and one while its zones have
+// changed since they were saved (see ZoneMap), so that its saved zones are dropped
+const int DIRECTORY_STATE_OFFSET = PAGE_SIZE - sizeof(uint32_t);
+const uint32_t DIRECTORY_ENTRIES_BUFFERED = 0x1;
+const uint32_t DIRECTORY_ZONES_CHANGED = 0x2;
+
 // Calculate actual bytes for nulls-indicator for the given field counts
 inline
 unsigned getBytesOfNullIndicator(unsigned numOfFields) {
@@ -83,8 +126,33 @@ bool compare(CompOp compOp, T op1, T op2)
     }
 }
 
+typedef enum
+{
+    COMPARE_PRED = 0,   // attribute compOp value
+    IS_NULL_PRED,       // attribute IS NULL
+    NOT_NULL_PRED       // attribute IS NOT NULL
+} PredicateType;
+
+// A predicate of a scan. A comparison has the semantics of the condition of scan(): its value has the format of a
+// field of insertRecord() and is NULL if value is nullptr.
+struct Predicate
+{
+    PredicateType type;
+    string attributeName;
+    CompOp compOp;
+    const void *value;
+};
+
+// The condition of a scan is a conjunction of groups of predicates, each group satisfied if any of its predicates is
+// (e.g., {{a < 1}, {b IS NULL, c = 2}} is a < 1 AND (b IS NULL OR c = 2)). An empty condition is always satisfied.
+typedef vector<vector<Predicate>> ScanCondition;
+
 bool compareAttribute(AttrType type, CompOp compOp, const void *op1, const void *op2);
 
+// Compare two varchar values byte by byte, the shorter one first if one is a prefix of the other; return a negative
+// value, 0 or a positive value like memcmp()
+int compareVarChar(const void *op1, unsigned length1, const void *op2, unsigned length2);
+
 /********************************************************************************
 The scan iterator is NOT required to be implemented for the part 1 of the project 
 ********************************************************************************/
@@ -101,10 +169,102 @@ The scan iterator is NOT required to be implemented for the part 1 of the projec
 //  rbfmScanIterator.close();
 
 class RecordBasedFileManager;
+class RBFM_ScanIterator;
+class ZoneMap;
+
+// A record returned by a scan, read where it lies in the page of the scan instead of being copied out. The fields are
+// the projected attributes of the scan, in their order; each accessor is O(1). A view is valid until the next call
+// to getNextRecord() or close() of its iterator.
+class RecordView
+{
+    friend class RBFM_ScanIterator;
+public:
+    unsigned getNumOfFields() const;
+
+    bool isNull(unsigned fieldNum) const;
+
+    // The field must not be NULL
+    int32_t getInt(unsigned fieldNum) const;
+
+    float getReal(unsigned fieldNum) const;
+
+    // Return the characters of the varchar in the page, which are not terminated, and set length
+    const char* getVarChar(unsigned fieldNum, unsigned &length) const;
+
+    // Copy the fields to data in the format of RecordBasedFileManager::insertRecord()
+    void materialize(void *data) const;
+
+private:
+    const RBFM_ScanIterator *iterator = nullptr;
+    unsigned recordOffset = 0;
+
+    // Return the bytes of a field in the page and set length
+    const byte* getField(unsigned fieldNum, unsigned &length) const;
+};
+
+// Records returned by a scan, stored by column so that they can be processed in tight loops. The columns are the
+// projected attributes of the scan, in their order: ints and reals are arrays, varchars are packed in one buffer
+// with the begin offset of each value, and each column has a bitmap of NULL values (the value of a NULL int or real
+// is 0). The storage is kept from batch to batch.
+class RecordBatch
+{
+    friend class RBFM_ScanIterator;
+    friend class RBFM_ParallelScanIterator;
+public:
+    RecordBatch(unsigned capacity = RECORD_BATCH_CAPACITY);
+
+    unsigned getCapacity() const { return capacity; }
+
+    unsigned getNumOfRecords() const { return numOfRecords; }
+
+    unsigned getNumOfColumns() const { return columns.size(); }
+
+    const RID* getRids() const { return rids.data(); }
+
+    bool isNull(unsigned columnNum, unsigned recordNum) const;
+
+    // The values of an int or real column, one per record
+    const int32_t* getInts(unsigned columnNum) const { return columns[columnNum].ints.data(); }
+
+    const float* getReals(unsigned columnNum) const { return columns[columnNum].reals.data(); }
+
+    // Return the characters of a varchar, which are not terminated, and set length
+    const char* getVarChar(unsigned columnNum, unsigned recordNum, unsigned &length) const;
+
+private:
+    struct Column {
+        AttrType type;
+        vector<int32_t> ints;
+        vector<float> reals;
+        vector<uint32_t> offsets;   // begin of each varchar in bytes, followed by the end of the last one
+        vector<char> bytes;
+        vector<uint8_t> nulls;      // bit (0x80 >> recordNum % 8) of byte recordNum / 8 is set if the value is NULL
+    };
+
+    unsigned capacity;
+    unsigned numOfRecords = 0;
+    vector<RID> rids;
+    vector<Column> columns;
+
+    // Empty the batch and set its columns to the attributes
+    void reset(const vector<Attribute> &recordDescriptor, const vector<unsigned> &attrNums);
+
+    void append(const RID &rid, const RecordView &view);
+};
+
+// Counts of pages of a scan: those read, and those skipped because their zone map shows that no record satisfies the
+// condition (see ZoneMap)
+struct ScanStats {
+    uint64_t numOfPagesRead = 0;
+    uint64_t numOfPagesSkipped = 0;
+};
 
 class RBFM_ScanIterator
 {
     friend class RecordBasedFileManager;
+    friend class RecordView;
+    friend class RBFM_ParallelScanIterator;
+    friend class ZoneMap;
 public:
     RBFM_ScanIterator();
     ~RBFM_ScanIterator();
@@ -114,6 +274,15 @@ public:
     // "data" follows the same format as RecordBasedFileManager::insertRecord().
     RC getNextRecord(RID &rid, void *data);
 
+    // Set view to the next satisfying record without copying it
+    RC getNextRecord(RID &rid, RecordView &view);
+
+    // Fill batch with the next satisfying records, up to its capacity; return RBFM_EOF if there is none
+    RC getNextBatch(RecordBatch &batch);
+
+    // Pages read and skipped since the scan started (kept by close())
+    const ScanStats& getStats() const { return stats; }
+
     RC close();
 
 private:
@@ -121,44 +290,289 @@ private:
 
     vector<Attribute> recordDescriptor;
     vector<unsigned> attrNums;
-    unsigned conditionAttrNum;
-    CompOp compOp;
-    // TODO: should dynamically allocate space for this pointer and store the value
-    const void *value;
+
+    // A predicate bound by scan() to its attribute, so that each record is tested in its page without copying the
+    // field. The counts of tests and matches, halved at each reordering, give the recent selectivity.
+    struct BoundPredicate {
+        PredicateType type;
+        unsigned attrNum;
+        AttrType attrType;
+        CompOp compOp;
+        bool isValueNull;
+        int32_t intValue;
+        float realValue;
+        string varCharValue;
+        uint64_t numOfTests;
+        uint64_t numOfMatches;
+    };
+
+    struct PredicateGroup {
+        vector<BoundPredicate> predicates;
+        uint64_t numOfTests;
+        uint64_t numOfMatches;
+    };
+
+    // Every PREDICATE_REORDER_INTERVAL records, the groups are sorted so that those which reject the most records
+    // come first, and the predicates of each group so that those which match the most records come first
+    vector<PredicateGroup> conditionGroups;
+    unsigned numOfTestsBeforeReorder = PREDICATE_REORDER_INTERVAL;
+
+    // The zone map of the file if the scan has a condition. Whether a page is skipped is decided once, when it is
+    // first looked at by the prefetch or the scan, so that both skip the same pages.
+    enum PageState : uint8_t { PAGE_UNKNOWN, PAGE_READ, PAGE_SKIPPED };
+    shared_ptr<ZoneMap> zoneMap;
+    vector<PageState> pageStates;
+    ScanStats stats;
 
     FileHandle fileHandle;   // the FileHandle object should be dynamically allocated
-    byte page[PAGE_SIZE];
+    const byte *page = nullptr; // the current page, which is one of the prefetch buffers or in the mapping of the file
     bool containData = false;   // whether the page array contains page data of the current pageNum
     PageNum numOfPages = 0;
     PageNum pageNum = 0;
     unsigned numOfSlots = 0;
     SlotNum slotNum = 0;
 
-    bool isHeaderPage(PageNum pageNum)
-    {
-        return pageNum % (MAX_NUM_OF_ENTRIES + 1) == 0;
-    }
 
 
 
-    void readRecord(unsigned recordOffset, void *data);
+    // The data pages after the current one are read asynchronously into a ring of buffers (unless the file is mapped).
+    // The current page is in slot prefetchHead, followed by numOfPrefetched - 1 next pages. Consecutive data pages in
+    // consecutive slots are read by one request, which is stored in the slot of its first page.
+    byte *prefetchBuffer = nullptr;
+    AsyncPageIO prefetchRequests[SCAN_PREFETCH_DEPTH];
+    uint64_t prefetchVersions[SCAN_PREFETCH_DEPTH];     // write version of the file when each request was submitted
+    unsigned requestSlots[SCAN_PREFETCH_DEPTH];         // slot of the request which reads the page in each slot
+    unsigned prefetchHead = 0;
+    unsigned numOfPrefetched = 0;
+    PageNum nextPrefetchNum = 0;
+
+    // Whether the record at recordOffset in the current page satisfies the condition
+    bool satisfiesCondition(unsigned recordOffset);
+
+    bool matchesPredicate(const BoundPredicate &predicate, unsigned recordOffset) const;
+
+    void reorderPredicates();
+
+    // Whether the data page is skipped by the zone map
+    bool isPageSkipped(PageNum pageNum);
+
+    // Restart the scan at the page firstPageNum, and stop it before the page endPageNum
+    void setPageRange(PageNum firstPageNum, PageNum endPageNum);
+
+    // Point page to the data page pageNum and keep the following data pages in flight
+    void loadPage();
+
+    // The scan has finished the current page
+    void releasePage();
+
+    void prefetchPages();
+
+    // Wait for the requests in flight and empty the ring
+    void cancelPrefetch();
+};
+
+
+// A scan of a file by worker threads. The pages of the file are split into morsels of PARALLEL_SCAN_MORSEL_PAGES
+// pages, which the workers take in turn and scan with the condition and projection of the scan, each one with its own
+// RBFM_ScanIterator. The records come in batches: in the order of the file if the scan is ordered, otherwise in the
+// order the workers fill them. The workers take no more than PARALLEL_SCAN_MORSELS_AHEAD morsels each beyond the
+// one being read, so that the batches waiting are bounded.
+class RBFM_ParallelScanIterator
+{
+    friend class RecordBasedFileManager;
+public:
+    RBFM_ParallelScanIterator() {}
+    ~RBFM_ParallelScanIterator();
+
+    // Swap batch with the next batch of records; return RBFM_EOF at the end of the scan
+    RC getNextBatch(RecordBatch &batch);
+
+    // Pages read and skipped by the workers; complete once getNextBatch() has returned RBFM_EOF
+    ScanStats getStats() const;
+
+    // Stop the workers and close the scan
+    RC close();
+
+private:
+    vector<unique_ptr<RBFM_ScanIterator>> iterators;   // one per worker
+    vector<thread> workers;
+    bool isOrdered = false;
+    PageNum numOfPages = 0;
+    unsigned numOfMorsels = 0;
+    unsigned maxNumOfMorselsAhead = 0;      // morsels taken beyond the one being read
+
+    mutex morselMutex;
+    condition_variable doneCondition;       // signaled when a morsel is done
+    condition_variable consumedCondition;   // signaled when a morsel is consumed or the scan is closed
+    unsigned nextMorselNum = 0;             // the next morsel to take
+    unsigned numOfConsumedMorsels = 0;
+    unsigned nextOrderedMorselNum = 0;      // the morsel being read by an ordered scan
+    bool isClosed = false;
+    map<unsigned, vector<RecordBatch>> doneMorsels;   // batches of the morsels done but not consumed yet
+    vector<RecordBatch> freeBatches;                  // batches to be reused
+
+    void start(unsigned numOfWorkers);
+
+    void runWorker(RBFM_ScanIterator *iterator);
 };
 
 
+// Free bytes of the record pages of a file, shared by all its handles, so that a page with room for a record is found
+// without walking the directory. It is a tree of maxima over the pages (each node holds the largest free space below
+// it), which gives the first page with enough room in O(log n), the page the walk would find. The map is built from the
+// directory on first use, and rebuilt if the file has a number of pages it does not know of (e.g., the pages were
+// written without the RBFM).
+// Changes of free space are applied to the map at once but buffered for the directory, which is written by flush():
+// on closeFile() and after DIRECTORY_FLUSH_INTERVAL changes. While changes are buffered, the file is marked in its
+// hidden header page (DIRECTORY_STATE_OFFSET); a file found marked was not closed, and its free space is read from
+// the record pages themselves and written back to the directory.
+class FreeSpaceMap
+{
+public:
+    FreeSpaceMap() {}
+
+    FreeSpaceMap(const FreeSpaceMap&) = delete;
+    FreeSpaceMap& operator=(const FreeSpaceMap&) = delete;
+
+    // Build the map unless it already reflects the file
+    RC prepare(FileHandle &fileHandle);
+
+    // Set pageNum to the first record page from firstPageNum on with at least size free bytes; return false if there
+    // is none
+    bool findPage(unsigned size, PageNum &pageNum, PageNum firstPageNum = 0);
+
+    // Set the free bytes of a record page, which may be the next page to be appended. The entry of a new page is
+    // written at once, so every page is listed; the other changes are buffered
+    RC update(FileHandle &fileHandle, PageNum pageNum, unsigned freeBytes);
+
+    // A directory header page has been appended
+    void addHeaderPage(PageNum pageNum);
+
+    // Write the buffered changes to the directory
+    RC flush(FileHandle &fileHandle);
+
+    // The file has been cut after its first numOfPages pages
+    void truncate(PageNum numOfPages);
+
+private:
+    mutex mapMutex;
+    bool isBuilt = false;
+    PageNum numOfPages = 0;         // number of pages of the file known to the map
+    size_t numOfLeaves = 0;         // a power of two; leaf i (node numOfLeaves + i) is page i
+    vector<PageOffset> maxFreeBytes;    // node i has children 2i and 2i + 1
+    set<PageNum> changedPageNums;   // record pages whose directory entry is out of date
+    unsigned numOfChanges = 0;      // changes buffered since the last flush
+
+    void setFreeBytes(PageNum pageNum, unsigned freeBytes);
+    unsigned getFreeBytes(PageNum pageNum) const;
+
+    // Find the first page from firstPageNum on with size free bytes in the subtree of the node, which covers
+    // nodeNumOfPages pages from nodeFirstPageNum
+    bool findLeaf(size_t node, size_t nodeFirstPageNum, size_t nodeNumOfPages, unsigned size, PageNum firstPageNum,
+                  PageNum &pageNum) const;
+
+    // Read the free space of every record page (the directory may be out of date)
+    RC readRecordPages(FileHandle &fileHandle, PageNum numOfFilePages);
+
+    RC writeEntry(FileHandle &fileHandle, PageNum pageNum, unsigned freeBytes);
+    RC flushChanges(FileHandle &fileHandle);
+};
+
+// Summaries (zones) of some attributes in each record page of a file, shared by all its handles: the smallest and
+// largest non-NULL values of the records in the page, and their number of NULLs. A scan skips the pages whose zones
+// show that no record can satisfy its condition.
+// Inserts and updates widen the zones; deletes only lower the NULL counts and leave the bounds as they are, so that a
+// zone may be wider than the records of its page but never narrower. A page emptied by deletes gets an empty zone. The
+// directory pages are full of free-space entries, so the zones are kept in "<file name>.zmap": they are built by
+// reading the record pages when an attribute is added, hold for the changes made through the RBFM, and are saved with
+// the directory (flushFreeSpace()). The file is marked in its hidden header page (DIRECTORY_STATE_OFFSET) before the
+// first change after a save; the saved zones of a file found marked were not closed with it, and are dropped.
+class ZoneMap
+{
+public:
+    ZoneMap() {}
+
+    ZoneMap(const ZoneMap&) = delete;
+    ZoneMap& operator=(const ZoneMap&) = delete;
+
+    static string getMapFileName(const string &fileName) { return fileName + ".zmap"; }
+
+    // Read the zones saved for the file; FAIL if there are none or they are out of date (they are then removed)
+    RC load(FileHandle &fileHandle);
+
+    // Write the zones if they have changed since they were loaded or saved, and clear the mark of the file once they
+    // are on disk
+    RC save(FileHandle &fileHandle);
+
+    // The zones are about to change with the records of the file: mark it unless it is marked already
+    RC markChanged(FileHandle &fileHandle);
+
+    // Keep the zones of the attribute attrNum of the records, from the record pages of the file
+    RC addAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned attrNum);
+
+    // A record of numOfFields fields has been written at recordOffset in the record page
+    void addRecord(PageNum pageNum, const byte *page, unsigned recordOffset, unsigned numOfFields);
+
+    // The record at recordOffset in the record page is about to be deleted or rewritten
+    void removeRecord(PageNum pageNum, const byte *page, unsigned recordOffset, unsigned numOfFields);
+
+    // The record page has no record left
+    void clearPage(PageNum pageNum);
+
+    // Whether no record of numOfFields fields in the page satisfies the condition of a scan, as far as the zones tell
+    bool canSkipPage(PageNum pageNum, unsigned numOfFields,
+                     const vector<RBFM_ScanIterator::PredicateGroup> &conditionGroups);
+
+private:
+    struct Zone {
+        bool isUnknown = false;     // a record of the page did not have the fields of the attribute
+        bool hasValues = false;
+        unsigned numOfNulls = 0;
+        int32_t minInt = 0;
+        int32_t maxInt = 0;
+        float minReal = 0;
+        float maxReal = 0;
+        string minVarChar;
+        string maxVarChar;
+    };
+
+    struct Column {
+        unsigned attrNum;
+        unsigned numOfFields;
+        AttrType type;
+        vector<Zone> zones;     // by page number
+    };
+
+    mutex zoneMutex;
+    vector<Column> columns;
+    bool isChanged = false;     // the zones differ from the saved ones
+    bool isMarked = false;      // the file is marked as having changed zones
+
+    void addValue(Column &column, Zone &zone, const byte *page, unsigned recordOffset);
+
+    bool mayMatch(const Zone &zone, const RBFM_ScanIterator::BoundPredicate &predicate) const;
+};
+
 class RecordBasedFileManager
 {
     friend class RBFM_ScanIterator;
+    friend class RecordView;
+    friend class ZoneMap;
 public:
     static RecordBasedFileManager* instance();
 
-    RC createFile(const string &fileName);
+    RC createFile(const string &fileName, unsigned createFlags = CREATE_DEFAULT);
   
     RC destroyFile(const string &fileName);
   
-    RC openFile(const string &fileName, FileHandle &fileHandle);
+    RC openFile(const string &fileName, FileHandle &fileHandle, unsigned openFlags = OPEN_DEFAULT);
   
     RC closeFile(FileHandle &fileHandle);
 
+    // Write the free space of the record pages which is buffered for the directory, and the changed zones of the file
+    // (done by closeFile)
+    RC flushFreeSpace(FileHandle &fileHandle);
+
     //  Format of the data passed into the function is the following:
     //  [n byte-null-indicators for y fields] [actual value for the first field] [actual value for the second field] ...
     //  1) For y fields, there is n-byte-null-indicators in the beginning of each record.
@@ -175,6 +589,12 @@ public:
     // For example, refer to the Q8 of Project 1 wiki page.
     RC insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid);
 
+    // Insert the records in order and set rids to their RIDs. The records are packed into each page in memory, and
+    // each page (and its directory entry) is written once when it is full. Nothing is inserted if a record is too
+    // long for a page.
+    RC insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<const void*> &data,
+                     vector<RID> &rids);
+
     RC readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data);
   
     // This method will be mainly used for debugging/testing.
@@ -203,6 +623,37 @@ IMPORTANT, PLEASE READ: All methods below this comment (other than the construct
             const vector<string> &attributeNames, // a list of projected attributes
             RBFM_ScanIterator &rbfm_ScanIterator);
 
+    // Scan with a condition of several predicates (see ScanCondition), which are tested on the records in their pages
+    RC scan(FileHandle &fileHandle,
+            const vector<Attribute> &recordDescriptor,
+            const ScanCondition &condition,
+            const vector<string> &attributeNames,
+            RBFM_ScanIterator &rbfm_ScanIterator);
+
+    // Scan the file with numOfThreads worker threads (one per hardware thread if 0); the records are returned in the
+    // order of the file if isOrdered. The arguments are those of scan().
+    RC parallelScan(FileHandle &fileHandle,
+                    const vector<Attribute> &recordDescriptor,
+                    const string &conditionAttribute,
+                    const CompOp compOp,
+                    const void *value,
+                    const vector<string> &attributeNames,
+                    unsigned numOfThreads,
+                    bool isOrdered,
+                    RBFM_ParallelScanIterator &rbfm_ParallelScanIterator);
+
+    RC parallelScan(FileHandle &fileHandle,
+                    const vector<Attribute> &recordDescriptor,
+                    const ScanCondition &condition,
+                    const vector<string> &attributeNames,
+                    unsigned numOfThreads,
+                    bool isOrdered,
+                    RBFM_ParallelScanIterator &rbfm_ParallelScanIterator);
+
+    // Keep a zone map of the attribute for the file (see ZoneMap), so that the scans with a condition on it skip the
+    // pages which cannot satisfy it. The record pages are read once to build it, while the file is not written.
+    RC createZoneMap(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const string &attributeName);
+
 protected:
     RecordBasedFileManager();
     ~RecordBasedFileManager();
@@ -216,10 +667,47 @@ private:
     // 1) if there is a free page, set pageNum and freeBytes normally
     // 2) if there is no free page, set pageNum to the page number of the next added page (>= current number of pages), and freeBytes to the initial value,
     // Note: when there is no free directory header page, this function will add a new one automatically
-    RC seekFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum);
+    // Only the pages from firstPageNum on are looked at.
+    RC seekFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum, PageNum firstPageNum = 0);
 
     RC updateFreeSpace(FileHandle &fileHandle, byte *page, PageNum pageNum, unsigned freeBytes);
 
+    // Put a record of recordLength bytes into the page, which must have room for it and a new slot, and update
+    // freeBytes; return the slot of the record
+    SlotNum addRecordToPage(byte *page, const vector<Attribute> &recordDescriptor, const void *data,
+                            unsigned recordLength, unsigned &freeBytes);
+
+    // Add the slot of a deleted record to the free slots of the page
+    void releaseSlot(byte *page, SlotNum slotNum);
+
+    // Mark length bytes of the page from offset as free. They stay fragmented unless they end the records.
+    void freeRecordSpace(byte *page, unsigned offset, unsigned length);
+
+    // Move the records (and pointers to moved records) of the page to its beginning, so that all free bytes are
+    // contiguous
+    void compactPage(byte *page);
+
+    mutex freeSpaceMapsMutex;
+    unordered_map<FileId, shared_ptr<FreeSpaceMap>, FileIdHash> freeSpaceMaps;    // files with records inserted so far
+
+    // Return the free-space map of the file, built if needed (nullptr if the directory cannot be read).
+    // findFreeSpaceMap() only returns a map which already exists.
+    shared_ptr<FreeSpaceMap> getFreeSpaceMap(FileHandle &fileHandle);
+    shared_ptr<FreeSpaceMap> findFreeSpaceMap(FileHandle &fileHandle);
+
+    mutex zoneMapsMutex;
+    unordered_map<FileId, shared_ptr<ZoneMap>, FileIdHash> zoneMaps;     // files with a zone map
+
+    // Return the zone map of the file, loaded from its side file on first use, or nullptr if it has none
+    shared_ptr<ZoneMap> findZoneMap(FileHandle &fileHandle);
+
+    // Forget the free-space map and the zone map of a file which is created or destroyed
+    void forgetFileMaps(const string &fileName);
+
+    // Give the empty record pages at the end of the file, and the directory header pages left without entries,
+    // back to the file and truncate it
+    RC releaseTrailingPages(FileHandle &fileHandle);
+
     void writeRecord(byte *page, unsigned recordOffset, const vector<Attribute> &recordDescriptor, const void *data);
 
     void readRecord(const byte *page, unsigned recordOffset, const vector<Attribute> &recordDescriptor, void *data);
@@ -230,6 +718,20 @@ private:
 
     unsigned getFreeBytes(const byte *page);
 
+    void setFreeBytes(byte *page, unsigned freeBytes);
+
+    unsigned getFragmentedBytes(const byte *page);
+
+    void setFragmentedBytes(byte *page, unsigned fragmentedBytes);
+
+    // return the first free slot plus one, or 0 if there is none
+    unsigned getFreeSlotHead(const byte *page);
+
+    void setFreeSlotHead(byte *page, unsigned freeSlotHead);
+
+    // return the offset of the contiguous free space, which follows the records
+    unsigned getFreeSpaceOffset(const byte *page);
+
     unsigned getNumOfSlots(const byte *page);
 
     void setNumOfSlots(byte *page, unsigned numOfSlots);
@@ -252,27 +754,66 @@ private:
 inline
 unsigned RecordBasedFileManager::getFreeBytes(const byte *page)
 {
-    return *((uint16_t*) (page + PAGE_SIZE - FREE_SPACE_SZ));
+    return *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ));
+}
+
+inline
+void RecordBasedFileManager::setFreeBytes(byte *page, unsigned freeBytes)
+{
+    *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ)) = freeBytes;
+}
+
+inline
+unsigned RecordBasedFileManager::getFragmentedBytes(const byte *page)
+{
+    return *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ - FRAGMENTED_BYTES_SZ));
+}
+
+inline
+void RecordBasedFileManager::setFragmentedBytes(byte *page, unsigned fragmentedBytes)
+{
+    *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ - FRAGMENTED_BYTES_SZ)) = fragmentedBytes;
+}
+
+inline
+unsigned RecordBasedFileManager::getFreeSlotHead(const byte *page)
+{
+    return *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ - FRAGMENTED_BYTES_SZ - FREE_SLOT_HEAD_SZ));
+}
+
+inline
+void RecordBasedFileManager::setFreeSlotHead(byte *page, unsigned freeSlotHead)
+{
+    *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ - FRAGMENTED_BYTES_SZ - FREE_SLOT_HEAD_SZ)) = freeSlotHead;
+}
+
+inline
+unsigned RecordBasedFileManager::getFreeSpaceOffset(const byte *page)
+{
+    return PAGE_SIZE
+           - PAGE_TRAILER_SZ
+           - getNumOfSlots(page)*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
+           - (getFreeBytes(page) - getFragmentedBytes(page));
 }
 
 inline
 SlotNum RecordBasedFileManager::getNumOfSlots(const byte *page)
 {
-    return *((SlotNum*) (page + PAGE_SIZE - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ));
+    return *((SlotNum*) (page + PAGE_SIZE - PAGE_TRAILER_SZ));
 }
 
 inline
 void RecordBasedFileManager::setNumOfSlots(byte *page, SlotNum numOfSlots)
 {
-    *((SlotNum*) (page + PAGE_SIZE - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ)) = numOfSlots;
+    *((SlotNum*) (page + PAGE_SIZE - PAGE_TRAILER_SZ)) = numOfSlots;
 }
 
 inline
 unsigned RecordBasedFileManager::getRecordOffset(const byte *page, SlotNum slotNum)
 {
-    return *((uint16_t*) (page
+    return *((PageOffset*) (page
                           + PAGE_SIZE
-                          - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
+                          - PAGE_TRAILER_SZ
                           - slotNum*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
                           - SLOT_LENGTH_SZ - SLOT_OFFSET_SZ));
 }
@@ -280,10 +821,9 @@ unsigned RecordBasedFileManager::getRecordOffset(const byte *page, SlotNum slotN
 inline
 void RecordBasedFileManager::setRecordOffset(byte *page, SlotNum slotNum, unsigned recordOffset)
 {
-    *((uint16_t*) (page
+    *((PageOffset*) (page
                    + PAGE_SIZE
-                   - FREE_SPACE_SZ
-                   - NUM_OF_SLOTS_SZ
+                   - PAGE_TRAILER_SZ
                    - slotNum*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
                    - SLOT_LENGTH_SZ - SLOT_OFFSET_SZ)) = recordOffset;
 }
@@ -291,9 +831,9 @@ void RecordBasedFileManager::setRecordOffset(byte *page, SlotNum slotNum, unsign
 inline
 unsigned RecordBasedFileManager::getRecordLength(const byte *page, SlotNum slotNum)
 {
-    return *((uint16_t*) (page
+    return *((PageOffset*) (page
                           + PAGE_SIZE
-                          - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
+                          - PAGE_TRAILER_SZ
                           - slotNum*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
                           - SLOT_LENGTH_SZ));
 }
@@ -301,9 +841,9 @@ unsigned RecordBasedFileManager::getRecordLength(const byte *page, SlotNum slotN
 inline
 void RecordBasedFileManager::setRecordLength(byte *page, SlotNum slotNum, unsigned recordLength)
 {
-    *((uint16_t*) (page
+    *((PageOffset*) (page
                    + PAGE_SIZE
-                   - FREE_SPACE_SZ - NUM_OF_SLOTS_SZ
+                   - PAGE_TRAILER_SZ
                    - slotNum*(SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)
                    - SLOT_LENGTH_SZ)) = recordLength;
 }
@@ -318,7 +858,7 @@ unsigned RecordBasedFileManager::getFieldBeginOffset(const byte *page, unsigned
     if (fieldNum == 0) {
         return preOffset + numOfFields * FIELD_OFFSET_SZ;
     }
-    unsigned beginOffset = *((uint16_t*) (page + recordOffset + preOffset + (fieldNum-1)*FIELD_OFFSET_SZ));
+    unsigned beginOffset = *((PageOffset*) (page + recordOffset + preOffset + (fieldNum-1)*FIELD_OFFSET_SZ));
     return preOffset + numOfFields * FIELD_OFFSET_SZ + beginOffset;
 }
 
@@ -329,8 +869,70 @@ unsigned RecordBasedFileManager::getFieldEndOffset(const byte *page, unsigned re
     assert(fieldNum < numOfFields);
 
     unsigned preOffset = getBytesOfNullIndicator(numOfFields);
-    unsigned endOffset = *((uint16_t*) (page + recordOffset + preOffset + fieldNum*FIELD_OFFSET_SZ));
+    unsigned endOffset = *((PageOffset*) (page + recordOffset + preOffset + fieldNum*FIELD_OFFSET_SZ));
     return preOffset + numOfFields * FIELD_OFFSET_SZ + endOffset;
 }
 
+inline
+unsigned RecordView::getNumOfFields() const
+{
+    return iterator->attrNums.size();
+}
+
+inline
+bool RecordView::isNull(unsigned fieldNum) const
+{
+    unsigned attrNum = iterator->attrNums[fieldNum];
+    return iterator->page[recordOffset + attrNum / 8] & (0x80 >> (attrNum % 8));
+}
+
+inline
+const byte* RecordView::getField(unsigned fieldNum, unsigned &length) const
+{
+    unsigned attrNum = iterator->attrNums[fieldNum];
+    unsigned numOfFields = iterator->recordDescriptor.size();
+    RecordBasedFileManager *rbfm = iterator->rbfm;
+    unsigned beginOffset = rbfm->getFieldBeginOffset(iterator->page, recordOffset, attrNum, numOfFields);
+    length = rbfm->getFieldEndOffset(iterator->page, recordOffset, attrNum, numOfFields) - beginOffset;
+    return iterator->page + recordOffset + beginOffset;
+}
+
+inline
+int32_t RecordView::getInt(unsigned fieldNum) const
+{
+    unsigned length;
+    int32_t i;
+    memcpy(&i, getField(fieldNum, length), sizeof(i));
+    return i;
+}
+
+inline
+float RecordView::getReal(unsigned fieldNum) const
+{
+    unsigned length;
+    float r;
+    memcpy(&r, getField(fieldNum, length), sizeof(r));
+    return r;
+}
+
+inline
+const char* RecordView::getVarChar(unsigned fieldNum, unsigned &length) const
+{
+    return (const char*) getField(fieldNum, length);
+}
+
+inline
+bool RecordBatch::isNull(unsigned columnNum, unsigned recordNum) const
+{
+    return columns[columnNum].nulls[recordNum / 8] & (0x80 >> (recordNum % 8));
+}
+
+inline
+const char* RecordBatch::getVarChar(unsigned columnNum, unsigned recordNum, unsigned &length) const
+{
+    const Column &column = columns[columnNum];
+    length = column.offsets[recordNum + 1] - column.offsets[recordNum];
+    return column.bytes.data() + column.offsets[recordNum];
+}
+
 #endif
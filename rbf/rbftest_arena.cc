@@ -0,0 +1,116 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned NUM_OF_THREADS = 4;
+const unsigned NUM_OF_ROUNDS = 2000;
+
+// Allocate and release buffers of various sizes, checking that no other thread writes into them
+void runArenaWorker(unsigned threadNo, bool *isCorrupted)
+{
+    PageArena &arena = PageArena::instance();
+    for (unsigned round = 0; round < NUM_OF_ROUNDS; round++)
+    {
+        size_t size = (size_t) (1 + (round + threadNo) % 5) * PAGE_SIZE;
+        byte *buffer = arena.allocate(size);
+        memset(buffer, threadNo + 1, size);
+        for (size_t i = 0; i < size; i += PAGE_SIZE / 4)
+        {
+            if ((unsigned char) buffer[i] != threadNo + 1) {
+                *isCorrupted = true;
+            }
+        }
+        arena.release(buffer, size);
+    }
+}
+
+int RBFTest_Arena()
+{
+    // Functions Tested:
+    // 1. Allocate / Release of page buffers, aligned for direct I/O
+    // 2. Released buffers are reused from the free list of their size class
+    // 3. Buffers larger than a chunk
+    // 4. Allocations from several threads
+    cout << endl << "***** In RBF Test Case Arena *****" << endl;
+
+    PageArena &arena = PageArena::instance();
+    uint64_t mappedBytes, hugeTLBBytes, allocationCount, reuseCount;
+
+    byte *page = arena.allocate(PAGE_SIZE);
+    assert((uintptr_t) page % DIRECT_IO_ALIGNMENT == 0 && "A page buffer should be aligned.");
+    memset(page, 'a', PAGE_SIZE);
+    byte *pages = arena.allocate(3 * PAGE_SIZE);
+    assert((uintptr_t) pages % DIRECT_IO_ALIGNMENT == 0 && "A buffer of pages should be aligned.");
+    assert((pages + 3 * PAGE_SIZE <= page || page + PAGE_SIZE <= pages) && "The buffers should not overlap.");
+    memset(pages, 'b', 3 * PAGE_SIZE);
+    assert(page[PAGE_SIZE - 1] == 'a' && "Writing a buffer should not touch the others.");
+
+    arena.collectCounterValues(mappedBytes, hugeTLBBytes, allocationCount, reuseCount);
+    assert(mappedBytes >= ARENA_CHUNK_SIZE && hugeTLBBytes <= mappedBytes && "The arena should map whole chunks.");
+    cout << "Mapped " << mappedBytes << " bytes, " << hugeTLBBytes << " of them in reserved huge pages." << endl;
+
+    // The buffer of 3 pages is in the size class of 4 pages
+    uint64_t lastReuseCount = reuseCount;
+    arena.release(pages, 3 * PAGE_SIZE);
+    byte *reusedPages = arena.allocate(4 * PAGE_SIZE);
+    arena.collectCounterValues(mappedBytes, hugeTLBBytes, allocationCount, reuseCount);
+    assert(reusedPages == pages && reuseCount == lastReuseCount + 1 && "A released buffer should be reused.");
+    arena.release(reusedPages, 4 * PAGE_SIZE);
+    arena.release(page, PAGE_SIZE);
+
+    // A buffer larger than a chunk is mapped on its own, and unmapped when it is released
+    uint64_t lastMappedBytes = mappedBytes;
+    size_t largeSize = 2 * ARENA_CHUNK_SIZE + PAGE_SIZE;
+    byte *largeBuffer = arena.allocate(largeSize);
+    assert((uintptr_t) largeBuffer % DIRECT_IO_ALIGNMENT == 0 && "A large buffer should be aligned.");
+    memset(largeBuffer, 'c', largeSize);
+    arena.collectCounterValues(mappedBytes, hugeTLBBytes, allocationCount, reuseCount);
+    assert(mappedBytes >= lastMappedBytes + largeSize && "The large buffer should be mapped.");
+    arena.release(largeBuffer, largeSize);
+    arena.collectCounterValues(mappedBytes, hugeTLBBytes, allocationCount, reuseCount);
+    assert(mappedBytes == lastMappedBytes && "The large buffer should be unmapped.");
+
+    {
+        PageBuffer buffer;
+        memset(buffer.get(), 'd', PAGE_SIZE);
+    }
+
+    bool isCorrupted = false;
+    vector<thread> threads;
+    for (unsigned i = 0; i < NUM_OF_THREADS; i++)
+    {
+        threads.push_back(thread(runArenaWorker, i, &isCorrupted));
+    }
+    for (thread &worker : threads)
+    {
+        worker.join();
+    }
+    assert(!isCorrupted && "A buffer should belong to one thread at a time.");
+
+    arena.collectCounterValues(mappedBytes, hugeTLBBytes, allocationCount, reuseCount);
+    assert(reuseCount > NUM_OF_THREADS * NUM_OF_ROUNDS / 2 && "Most buffers should come from the free lists.");
+    cout << allocationCount << " allocations, " << reuseCount << " from the free lists." << endl;
+
+    cout << "RBF Test Case Arena Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the page arena
+    RC rcmain = RBFTest_Arena();
+    return rcmain;
+}
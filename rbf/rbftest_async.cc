@@ -0,0 +1,149 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h> 
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h> 
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int testAsyncIO(PagedFileManager *pfm, unsigned engineType, unsigned openFlags)
+{
+    RC rc;
+    string fileName = "test_async";
+    const unsigned numOfPages = 200;      // more than the queue depth of the engines
+
+    assert(pfm->getAsyncIOEngineType() == engineType && "The engine type should be correct.");
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, openFlags);
+    assert(rc == success && "Opening the file should not fail.");
+
+    byte *buffers = allocateAlignedBuffer(numOfPages * PAGE_SIZE);
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        memset(buffers + i * PAGE_SIZE, 0, PAGE_SIZE);
+        rc = fileHandle.appendPage(buffers + i * PAGE_SIZE);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    rc = fileHandle.flushPages();
+    assert(rc == success && "Flushing the pages should not fail.");
+
+    // Write all pages asynchronously
+    AsyncPageIO *requests = new AsyncPageIO[numOfPages];
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        memset(buffers + i * PAGE_SIZE, 'A' + i % 26, PAGE_SIZE);
+        requests[i].pageNum = i;
+        requests[i].data = buffers + i * PAGE_SIZE;
+        requests[i].isWrite = true;
+    }
+    rc = fileHandle.submitPages(requests, numOfPages);
+    assert(rc == success && "Submitting page writes should not fail.");
+    rc = fileHandle.waitPages(requests, numOfPages);
+    assert(rc == success && "Page writes should not fail.");
+    rc = fileHandle.pollPages(requests, numOfPages);
+    assert(rc == (RC) numOfPages && "All writes should be done.");
+
+    // Read them back in reverse order, and poll until all requests are done
+    memset(buffers, 0, numOfPages * PAGE_SIZE);
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        requests[i].pageNum = numOfPages - 1 - i;
+        requests[i].data = buffers + i * PAGE_SIZE;
+        requests[i].isWrite = false;
+    }
+    rc = fileHandle.submitPages(requests, numOfPages);
+    assert(rc == success && "Submitting page reads should not fail.");
+    while (fileHandle.pollPages(requests, numOfPages) < numOfPages)
+    {
+    }
+    rc = fileHandle.waitPages(requests, numOfPages);
+    assert(rc == success && "Page reads should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        byte expected = 'A' + (numOfPages - 1 - i) % 26;
+        assert(buffers[i * PAGE_SIZE] == expected && buffers[(i + 1) * PAGE_SIZE - 1] == expected
+               && "Pages read asynchronously should be correct.");
+    }
+
+    // Synchronous reads should see the asynchronous writes
+    byte page[PAGE_SIZE];
+    rc = fileHandle.readPage(numOfPages - 1, page);
+    assert(rc == success && page[0] == 'A' + (numOfPages - 1) % 26 && "Reading a page should see the async write.");
+
+    // A request for a page beyond the end of the file should fail
+    requests[0].pageNum = numOfPages;
+    requests[0].data = buffers;
+    requests[0].isWrite = false;
+    rc = fileHandle.submitPages(requests, 1);
+    assert(rc != success && "Reading a page that does not exist should fail.");
+    assert(requests[0].isDone && requests[0].result != success && "The failed request should be done.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    delete[] requests;
+    free(buffers);
+    return 0;
+}
+
+int RBFTest_Async(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Select the async I/O engine
+    // 2. Submit / Poll / Wait page reads and writes
+    // 3. Async I/O on a direct I/O file
+    cout << endl << "***** In RBF Test Case Async I/O *****" << endl;
+
+    // Use a small buffer pool, so that most requests go to the file
+    RC rc = pfm->setBufferPoolSize(8);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->setAsyncIOEngine(ASYNC_IO_THREAD_POOL);
+    assert(rc == success && "The thread pool engine should always be available.");
+    assert(pfm->getAsyncIOEngineType() == ASYNC_IO_THREAD_POOL && "The engine type should be correct.");
+    testAsyncIO(pfm, ASYNC_IO_THREAD_POOL, OPEN_DEFAULT);
+    testAsyncIO(pfm, ASYNC_IO_THREAD_POOL, OPEN_DIRECT_IO);
+
+    // io_uring may not be supported by the kernel
+    if (pfm->setAsyncIOEngine(ASYNC_IO_URING) == success)
+    {
+        testAsyncIO(pfm, ASYNC_IO_URING, OPEN_DEFAULT);
+        testAsyncIO(pfm, ASYNC_IO_URING, OPEN_DIRECT_IO);
+    }
+    else
+    {
+        cout << "io_uring is not available, skipped." << endl;
+    }
+
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    cout << "RBF Test Case Async I/O Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the asynchronous page I/O of the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+    
+    remove("test_async");
+
+    RC rcmain = RBFTest_Async(pfm);
+    return rcmain;
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Records of 20 to 220 bytes
+unsigned getPayloadLength(unsigned recordNum)
+{
+    return 20 + (recordNum * 13) % 200;
+}
+
+int RBFTest_Batch(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Records writes each page once, and appends the new pages in order
+    // 2. The records are read back with the returned RIDs
+    // 3. A batch with a record too long for a page inserts nothing
+    // 4. The room made by Delete Record is used by the next batch
+    cout << endl << "***** In RBF Test Case Batch *****" << endl;
+
+    RC rc;
+    string fileName = "test_batch";
+    const unsigned numOfRecords = 5000;
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor);
+    byte returnedRecord[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<byte> records((size_t) numOfRecords * PAGE_SIZE);
+    vector<const void*> data(numOfRecords);
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        preparePayloadRecord(i, getPayloadLength(i), &records[(size_t) i * PAGE_SIZE]);
+        data[i] = &records[(size_t) i * PAGE_SIZE];
+    }
+
+    uint64_t readPageCount, writePageCount, appendPageCount;
+    uint64_t lastReadPageCount, lastWritePageCount, lastAppendPageCount;
+    rc = fileHandle.collectCounterValues(lastReadPageCount, lastWritePageCount, lastAppendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, rids);
+    assert(rc == success && rids.size() == numOfRecords && "Inserting the records should not fail.");
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+
+    // Each record page is appended once and its directory entry is written once (the directory is read once more
+    // when the free space of the file is first looked up)
+    uint64_t numOfNewPages = appendPageCount - lastAppendPageCount;
+    cout << "Inserting " << numOfRecords << " records: " << readPageCount - lastReadPageCount << " reads, "
+         << writePageCount - lastWritePageCount << " writes, " << numOfNewPages << " appends" << endl;
+    assert(numOfNewPages == fileHandle.getNumberOfPages() - 1 && "Every page should be appended.");
+    assert(writePageCount - lastWritePageCount <= numOfNewPages
+           && readPageCount - lastReadPageCount <= numOfNewPages + 1 && "No page should be written more than once.");
+    for (unsigned i = 1; i < numOfRecords; i++)
+    {
+        assert(rids[i].pageNum >= rids[i - 1].pageNum && "The pages should be filled in order.");
+    }
+
+    // A batch which cannot be inserted leaves the file as it is
+    vector<byte> longRecord(2 * PAGE_SIZE);
+    preparePayloadRecord(0, PAGE_SIZE, longRecord.data());
+    vector<const void*> badData(data.begin(), data.begin() + 10);
+    badData.push_back(longRecord.data());
+    PageNum numOfPages = fileHandle.getNumberOfPages();
+    vector<RID> badRids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, badData, badRids);
+    assert(rc != success && fileHandle.getNumberOfPages() == numOfPages && "A record too long should fail the batch.");
+
+    // Make room in early pages; the next batch goes there first
+    const unsigned firstDeletedRecord = 100, numOfDeletedRecords = 20;
+    for (unsigned i = firstDeletedRecord; i < firstDeletedRecord + numOfDeletedRecords; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    vector<byte> largeRecords(2 * PAGE_SIZE);
+    vector<const void*> largeData;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        preparePayloadRecord(i, 1000, &largeRecords[(size_t) i * PAGE_SIZE]);
+        largeData.push_back(&largeRecords[(size_t) i * PAGE_SIZE]);
+    }
+    vector<RID> largeRids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, largeData, largeRids);
+    assert(rc == success && largeRids[0].pageNum >= rids[firstDeletedRecord].pageNum
+           && largeRids[0].pageNum <= rids[firstDeletedRecord + numOfDeletedRecords - 1].pageNum
+           && "The free room should be used.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        if (i >= firstDeletedRecord && i < firstDeletedRecord + numOfDeletedRecords) {
+            continue;
+        }
+        unsigned length = preparePayloadRecord(i, getPayloadLength(i), &records[0]);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedRecord);
+        assert(rc == success && memcmp(&records[0], returnedRecord, length) == 0 && "The records should be intact.");
+    }
+    for (unsigned i = 0; i < largeRids.size(); i++)
+    {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, largeRids[i], returnedRecord);
+        assert(rc == success && memcmp(largeData[i], returnedRecord, 1 + sizeof(uint32_t) + 1000) == 0
+               && "The records should be intact.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Batch Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the batch insert
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_batch");
+
+    RC rcmain = RBFTest_Batch(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h> 
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h> 
+#include <thread>
+#include <vector>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Buffer(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Set Buffer Pool Size
+    // 2. Append / Read / Write Page through the buffer pool
+    // 3. Collect Buffer Counter Values
+    // 4. Sharing cached pages between two FileHandles of the same file
+    // 5. Concurrent misses and evictions from several threads
+    // 6. Flush Pages / Close File
+    cout << endl << "***** In RBF Test Case Buffer *****" << endl;
+
+    RC rc;
+    string fileName = "test_buffer";
+    const unsigned numOfFrames = 4;
+    const unsigned numOfPages = 8;
+
+    rc = pfm->setBufferPoolSize(numOfFrames);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Append more pages than the buffer pool can hold
+    byte data[PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        memset(data, 'a' + i, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    unsigned hitCount = 0, missCount = 0, evictionCount = 0;
+    unsigned hitCount1 = 0, missCount1 = 0, evictionCount1 = 0;
+    rc = fileHandle.collectBufferCounterValues(hitCount, missCount, evictionCount);
+    assert(rc == success && "Collecting buffer counter values should not fail.");
+    assert(evictionCount > 0 && "Pages should have been evicted from a full buffer pool.");
+
+    // Reading the last appended page again should be a hit
+    rc = fileHandle.readPage(numOfPages - 1, buffer);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(buffer[0] == 'a' + (byte) (numOfPages - 1) && "The page should have the appended content.");
+    rc = fileHandle.collectBufferCounterValues(hitCount1, missCount1, evictionCount1);
+    assert(rc == success && "Collecting buffer counter values should not fail.");
+    assert(hitCount1 == hitCount + 1 && missCount1 == missCount && "Reading a cached page should be a hit.");
+
+    // Evicted pages should have been written back and come back on a miss
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = fileHandle.readPage(i, buffer);
+        assert(rc == success && "Reading a page should not fail.");
+        assert(buffer[0] == 'a' + (byte) i && buffer[PAGE_SIZE - 1] == 'a' + (byte) i && "The page content should be correct.");
+    }
+    rc = fileHandle.collectBufferCounterValues(hitCount, missCount, evictionCount);
+    assert(rc == success && "Collecting buffer counter values should not fail.");
+    assert(missCount > missCount1 && "Reading evicted pages should miss.");
+
+    // A second handle on the same file sees the absorbed write through the shared pool
+    memset(data, 'z', PAGE_SIZE);
+    rc = fileHandle.writePage(0, data);
+    assert(rc == success && "Writing a page should not fail.");
+    rc = fileHandle.flushPages();
+    assert(rc == success && "Flushing the pages should not fail.");
+
+    FileHandle fileHandle2;
+    rc = pfm->openFile(fileName, fileHandle2);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = fileHandle2.readPage(0, buffer);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The second handle should see the written page.");
+    rc = pfm->closeFile(fileHandle2);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Threads reading and writing their own pages through a pool smaller than the file miss and evict concurrently
+    const unsigned numOfThreads = 4;
+    vector<unsigned> numOfErrors(numOfThreads, 0);
+    vector<thread> threads;
+    for (unsigned t = 0; t < numOfThreads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            FileHandle threadHandle;
+            if (pfm->openFile(fileName, threadHandle) != success)
+            {
+                ++numOfErrors[t];
+                return;
+            }
+            byte page[PAGE_SIZE];
+            byte readBuffer[PAGE_SIZE];
+            for (unsigned round = 0; round < 200; round++)
+            {
+                PageNum pageNum = 1 + t + (round % 2) * numOfThreads;
+                if (pageNum >= numOfPages)
+                {
+                    pageNum = 1 + t;
+                }
+                memset(page, 'A' + (byte) ((t + round) % 26), PAGE_SIZE);
+                if (threadHandle.writePage(pageNum, page) != success
+                    || threadHandle.readPage(pageNum, readBuffer) != success
+                    || memcmp(page, readBuffer, PAGE_SIZE) != 0)
+                {
+                    ++numOfErrors[t];
+                }
+                // read a page of another thread to force misses on pages in transit
+                if (threadHandle.readPage(1 + (t + round) % (numOfPages - 1), readBuffer) != success)
+                {
+                    ++numOfErrors[t];
+                }
+            }
+            pfm->closeFile(threadHandle);
+        });
+    }
+    for (thread &worker : threads)
+    {
+        worker.join();
+    }
+    for (unsigned t = 0; t < numOfThreads; t++)
+    {
+        assert(numOfErrors[t] == 0 && "Concurrent reads and writes through the buffer pool should be correct.");
+    }
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // After closing, the dirty pages should be on disk
+    FILE *file = fopen(fileName.c_str(), "rb");
+    assert(file != NULL && "The file should exist.");
+    fseek(file, PAGE_SIZE, SEEK_SET);
+    size_t bytesRead = fread(buffer, 1, PAGE_SIZE, file);
+    fclose(file);
+    assert(bytesRead == PAGE_SIZE && memcmp(data, buffer, PAGE_SIZE) == 0 && "The written page should be persisted.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    cout << "RBF Test Case Buffer Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the buffer pool of the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+    
+    remove("test_buffer");
+
+    RC rcmain = RBFTest_Buffer(pfm);
+    return rcmain;
+}
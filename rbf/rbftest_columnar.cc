@@ -0,0 +1,119 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+string getEmployeeName(unsigned recordNum)
+{
+    return string(recordNum % 20, 'a' + recordNum % 26);
+}
+
+int RBFTest_Columnar(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Get Next Batch returns the records of the scan, in order and with their RIDs, in full batches but the last
+    // 2. The columns are the projected attributes, NULLs included
+    // 3. The condition of the scan applies to the batches
+    cout << endl << "***** In RBF Test Case Columnar *****" << endl;
+
+    RC rc;
+    string fileName = "test_columnar";
+    const unsigned numOfRecords = 3000;
+    const unsigned capacity = 128;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<RID> rids(numOfRecords);
+    int recordSize = 0;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        // the name is NULL for one record out of seven and the height for one out of five
+        string name = getEmployeeName(i);
+        unsigned char nullsIndicator = ((i % 7 == 0) ? 0x80 : 0) | ((i % 5 == 0) ? 0x20 : 0);
+        prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, 150 + i % 50, 1000 * i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // Project the fields out of order, and select the employees older than 9
+    vector<string> attributeNames = {"Height", "EmpName", "Salary"};
+    int32_t age = 9;
+    RBFM_ScanIterator scanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GT_OP, &age, attributeNames, scanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RecordBatch batch(capacity);
+    unsigned numOfScannedRecords = 0;
+    RID lastRid;
+    while (scanIterator.getNextBatch(batch) != RBFM_EOF)
+    {
+        assert(batch.getNumOfColumns() == attributeNames.size() && "A batch should have the projected columns.");
+        assert(batch.getNumOfRecords() > 0 && batch.getNumOfRecords() <= capacity && "A batch should not overflow.");
+        const float *heights = batch.getReals(0);
+        const int32_t *salaries = batch.getInts(2);
+        for (unsigned j = 0; j < batch.getNumOfRecords(); j++)
+        {
+            unsigned recordNum = salaries[j] / 1000;
+            assert(!batch.isNull(2, j) && recordNum % 100 > 9 && "The condition should hold.");
+            const RID &rid = batch.getRids()[j];
+            assert((numOfScannedRecords == 0 || rid.pageNum > lastRid.pageNum
+                    || (rid.pageNum == lastRid.pageNum && rid.slotNum > lastRid.slotNum))
+                   && "The records should be in the order of the file.");
+            assert(rid.pageNum == rids[recordNum].pageNum && rid.slotNum == rids[recordNum].slotNum
+                   && "The RID should be returned.");
+            assert(batch.isNull(0, j) == (recordNum % 5 == 0) && "The NULL field should be NULL.");
+            assert((batch.isNull(0, j) || heights[j] == 150 + recordNum % 50) && "The real field should be read.");
+            unsigned nameLength;
+            const char *name = batch.getVarChar(1, j, nameLength);
+            assert(batch.isNull(1, j) == (recordNum % 7 == 0) && "The NULL field should be NULL.");
+            assert((batch.isNull(1, j) || getEmployeeName(recordNum) == string(name, nameLength))
+                   && "The varchar field should be read.");
+            lastRid = rid;
+            numOfScannedRecords++;
+        }
+        assert((batch.getNumOfRecords() == capacity || numOfScannedRecords == numOfRecords * 9 / 10)
+               && "Only the last batch should be partly filled.");
+    }
+    assert(numOfScannedRecords == numOfRecords * 9 / 10 && "Every satisfying record should be returned.");
+    rc = scanIterator.getNextBatch(batch);
+    assert(rc == RBFM_EOF && batch.getNumOfRecords() == 0
+           && "The scan should stay at its end.");
+    scanIterator.close();
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Columnar Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the batches of a scan
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_columnar");
+
+    RC rcmain = RBFTest_Columnar(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned PAYLOAD_LENGTH = 100;
+
+// Check the record of the given RID against the one built from seed and length
+void checkRecord(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                 const RID &rid, unsigned seed, unsigned length = PAYLOAD_LENGTH)
+{
+    byte record[PAGE_SIZE];
+    byte returnedRecord[PAGE_SIZE];
+    unsigned recordSize = preparePayloadRecord(seed, length, record);
+    RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedRecord);
+    assert(rc == success && memcmp(record, returnedRecord, recordSize) == 0 && "The record should be intact.");
+}
+
+int RBFTest_Compaction(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Delete Record and a shrinking Update Record leave the other records where they are
+    // 2. Insert Record compacts a fragmented page when the free space after the records is too short
+    // 3. A growing Update Record is done in the page, compacting it if needed
+    // 4. A page whose records are all deleted is emptied
+    cout << endl << "***** In RBF Test Case Compaction *****" << endl;
+
+    RC rc;
+    string fileName = "test_compaction";
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+    byte page[PAGE_SIZE];
+    byte lastPage[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Fill the first record page
+    vector<RID> rids;
+    RID rid;
+    for (unsigned i = 0; ; i++)
+    {
+        preparePayloadRecord(i, PAYLOAD_LENGTH, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        if (rid.pageNum != 1) {
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+            assert(rc == success && "Deleting a record should not fail.");
+            break;
+        }
+        rids.push_back(rid);
+    }
+    unsigned numOfRecords = rids.size();
+    cout << numOfRecords << " records fit in a page." << endl;
+
+    // Shrinking a record, then deleting every other record, does not move the records
+    preparePayloadRecord(1, PAYLOAD_LENGTH / 2, record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[1]);
+    assert(rc == success && "Updating a record should not fail.");
+    rc = fileHandle.readPage(1, lastPage);
+    assert(rc == success && "Reading a page should not fail.");
+    for (unsigned i = 0; i < numOfRecords; i += 2)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    rc = fileHandle.readPage(1, page);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(memcmp(page, lastPage, PAGE_SIZE / 2) == 0 && "The records should not be moved by a delete.");
+    checkRecord(rbfm, fileHandle, recordDescriptor, rids[1], 1, PAYLOAD_LENGTH / 2);
+    checkRecord(rbfm, fileHandle, recordDescriptor, rids[3], 3);
+
+    // The freed bytes are used by records too long for any single hole
+    vector<RID> longRids;
+    unsigned longLength = 3 * PAYLOAD_LENGTH;
+    for (unsigned i = 0; i < numOfRecords / 8; i++)
+    {
+        preparePayloadRecord(100 + i, longLength, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && rid.pageNum == 1 && "The page should be compacted for the insert.");
+        longRids.push_back(rid);
+    }
+
+    // A record grows in the page once the page is compacted
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[3]);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[7]);
+    assert(rc == success && "Deleting a record should not fail.");
+    unsigned grownLength = PAYLOAD_LENGTH + PAYLOAD_LENGTH / 2;
+    preparePayloadRecord(5, grownLength, record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[5]);
+    assert(rc == success && "Updating a record should not fail.");
+    rc = fileHandle.readPage(1, page);
+    assert(rc == success && "Reading a page should not fail.");
+    unsigned slotOffset = *((PageOffset*) (page + PAGE_SIZE - PAGE_TRAILER_SZ
+                                           - (rids[5].slotNum + 1) * (SLOT_OFFSET_SZ + SLOT_LENGTH_SZ)));
+    assert(slotOffset < PAGE_SIZE && "The record should stay in its page.");
+
+    // Every record is read back
+    checkRecord(rbfm, fileHandle, recordDescriptor, rids[1], 1, PAYLOAD_LENGTH / 2);
+    checkRecord(rbfm, fileHandle, recordDescriptor, rids[5], 5, grownLength);
+    for (unsigned i = 9; i < numOfRecords; i += 2)
+    {
+        checkRecord(rbfm, fileHandle, recordDescriptor, rids[i], i);
+    }
+    for (unsigned i = 0; i < longRids.size(); i++)
+    {
+        checkRecord(rbfm, fileHandle, recordDescriptor, longRids[i], 100 + i, longLength);
+    }
+
+    // Deleting the rest empties the page
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[1]);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[5]);
+    assert(rc == success && "Deleting a record should not fail.");
+    for (unsigned i = 9; i < numOfRecords; i += 2)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    for (unsigned i = 0; i < longRids.size(); i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, longRids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    rc = fileHandle.readPage(1, page);
+    SlotNum numOfSlots = *((SlotNum*) (page + PAGE_SIZE - PAGE_TRAILER_SZ));
+    assert((rc != success || numOfSlots == 0) && "The empty page should have no slots.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Compaction Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the lazy page compaction
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_compaction");
+
+    RC rcmain = RBFTest_Compaction(rbfm);
+    return rcmain;
+}
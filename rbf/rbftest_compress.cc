@@ -0,0 +1,240 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// A page of repetitive text, like the varchar fields of a table
+void prepareTextPage(unsigned seed, byte *data)
+{
+    const char *words[] = {"Irvine", "Los Angeles", "San Diego", "Riverside", "Tom", "Anteater", "Berkeley"};
+    unsigned pos = 0;
+    for (unsigned i = seed; pos < PAGE_SIZE; i++)
+    {
+        string field = string(words[(i * 7) % 7]) + ":" + to_string(i % 100) + ";";
+        for (unsigned j = 0; j < field.size() && pos < PAGE_SIZE; j++)
+        {
+            data[pos++] = field[j];
+        }
+    }
+}
+
+// A page which does not compress
+void prepareRandomPage(unsigned seed, byte *data)
+{
+    srand(seed);
+    for (unsigned i = 0; i < PAGE_SIZE; i++)
+    {
+        data[i] = rand() % 256;
+    }
+}
+
+// Copy a file as a crash would leave it
+int RBFTest_Codec()
+{
+    // Functions Tested:
+    // 1. lzCompress / lzDecompress round trip
+    // 2. Incompressible data and corrupted blocks are detected
+    cout << endl << "***** In RBF Test Case Codec *****" << endl;
+
+    byte data[PAGE_SIZE];
+    byte compressed[2 * PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+
+    prepareTextPage(0, data);
+    size_t length = lzCompress(data, PAGE_SIZE, compressed, sizeof(compressed));
+    assert(length > 0 && length < PAGE_SIZE / 4 && "Repetitive text should compress well.");
+    assert(lzDecompress(compressed, length, buffer, PAGE_SIZE) == success && memcmp(data, buffer, PAGE_SIZE) == 0
+           && "The text should be restored.");
+    cout << "A page of text is compressed into " << length << " bytes." << endl;
+
+    memset(data, 0, PAGE_SIZE);
+    length = lzCompress(data, PAGE_SIZE, compressed, sizeof(compressed));
+    assert(length > 0 && length < 64 && "An empty page should compress to almost nothing.");
+    assert(lzDecompress(compressed, length, buffer, PAGE_SIZE) == success && memcmp(data, buffer, PAGE_SIZE) == 0
+           && "The empty page should be restored.");
+
+    prepareRandomPage(1, data);
+    assert(lzCompress(data, PAGE_SIZE, compressed, PAGE_SIZE - COMPRESSED_SLOT_UNIT) == 0
+           && "Random data should not fit in less than a page.");
+    length = lzCompress(data, PAGE_SIZE, compressed, sizeof(compressed));
+    assert(length > 0 && lzDecompress(compressed, length, buffer, PAGE_SIZE) == success
+           && memcmp(data, buffer, PAGE_SIZE) == 0 && "Random data should be restored.");
+
+    prepareTextPage(2, data);
+    length = lzCompress(data, PAGE_SIZE, compressed, sizeof(compressed));
+    assert(lzDecompress(compressed, length - 1, buffer, PAGE_SIZE) != success && "A cut block should be rejected.");
+    assert(lzDecompress(compressed, length, buffer, PAGE_SIZE - 1) != success
+           && "A block of another size should be rejected.");
+
+    cout << "RBF Test Case Codec Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_Compress(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Create File with CREATE_COMPRESSED (modes which need fixed page offsets are rejected)
+    // 2. Append Page / Read Page / Read Pages / Write Page through the page map
+    // 3. Rewriting a page which no longer fits in its slot moves it
+    // 4. The pages written since the last flush do not overwrite the flushed ones, so a crash loses them cleanly
+    // 5. The page map is persisted and the file is truncated by Shrink
+    cout << endl << "***** In RBF Test Case Compress *****" << endl;
+
+    RC rc;
+    string fileName = "test_compress";
+    string mapFileName = CompressedPageMap::getMapFileName(fileName);
+    string crashFileName = fileName + "_crash";
+    const unsigned numOfPages = 200;
+    byte data[PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+
+    rc = pfm->createFile(fileName, CREATE_COMPRESSED);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, OPEN_MMAP);
+    assert(rc != success && "Mapping a compressed file should fail.");
+    rc = pfm->openFile(fileName, fileHandle, OPEN_WAL);
+    assert(rc != success && "Logging a compressed file should fail.");
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.isCompressed() && "The file should be compressed.");
+
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        prepareTextPage(i, data);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    unsigned compressedSize = getFileSize(fileName);
+    assert(compressedSize < (numOfPages + 1) * PAGE_SIZE / 4 && "The pages should be stored compressed.");
+    cout << numOfPages << " pages of text take " << compressedSize << " bytes." << endl;
+
+    // Drop the cached pages, so that they are read from the file again
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "The number of pages should be persisted.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = fileHandle.readPage(i, buffer);
+        assert(rc == success && "Reading a page should not fail.");
+        prepareTextPage(i, data);
+        assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The page read should be the one appended.");
+    }
+
+    // Every other page becomes incompressible and moves; the others shrink in place
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        if (i % 2 == 0) {
+            prepareRandomPage(i, data);
+        } else {
+            memset(data, i, PAGE_SIZE);
+        }
+        rc = fileHandle.writePage(i, data);
+        assert(rc == success && "Writing a page should not fail.");
+    }
+
+    // The pages are written back but not flushed: a copy of the file and of its map reads the flushed pages
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+    copyFile(fileName, crashFileName);
+    copyFile(mapFileName, CompressedPageMap::getMapFileName(crashFileName));
+    FileHandle crashFileHandle;
+    rc = pfm->openFile(crashFileName, crashFileHandle);
+    assert(rc == success && "Opening the copy should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = crashFileHandle.readPage(i, buffer);
+        prepareTextPage(i, data);
+        assert(rc == success && memcmp(data, buffer, PAGE_SIZE) == 0 && "The copy should hold the flushed pages.");
+    }
+    rc = pfm->closeFile(crashFileHandle);
+    assert(rc == success && "Closing the copy should not fail.");
+    rc = pfm->destroyFile(crashFileName);
+    assert(rc == success && "Destroying the copy should not fail.");
+
+    rc = fileHandle.flushPages();
+    assert(rc == success && "Flushing the pages should not fail.");
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    byte *pages = (byte*) malloc((size_t) numOfPages * PAGE_SIZE);
+    rc = fileHandle.readPages(0, numOfPages, pages);
+    assert(rc == success && "Reading the pages should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        if (i % 2 == 0) {
+            prepareRandomPage(i, data);
+        } else {
+            memset(data, i, PAGE_SIZE);
+        }
+        assert(memcmp(data, pages + (size_t) i * PAGE_SIZE, PAGE_SIZE) == 0
+               && "The page read should be the last one written.");
+    }
+    free(pages);
+
+    // The pages freed at the end of the file are truncated
+    for (unsigned i = numOfPages; i-- > numOfPages / 2;)
+    {
+        rc = fileHandle.freePage(i);
+        assert(rc == success && "Freeing a page should not fail.");
+    }
+    rc = fileHandle.shrink();
+    assert(rc == success && "Shrinking the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages / 2 && "The free pages should be truncated.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    assert(getFileSize(fileName) < (numOfPages / 2 + 1) * PAGE_SIZE && "The file should be truncated.");
+
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = fileHandle.readPage(numOfPages / 2 - 1, buffer);
+    memset(data, numOfPages / 2 - 1, PAGE_SIZE);
+    assert(rc == success && memcmp(data, buffer, PAGE_SIZE) == 0 && "The kept pages should be readable.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    struct stat mapStat;
+    assert(stat(mapFileName.c_str(), &mapStat) != 0 && "The page map should be removed with the file.");
+
+    cout << "RBF Test Case Compress Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the compressed file format
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_compress");
+    remove("test_compress.pmap");
+    remove("test_compress_crash");
+    remove("test_compress_crash.pmap");
+
+    RC rcmain = RBFTest_Codec();
+    if (rcmain == 0) {
+        rcmain = RBFTest_Compress(pfm);
+    }
+    return rcmain;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h> 
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h> 
+#include <thread>
+#include <vector>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Read every page of the file through the given handle and check its content
+void readAllPages(FileHandle fileHandle, unsigned numOfPages, bool &isCorrect)
+{
+    byte buffer[PAGE_SIZE];
+    isCorrect = true;
+    for (unsigned round = 0; round < 4; round++)
+    {
+        for (unsigned i = 0; i < numOfPages; i++)
+        {
+            PageNum pageNum = (i * 7 + round) % numOfPages;
+            if (fileHandle.readPage(pageNum, buffer) != success
+                || buffer[0] != (byte) ('a' + pageNum % 26) || buffer[PAGE_SIZE - 1] != (byte) ('a' + pageNum % 26))
+            {
+                isCorrect = false;
+            }
+        }
+    }
+}
+
+int RBFTest_Direct(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Open File with direct I/O
+    // 2. Append / Read / Write Page on a direct I/O file
+    // 3. Concurrent readers sharing one FileHandle
+    // 4. Close File
+    cout << endl << "***** In RBF Test Case Direct I/O *****" << endl;
+
+    RC rc;
+    string fileName = "test_direct";
+    const unsigned numOfPages = 64;
+    const unsigned numOfThreads = 4;
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, OPEN_DIRECT_IO);
+    assert(rc == success && "Opening the file with direct I/O should not fail.");
+    assert(fileHandle.isDirectIO() && "The file should be opened with direct I/O.");
+
+    // Unaligned buffers should also work with direct I/O
+    byte *data = new byte[PAGE_SIZE + 1] + 1;
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        memset(data, 'a' + i % 26, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Use a small buffer pool, so that most reads go to the file
+    rc = pfm->setBufferPoolSize(8);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->openFile(fileName, fileHandle, OPEN_DIRECT_IO);
+    assert(rc == success && "Opening the file with direct I/O should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "The number of pages should be persisted.");
+
+    vector<thread> threads;
+    bool isCorrect[numOfThreads];
+    for (unsigned i = 0; i < numOfThreads; i++)
+    {
+        threads.emplace_back(readAllPages, fileHandle, numOfPages, ref(isCorrect[i]));
+    }
+    for (unsigned i = 0; i < numOfThreads; i++)
+    {
+        threads[i].join();
+        assert(isCorrect[i] && "Pages read by concurrent readers should be correct.");
+    }
+
+    unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting counter values should not fail.");
+    assert(readPageCount == numOfThreads * numOfPages * 4 && "Read counter should be correct.");
+    assert(appendPageCount == numOfPages && "Append counter should be correct.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    delete[] (data - 1);
+
+    cout << "RBF Test Case Direct I/O Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the direct I/O mode of the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+    
+    remove("test_direct");
+
+    RC rcmain = RBFTest_Direct(pfm);
+    return rcmain;
+}
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Records of 50 to 550 bytes
+unsigned getPayloadLength(unsigned recordNum)
+{
+    return 50 + (recordNum * 37) % 500;
+}
+
+// The free bytes of the record page according to the directory
+unsigned getDirectoryFreeBytes(FileHandle &fileHandle, PageNum pageNum)
+{
+    byte header[PAGE_SIZE];
+    PageNum headerNum = getHeaderPageNum(pageNum);
+    unsigned entryNum = pageNum - headerNum - 1;
+    RC rc = fileHandle.readPage(headerNum, header);
+    assert(rc == success && "Reading a page should not fail.");
+    if (*((PageNum*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ))) != pageNum) {
+        return UINT_MAX;
+    }
+    return *((PageOffset*) (header + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ) + PAGE_NUM_SZ));
+}
+
+// Whether the directory lists every record page with the free bytes stored in the page
+bool isDirectoryUpToDate(FileHandle &fileHandle)
+{
+    byte page[PAGE_SIZE];
+    for (PageNum pageNum = 1; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+    {
+        if (isHeaderPage(pageNum)) {
+            continue;
+        }
+        RC rc = fileHandle.readPage(pageNum, page);
+        assert(rc == success && "Reading a page should not fail.");
+        if (getDirectoryFreeBytes(fileHandle, pageNum) != *((PageOffset*) (page + PAGE_SIZE - FREE_SPACE_SZ))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether the file is marked as having directory entries which were not written
+bool isMarkedOutOfDate(FileHandle &fileHandle)
+{
+    byte header[PAGE_SIZE];
+    RC rc = fileHandle.readHeaderPage(header);
+    assert(rc == success && "Reading the header page should not fail.");
+    return *((uint32_t*) (header + DIRECTORY_STATE_OFFSET)) != 0;
+}
+
+// Insert records, write the pages of the file to disk and exit without closing it, so that the directory entries
+// still buffered are lost
+void insertWithoutClosing(RecordBasedFileManager *rbfm, const string &fileName, unsigned numOfRecords)
+{
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor, (AttrLength) PAGE_SIZE / 2);
+    byte record[PAGE_SIZE];
+    FileHandle fileHandle;
+    RID rid;
+    if (rbfm->createFile(fileName) != success || rbfm->openFile(fileName, fileHandle) != success) {
+        _exit(1);
+    }
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        preparePayloadRecord(i, getPayloadLength(i), record);
+        if (rbfm->insertRecord(fileHandle, recordDescriptor, record, rid) != success) {
+            _exit(1);
+        }
+    }
+    _exit(fileHandle.flushPages() == success ? 0 : 1);
+}
+
+int RBFTest_Directory(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert / Update / Delete Record buffer the directory entries; about one page read and written per record,
+    //    besides the directory entry written for each new page
+    // 2. Flush Free Space and Close File write the directory
+    // 3. A file which was not closed has its directory rebuilt from the record pages
+    cout << endl << "***** In RBF Test Case Directory *****" << endl;
+
+    RC rc;
+    string fileName = "test_directory";
+    const unsigned numOfRecords = 3000;
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor, (AttrLength) PAGE_SIZE / 2);
+    byte record[PAGE_SIZE];
+    byte returnedRecord[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    uint64_t readPageCount, writePageCount, appendPageCount;
+    uint64_t lastReadPageCount, lastWritePageCount, lastAppendPageCount;
+    rc = fileHandle.collectCounterValues(lastReadPageCount, lastWritePageCount, lastAppendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+    vector<RID> rids(numOfRecords);
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        preparePayloadRecord(i, getPayloadLength(i), record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+    cout << "Inserting " << numOfRecords << " records: " << readPageCount - lastReadPageCount << " reads, "
+         << writePageCount - lastWritePageCount << " writes, " << appendPageCount - lastAppendPageCount
+         << " appends" << endl;
+    uint64_t numOfNewPages = appendPageCount - lastAppendPageCount;
+    assert(readPageCount - lastReadPageCount <= numOfRecords + numOfNewPages
+           && writePageCount - lastWritePageCount <= numOfRecords + numOfNewPages
+           && "The directory should not be read and written for each record.");
+    assert(isMarkedOutOfDate(fileHandle) && "The file should be marked while entries are buffered.");
+
+    for (unsigned i = 0; i < numOfRecords; i += 3)
+    {
+        preparePayloadRecord(i + 1, getPayloadLength(i + 1), record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i + 1]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+
+    rc = rbfm->flushFreeSpace(fileHandle);
+    assert(rc == success && "Flushing the free space should not fail.");
+    assert(!isMarkedOutOfDate(fileHandle) && isDirectoryUpToDate(fileHandle) && "The directory should be written.");
+
+    for (unsigned i = 0; i < numOfRecords; i += 3)
+    {
+        preparePayloadRecord(i, getPayloadLength(i), record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i + 1]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(!isMarkedOutOfDate(fileHandle) && isDirectoryUpToDate(fileHandle)
+           && "The directory should be written on close.");
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        unsigned recordNum = (i % 3 == 0) ? i + 1 : (i % 3 == 1) ? i - 1 : i;
+        unsigned length = preparePayloadRecord(recordNum, getPayloadLength(recordNum), record);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedRecord);
+        assert(rc == success && memcmp(record, returnedRecord, length) == 0 && "The records should be intact.");
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // The first process inserts more records than are buffered, so part of the directory is stale when it exits
+    pid_t pid = fork();
+    assert(pid >= 0 && "Forking should not fail.");
+    if (pid == 0) {
+        insertWithoutClosing(rbfm, fileName, numOfRecords);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The first process should exit normally.");
+
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(isMarkedOutOfDate(fileHandle) && !isDirectoryUpToDate(fileHandle)
+           && "The directory should be out of date after the exit.");
+    RID rid;
+    preparePayloadRecord(numOfRecords, getPayloadLength(numOfRecords), record);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    rc = rbfm->flushFreeSpace(fileHandle);
+    assert(rc == success && "Flushing the free space should not fail.");
+    assert(!isMarkedOutOfDate(fileHandle) && isDirectoryUpToDate(fileHandle)
+           && "The directory should be rebuilt from the record pages.");
+
+    // The records of the first process are found by a scan
+    RBFM_ScanIterator scanIterator;
+    vector<string> attributeNames(1, "Payload");
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, scanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    unsigned numOfScannedRecords = 0;
+    while (scanIterator.getNextRecord(rid, returnedRecord) != RBFM_EOF)
+    {
+        numOfScannedRecords++;
+    }
+    scanIterator.close();
+    assert(numOfScannedRecords == numOfRecords + 1 && "Every record should be scanned.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Directory Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the buffered directory updates
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_directory");
+
+    RC rcmain = RBFTest_Directory(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+uint64_t getAllocatedSize(const string &fileName)
+{
+    struct stat fileStat;
+    assert(stat(fileName.c_str(), &fileStat) == 0 && "The file should exist.");
+    return (uint64_t) fileStat.st_blocks * 512;
+}
+
+int RBFTest_Extent(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Append Page reserves disk space by extents
+    // 2. The file size only counts the pages written
+    // 3. Reopen File and append again
+    // 4. Append Page without OPEN_PREALLOCATE, and with OPEN_DIRECT_IO | OPEN_NO_PREALLOCATION
+    cout << endl << "***** In RBF Test Case Extent *****" << endl;
+
+    RC rc;
+    string fileName = "test_extent";
+    const unsigned numOfPages = 1000;
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, OPEN_PREALLOCATE);
+    assert(rc == success && "Opening the file should not fail.");
+
+    byte data[PAGE_SIZE];
+    memset(data, 'e', PAGE_SIZE);
+    rc = fileHandle.appendPage(data);
+    assert(rc == success && "Appending a page should not fail.");
+
+    // The first extent is reserved by the first append, before the page is written back
+    uint64_t allocatedSize = getAllocatedSize(fileName);
+    if (allocatedSize < MIN_EXTENT_SIZE) {
+        cout << "The file system does not support preallocation; only the contents are checked." << endl;
+    }
+
+    for (unsigned i = 1; i < numOfPages; i++)
+    {
+        memset(data, 'a' + i % 26, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    assert(getFileSize(fileName) == (numOfPages + 1) * PAGE_SIZE && "The reserved space should not change the file size.");
+    if (allocatedSize >= MIN_EXTENT_SIZE) {
+        assert(getAllocatedSize(fileName) > (uint64_t) (numOfPages + 1) * PAGE_SIZE
+               && "Space should be reserved ahead of the appended pages.");
+    }
+
+    // Append after reopening the file, and read everything back
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "The number of pages should be persisted.");
+    memset(data, 'Z', PAGE_SIZE);
+    rc = fileHandle.appendPage(data);
+    assert(rc == success && "Appending a page should not fail.");
+
+    byte buffer[PAGE_SIZE];
+    for (unsigned i = 0; i <= numOfPages; i++)
+    {
+        rc = fileHandle.readPage(i, buffer);
+        assert(rc == success && "Reading a page should not fail.");
+        memset(data, (i == numOfPages) ? 'Z' : (i == 0) ? 'e' : 'a' + i % 26, PAGE_SIZE);
+        assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The page read should be the same as the page appended.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // Without preallocation, only the pages written get space
+    const unsigned openFlags[] = {OPEN_DEFAULT, OPEN_DIRECT_IO | OPEN_NO_PREALLOCATION};
+    for (unsigned flags : openFlags)
+    {
+        rc = pfm->createFile(fileName);
+        assert(rc == success && "Creating the file should not fail.");
+        rc = pfm->openFile(fileName, fileHandle, flags);
+        if (rc != success && (flags & OPEN_DIRECT_IO))
+        {
+            cout << "The file system does not support direct I/O; it is not checked." << endl;
+            pfm->destroyFile(fileName);
+            continue;
+        }
+        assert(rc == success && "Opening the file should not fail.");
+        for (unsigned i = 0; i < 10; i++)
+        {
+            rc = fileHandle.appendPage(data);
+            assert(rc == success && "Appending a page should not fail.");
+        }
+        rc = pfm->closeFile(fileHandle);
+        assert(rc == success && "Closing the file should not fail.");
+        assert(getFileSize(fileName) == 11 * PAGE_SIZE && "The file should have a header page and 10 data pages.");
+        assert(getAllocatedSize(fileName) < MIN_EXTENT_SIZE && "No space should be reserved.");
+
+        rc = pfm->destroyFile(fileName);
+        assert(rc == success && "Destroying the file should not fail.");
+    }
+
+    cout << "RBF Test Case Extent Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test extent-based preallocation of appended pages
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_extent");
+
+    RC rcmain = RBFTest_Extent(pfm);
+    return rcmain;
+}
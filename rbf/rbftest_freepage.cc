@@ -0,0 +1,273 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+void preparePage(unsigned seed, byte *data)
+{
+    for (unsigned i = 0; i < PAGE_SIZE; i++)
+    {
+        data[i] = (seed * 13 + i) % 251;
+    }
+}
+
+int RBFTest_FreePage(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Free Page / Allocate Page (freed pages are reused)
+    // 2. Shrink (the free pages at the end of the file are truncated)
+    // 3. The free page list is persisted in the header page
+    // 4. Shrink File on a closed file
+    // 5. A page cannot be freed twice, and a file whose free page list is broken cannot be opened
+    cout << endl << "***** In RBF Test Case FreePage *****" << endl;
+
+    RC rc;
+    string fileName = "test_freepage";
+    const unsigned numOfPages = 10;
+    byte data[PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        preparePage(i, data);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    rc = fileHandle.freePage(3);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = fileHandle.freePage(7);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = fileHandle.freePage(numOfPages);
+    assert(rc != success && "Freeing a page beyond the file should fail.");
+    rc = fileHandle.freePage(3);
+    assert(rc != success && "Freeing a free page again should fail.");
+    assert(fileHandle.getNumberOfFreePages() == 2 && "There should be 2 free pages.");
+
+    // The last freed page is reused first
+    PageNum pageNum;
+    preparePage(100, data);
+    rc = fileHandle.allocatePage(data, pageNum);
+    assert(rc == success && "Allocating a page should not fail.");
+    assert(pageNum == 7 && "The freed page should be reused.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "No page should be appended.");
+    rc = fileHandle.readPage(7, buffer);
+    assert(rc == success && memcmp(data, buffer, PAGE_SIZE) == 0 && "The allocated page should be written.");
+
+    // Only the free pages at the end are truncated
+    rc = fileHandle.freePage(9);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = fileHandle.freePage(8);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = fileHandle.shrink();
+    assert(rc == success && "Shrinking the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == 8 && "The free pages at the end should be truncated.");
+    assert(fileHandle.getNumberOfFreePages() == 1 && "The other free pages should be kept.");
+    assert(getFileSize(fileName) == 9 * PAGE_SIZE && "The file should be truncated.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == 8 && "The number of pages should be persisted.");
+    assert(fileHandle.getNumberOfFreePages() == 1 && "The free pages should be persisted.");
+
+    preparePage(101, data);
+    rc = fileHandle.allocatePage(data, pageNum);
+    assert(rc == success && pageNum == 3 && "The page freed before closing the file should be reused.");
+    rc = fileHandle.allocatePage(data, pageNum);
+    assert(rc == success && pageNum == 8 && "A page should be appended when no page is free.");
+    for (unsigned i = 0; i < 9; i++)
+    {
+        rc = fileHandle.readPage(i, buffer);
+        assert(rc == success && "Reading a page should not fail.");
+        preparePage((i == 3 || i == 8) ? 101 : (i == 7 ? 100 : i), data);
+        assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The page read should be the last one written.");
+    }
+
+    // Shrink a closed file
+    rc = fileHandle.freePage(8);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = fileHandle.freePage(6);
+    assert(rc == success && "Freeing a page should not fail.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->shrinkFile(fileName);
+    assert(rc == success && "Shrinking the file should not fail.");
+    assert(getFileSize(fileName) == 9 * PAGE_SIZE && "The free page at the end should be truncated.");
+
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == 8 && fileHandle.getNumberOfFreePages() == 1
+           && "The free pages should be persisted.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Link the free page to itself in a copy of the file, whose pages are not cached
+    string cycleFileName = fileName + "_cycle";
+    copyFile(fileName, cycleFileName);
+    FILE *file = fopen(cycleFileName.c_str(), "r+b");
+    assert(file != NULL && "The file should exist.");
+    PageNum filePageNum = 7;
+    fseek(file, (long) filePageNum * PAGE_SIZE, SEEK_SET);
+    fwrite(&filePageNum, sizeof(filePageNum), 1, file);
+    fclose(file);
+    rc = pfm->openFile(cycleFileName, fileHandle);
+    assert(rc != success && "Opening a file whose free page list has a cycle should fail.");
+    rc = pfm->destroyFile(cycleFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case FreePage Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_ReleasePages(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Record over two directory header pages
+    // 2. Delete Record (the emptied pages at the end are given back)
+    // 3. Insert / Read Record / Scan after the file has been truncated
+    cout << endl << "***** In RBF Test Case ReleasePages *****" << endl;
+
+    RC rc;
+    string fileName = "test_releasepages";
+    const unsigned numOfRecords = (MAX_NUM_OF_ENTRIES + 100) * 4;    // four records per page
+    const int nameLength = PAGE_SIZE / 4 - 100;
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    void *record = malloc(PAGE_SIZE);
+    void *returnedData = malloc(PAGE_SIZE);
+    int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+    unsigned char *nullsIndicator = (unsigned char *) malloc(nullFieldsIndicatorActualSize);
+    memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+    string name(nameLength, 'r');
+    int recordSize = 0;
+
+    vector<RID> rids;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        RID rid;
+        prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, name, i, 170.5, i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    PageNum numOfPages = fileHandle.getNumberOfPages();
+    assert(numOfPages > MAX_NUM_OF_ENTRIES + 1 && "The records should need a second directory header page.");
+
+    // Deleting the records of the last page releases it
+    for (unsigned i = numOfRecords; i-- > 0 && rids[i].pageNum == numOfPages - 1;)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    assert(fileHandle.getNumberOfPages() == numOfPages - 1 && "The emptied last page should be released.");
+    assert(getFileSize(fileName) == numOfPages * PAGE_SIZE && "The file should be truncated.");
+
+    // Deleting all the records leaves the first directory header page only
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        if (rids[i].pageNum < numOfPages - 1) {
+            rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+            assert(rc == success && "Deleting a record should not fail.");
+        }
+    }
+    assert(fileHandle.getNumberOfPages() == 1 && "All the record pages should be released.");
+    assert(getFileSize(fileName) == 2 * PAGE_SIZE && "The file should be truncated.");
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[numOfRecords - 1], returnedData);
+    assert(rc != success && "Reading a record from a released page should fail.");
+
+    // The file grows again from the first directory header page
+    rids.clear();
+    for (unsigned i = 0; i < 10; i++)
+    {
+        RID rid;
+        prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, name, i, 170.5, i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        rids.push_back(rid);
+    }
+    assert(fileHandle.getNumberOfPages() == 4 && "The records should be inserted into new pages.");
+    for (unsigned i = 0; i < 10; i++)
+    {
+        prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, name, i, 170.5, i, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        assert(rc == success && "Reading a record should not fail.");
+        assert(memcmp(record, returnedData, recordSize) == 0 && "The record read should be the one inserted.");
+    }
+
+    vector<string> attrs;
+    attrs.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attrs, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    unsigned numOfScanned = 0;
+    RID rid;
+    while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        numOfScanned++;
+    }
+    rbfmScanIterator.close();
+    assert(numOfScanned == 10 && "Only the new records should be scanned.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+    free(nullsIndicator);
+
+    cout << "RBF Test Case ReleasePages Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the free page list and the truncation of files
+    PagedFileManager *pfm = PagedFileManager::instance();
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_freepage");
+    remove("test_freepage_cycle");
+    remove("test_releasepages");
+
+    RC rcmain = RBFTest_FreePage(pfm);
+    if (rcmain == 0) {
+        rcmain = RBFTest_ReleasePages(rbfm);
+    }
+    return rcmain;
+}
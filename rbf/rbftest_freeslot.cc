@@ -0,0 +1,126 @@
+#include <iostream>
+#include <string>
+#include <set>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned PAYLOAD_LENGTH = 4;
+
+// The number of slots in the slot directory of a record page
+SlotNum getNumOfSlots(FileHandle &fileHandle, PageNum pageNum)
+{
+    byte page[PAGE_SIZE];
+    RC rc = fileHandle.readPage(pageNum, page);
+    assert(rc == success && "Reading a page should not fail.");
+    return *((SlotNum*) (page + PAGE_SIZE - PAGE_TRAILER_SZ));
+}
+
+int RBFTest_FreeSlot(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Record reuses the slots of deleted records before adding slots
+    // 2. The slot of a record moved away by Update Record is reused once the record is deleted
+    // 3. The free slots are kept when the file is reopened
+    cout << endl << "***** In RBF Test Case Free Slot *****" << endl;
+
+    RC rc;
+    string fileName = "test_freeslot";
+    const unsigned numOfRecords = 200;
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+    byte returnedRecord[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<RID> rids(numOfRecords);
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        preparePayloadRecord(i, PAYLOAD_LENGTH, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && rids[i].pageNum == 1 && "The records should fit in a page.");
+    }
+    SlotNum numOfSlots = getNumOfSlots(fileHandle, 1);
+    assert(numOfSlots == numOfRecords && "Each record should have a slot.");
+
+    // Free every third slot, plus the slot of a record which moves to another page
+    set<SlotNum> freeSlots;
+    for (unsigned i = 0; i < numOfRecords; i += 3)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        freeSlots.insert(rids[i].slotNum);
+    }
+    unsigned movedRecord = 1;
+    preparePayloadRecord(movedRecord, PAGE_SIZE / 2, record);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[movedRecord]);
+    assert(rc == success && "Updating a record should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[movedRecord]);
+    assert(rc == success && "Deleting a record should not fail.");
+    freeSlots.insert(rids[movedRecord].slotNum);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // The inserts take exactly the free slots, then add new ones
+    RID rid;
+    for (unsigned i = 0, numOfFreeSlots = freeSlots.size(); i < numOfFreeSlots; i++)
+    {
+        preparePayloadRecord(i, PAYLOAD_LENGTH, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && rid.pageNum == 1 && "Inserting a record should not fail.");
+        assert(freeSlots.count(rid.slotNum) == 1 && "A free slot should be reused.");
+        freeSlots.erase(rid.slotNum);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedRecord);
+        assert(rc == success && memcmp(record, returnedRecord, preparePayloadRecord(i, PAYLOAD_LENGTH, record)) == 0
+               && "The record should be read back.");
+    }
+    assert(freeSlots.empty() && getNumOfSlots(fileHandle, 1) == numOfSlots && "No slot should be added.");
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.slotNum == numOfSlots && "A slot should be added once none is free.");
+
+    // The other records are untouched
+    for (unsigned i = 4; i < numOfRecords; i += 3)
+    {
+        preparePayloadRecord(i, PAYLOAD_LENGTH, record);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedRecord);
+        assert(rc == success && memcmp(record, returnedRecord, preparePayloadRecord(i, PAYLOAD_LENGTH, record)) == 0
+               && "The record should be intact.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Free Slot Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the reuse of free slots
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_freeslot");
+
+    RC rcmain = RBFTest_FreeSlot(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned PAYLOAD_LENGTH = PAGE_SIZE / 4;
+
+int RBFTest_FreeSpace(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Record fills the pages in order across several directory header pages
+    // 2. Delete Record makes room which is found by the next insert, first page first
+    // 3. Insert Record does not walk the directory
+    // 4. The free space is shared by the handles of a file and forgotten when the file is recreated
+    cout << endl << "***** In RBF Test Case Free Space *****" << endl;
+
+    RC rc;
+    string fileName = "test_freespace";
+    const unsigned numOfRecords = 3 * (MAX_NUM_OF_ENTRIES + 100);
+    vector<Attribute> recordDescriptor;
+    createPayloadDescriptor(recordDescriptor, (AttrLength) PAYLOAD_LENGTH);
+    byte record[PAGE_SIZE];
+    byte returnedRecord[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<RID> rids(numOfRecords);
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        preparePayloadRecord(i, PAYLOAD_LENGTH, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+        assert(!isHeaderPage(rids[i].pageNum) && "A record should not be put in a directory header page.");
+        assert((i == 0 || rids[i].pageNum >= rids[i - 1].pageNum) && "The pages should be filled in order.");
+    }
+    PageNum lastPageNum = rids[numOfRecords - 1].pageNum;
+    assert(lastPageNum > MAX_NUM_OF_ENTRIES + 1 && "The records should span two directories.");
+
+    // Make room in a page of the second directory, then in a page of the first one
+    unsigned farRecord = numOfRecords - 200, nearRecord = 10;
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[farRecord]);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[nearRecord]);
+    assert(rc == success && "Deleting a record should not fail.");
+
+    uint64_t readPageCount, writePageCount, appendPageCount;
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+    uint64_t lastReadPageCount = readPageCount;
+
+    RID rid;
+    preparePayloadRecord(1, PAYLOAD_LENGTH, record);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.pageNum == rids[nearRecord].pageNum && "The first page with room should be used.");
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.pageNum == rids[farRecord].pageNum && "The next page with room should be used.");
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.pageNum >= lastPageNum && "A full file should grow.");
+
+    // Each insert reads the page and the directory entry it updates, and nothing else
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && readPageCount - lastReadPageCount <= 2 * 3 && "The directory should not be walked.");
+    cout << "3 inserts read " << readPageCount - lastReadPageCount << " pages." << endl;
+
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[nearRecord + 1], returnedRecord);
+    preparePayloadRecord(nearRecord + 1, PAYLOAD_LENGTH, record);
+    assert(rc == success && memcmp(record, returnedRecord, 1 + sizeof(uint32_t) + PAYLOAD_LENGTH) == 0
+           && "The other records should be kept.");
+
+    // Another handle of the file sees the room made by this one
+    FileHandle otherFileHandle;
+    rc = rbfm->openFile(fileName, otherFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[nearRecord + 1]);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->insertRecord(otherFileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.pageNum == rids[nearRecord + 1].pageNum && "The handles should share the free space.");
+    rc = rbfm->closeFile(otherFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // A new file of the same name starts empty
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && rid.pageNum == 1 && "The free space of the destroyed file should be forgotten.");
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Free Space Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the free-space map
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_freespace");
+
+    RC rcmain = RBFTest_FreeSpace(rbfm);
+    return rcmain;
+}
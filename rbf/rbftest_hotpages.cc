@@ -0,0 +1,155 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const PageNum hotPageNums[] = {40, 60, 80};
+const PageNum coldPageNum = 70;
+
+// Create the file and read a few pages over and over. There are too few accesses for the hot page list to be written
+// when the file is closed, so it is written at exit.
+void recordHotPages(PagedFileManager *pfm, const string &fileName, unsigned numOfPages)
+{
+    FileHandle fileHandle;
+    byte data[PAGE_SIZE];
+    memset(data, 'h', PAGE_SIZE);
+    if (pfm->createFile(fileName) != success || pfm->openFile(fileName, fileHandle) != success) {
+        _exit(1);
+    }
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        if (fileHandle.appendPage(data) != success) {
+            _exit(1);
+        }
+    }
+    for (unsigned round = 0; round < 20; round++)
+    {
+        for (PageNum pageNum : hotPageNums)
+        {
+            if (fileHandle.readPage(pageNum, data) != success) {
+                _exit(1);
+            }
+        }
+    }
+    if (fileHandle.readPage(coldPageNum, data) != success || pfm->closeFile(fileHandle) != success) {
+        _exit(1);
+    }
+    exit(0);
+}
+
+// Whether the given page (not counting the header page) is in the OS page cache
+bool isPageCached(const string &fileName, PageNum pageNum)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    size_t length = (size_t) (pageNum + 2) * PAGE_SIZE;
+    void *mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    assert(mapping != MAP_FAILED && "Mapping the file should not fail.");
+    long systemPageSize = sysconf(_SC_PAGESIZE);
+    vector<unsigned char> residency((length + systemPageSize - 1) / systemPageSize);
+    int result = mincore(mapping, length, residency.data());
+    assert(result == 0 && "Checking the residency should not fail.");
+    munmap(mapping, length);
+    return residency[(size_t) (pageNum + 1) * PAGE_SIZE / systemPageSize] & 1;
+}
+
+int RBFTest_HotPages(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. The hot page list is written at exit
+    // 2. The hot pages are prefetched into the OS page cache when the file is first opened by the next process
+    // 3. The hot page list is rewritten when the file is closed
+    // 4. Destroy File removes the list
+    cout << endl << "***** In RBF Test Case Hot Pages *****" << endl;
+
+    RC rc;
+    string fileName = "test_hotpages";
+    string listFileName = HotPageList::getListFileName(fileName);
+    const unsigned numOfPages = 100;
+    byte data[PAGE_SIZE];
+
+    pid_t pid = fork();
+    assert(pid >= 0 && "Forking should not fail.");
+    if (pid == 0) {
+        recordHotPages(pfm, fileName, numOfPages);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The first process should exit normally.");
+
+    vector<PageNum> pageNums;
+    HotPageList savedList(fileName);
+    rc = savedList.load(pageNums);
+    assert(rc == success && "The hot page list should be written at exit.");
+    assert(pageNums.size() == 4 && pageNums[0] == hotPageNums[0] && pageNums[1] == hotPageNums[1]
+           && pageNums[2] == hotPageNums[2] && pageNums[3] == coldPageNum && "The pages should be ordered by accesses.");
+
+    // The file is opened for the first time in this process
+    dropCachedFile(fileName);
+    bool isCacheDropped = !isPageCached(fileName, hotPageNums[0]) && !isPageCached(fileName, hotPageNums[1]);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    if (isCacheDropped) {
+        bool isPrefetched = false;
+        for (unsigned i = 0; i < 200 && !isPrefetched; i++)
+        {
+            isPrefetched = true;
+            for (PageNum pageNum : hotPageNums)
+            {
+                isPrefetched = isPrefetched && isPageCached(fileName, pageNum);
+            }
+            usleep(10000);
+        }
+        assert(isPrefetched && "The hot pages should be prefetched.");
+        cout << "The hot pages are in the page cache after the file is opened." << endl;
+    } else {
+        cout << "The page cache cannot be dropped here; prefetching is not checked." << endl;
+    }
+
+    // Another page becomes the hottest one
+    for (unsigned i = 0; i < HOT_PAGE_SAVE_INTERVAL; i++)
+    {
+        rc = fileHandle.readPage(10, data);
+        assert(rc == success && "Reading a page should not fail.");
+    }
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = savedList.load(pageNums);
+    assert(rc == success && pageNums.size() == 5 && pageNums[0] == 10 && "The list should be rewritten on close.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    struct stat listStat;
+    assert(stat(listFileName.c_str(), &listStat) != 0 && "The hot page list should be removed with the file.");
+
+    cout << "RBF Test Case Hot Pages Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the hot page list
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_hotpages");
+    remove("test_hotpages.hot");
+
+    RC rcmain = RBFTest_HotPages(pfm);
+    return rcmain;
+}
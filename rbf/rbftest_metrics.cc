@@ -0,0 +1,163 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Return the snapshot of the given file in the registry, or NULL if it is not there
+const IOMetricsSnapshot* findSnapshot(const vector<IOMetricsSnapshot> &snapshots, const string &fileName)
+{
+    for (const IOMetricsSnapshot &snapshot : snapshots)
+    {
+        if (snapshot.fileName == fileName) {
+            return &snapshot;
+        }
+    }
+    return NULL;
+}
+
+int RBFTest_Metrics(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Latency histograms of Read Page / Write Page / Append Page
+    // 2. Bytes read and written by the disk transfers, synchronous and asynchronous, and the queue depth
+    // 3. Syncs of a file with a write-ahead log
+    // 4. Snapshot and reset of the registry of all files
+    cout << endl << "***** In RBF Test Case Metrics *****" << endl;
+
+    RC rc;
+    string fileName = "test_metrics";
+    string logFileName = "test_metrics_wal";
+    const unsigned numOfPages = 100;
+    byte *data = allocateAlignedBuffer((size_t) numOfPages * PAGE_SIZE);
+    memset(data, 'm', (size_t) numOfPages * PAGE_SIZE);
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = pfm->createFile(logFileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+        rc = fileHandle.writePage(i, data);
+        assert(rc == success && "Writing a page should not fail.");
+        rc = fileHandle.readPage(i, data);
+        assert(rc == success && "Reading a page should not fail.");
+    }
+    rc = fileHandle.flushPages();
+    assert(rc == success && "Flushing the pages should not fail.");
+
+    IOMetricsSnapshot snapshot;
+    rc = fileHandle.collectIOMetrics(snapshot);
+    assert(rc == success && "Collecting the I/O metrics should not fail.");
+    assert(snapshot.fileName == fileName && "The metrics should be named after the file.");
+    assert(snapshot.latencies[IO_READ_PAGE].count == numOfPages && "Every Read Page should be timed.");
+    assert(snapshot.latencies[IO_WRITE_PAGE].count == numOfPages && "Every Write Page should be timed.");
+    assert(snapshot.latencies[IO_APPEND_PAGE].count == numOfPages && "Every Append Page should be timed.");
+    assert(snapshot.bytesWritten >= (uint64_t) numOfPages * PAGE_SIZE && "The flushed pages should be counted.");
+    for (unsigned operation = 0; operation < NUM_OF_IO_OPERATIONS; operation++)
+    {
+        const LatencyHistogram &latencies = snapshot.latencies[operation];
+        uint64_t count = 0;
+        for (unsigned bucket = 0; bucket < NUM_OF_LATENCY_BUCKETS; bucket++)
+        {
+            count += latencies.buckets[bucket];
+        }
+        assert(count == latencies.count && "Every operation should be in a bucket.");
+        assert(latencies.getPercentile(0.5) <= latencies.getPercentile(0.99)
+               && latencies.getPercentile(0.99) <= latencies.maxNanos && "The percentiles should be ordered.");
+    }
+
+    // Drop the cached pages, so that they are read from the file again, synchronously and asynchronously
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+    uint64_t bytesRead = snapshot.bytesRead;
+    rc = fileHandle.readPages(0, numOfPages / 2, data);
+    assert(rc == success && "Reading the pages should not fail.");
+    vector<AsyncPageIO> requests(numOfPages / 2);
+    for (unsigned i = 0; i < requests.size(); i++)
+    {
+        requests[i].pageNum = numOfPages / 2 + i;
+        requests[i].data = data + (size_t) i * PAGE_SIZE;
+    }
+    rc = fileHandle.submitPages(requests.data(), requests.size());
+    assert(rc == success && "Submitting the reads should not fail.");
+    rc = fileHandle.waitPages(requests.data(), requests.size());
+    assert(rc == success && "The reads should not fail.");
+
+    rc = fileHandle.collectIOMetrics(snapshot);
+    assert(rc == success && "Collecting the I/O metrics should not fail.");
+    assert(snapshot.bytesRead - bytesRead == (uint64_t) numOfPages * PAGE_SIZE && "Every page read should be counted.");
+    assert(snapshot.latencies[IO_DISK_READ].count >= 2 && "The disk reads should be timed.");
+    assert(snapshot.queueDepth == 0 && snapshot.maxQueueDepth >= 1 && "No transfer should be left in flight.");
+    cout << "Max queue depth: " << snapshot.maxQueueDepth << ", median read: "
+         << snapshot.latencies[IO_DISK_READ].getPercentile(0.5) << " ns" << endl;
+
+    // The log syncs are timed
+    FileHandle logFileHandle;
+    rc = pfm->openFile(logFileName, logFileHandle, OPEN_WAL);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = logFileHandle.appendPage(data);
+    assert(rc == success && "Appending a page should not fail.");
+    rc = logFileHandle.collectIOMetrics(snapshot);
+    assert(rc == success && snapshot.latencies[IO_SYNC].count > 0 && "The log sync should be timed.");
+
+    vector<IOMetricsSnapshot> snapshots;
+    rc = pfm->collectIOMetrics(snapshots);
+    assert(rc == success && "Collecting the I/O metrics should not fail.");
+    assert(findSnapshot(snapshots, fileName) != NULL && findSnapshot(snapshots, logFileName) != NULL
+           && "Both files should be in the registry.");
+    assert(findSnapshot(snapshots, fileName)->latencies[IO_READ_PAGE].count == numOfPages
+           && "The registry should hold the same metrics as the handle.");
+
+    pfm->resetIOMetrics();
+    rc = fileHandle.collectIOMetrics(snapshot);
+    assert(rc == success && snapshot.latencies[IO_READ_PAGE].count == 0 && snapshot.bytesRead == 0
+           && "The metrics should be reset.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->closeFile(logFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = pfm->destroyFile(logFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = pfm->collectIOMetrics(snapshots);
+    assert(rc == success && findSnapshot(snapshots, fileName) == NULL
+           && "A destroyed file should leave the registry.");
+
+    free(data);
+
+    cout << "RBF Test Case Metrics Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the I/O metrics
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_metrics");
+    remove("test_metrics_wal");
+    remove("test_metrics_wal.wal");
+
+    RC rcmain = RBFTest_Metrics(pfm);
+    return rcmain;
+}
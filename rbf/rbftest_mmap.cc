@@ -0,0 +1,149 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h> 
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h> 
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Mmap(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Open File with OPEN_MMAP
+    // 2. Map Page before and after the file grows
+    // 3. Map Page after Write Page
+    // 4. Scan a mapped file
+    cout << endl << "***** In RBF Test Case Mmap *****" << endl;
+
+    RC rc;
+    string fileName = "test_mmap";
+    const unsigned numOfPages = 600;      // more than the initial mapping
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, OPEN_MMAP | OPEN_DIRECT_IO);
+    assert(rc != success && "A file cannot be both mapped and opened with direct I/O.");
+
+    rc = pfm->openFile(fileName, fileHandle, OPEN_MMAP);
+    assert(rc == success && "Opening the file with OPEN_MMAP should not fail.");
+    assert(fileHandle.isMapped() && "The file should be mapped.");
+
+    byte data[PAGE_SIZE];
+    memset(data, 'a', PAGE_SIZE);
+    rc = fileHandle.appendPage(data);
+    assert(rc == success && "Appending a page should not fail.");
+
+    const byte *firstPage = nullptr;
+    rc = fileHandle.mapPage(0, firstPage);
+    assert(rc == success && firstPage[0] == 'a' && firstPage[PAGE_SIZE - 1] == 'a' && "Mapping a page should not fail.");
+
+    // Grow the file beyond the mapping
+    for (unsigned i = 1; i < numOfPages; i++)
+    {
+        memset(data, 'a' + i % 26, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+    const byte *page = nullptr;
+    rc = fileHandle.mapPage(numOfPages - 1, page);
+    assert(rc == success && page[0] == 'a' + (numOfPages - 1) % 26 && "Mapping an appended page should not fail.");
+    assert(firstPage[0] == 'a' && "A page pointer should stay valid after the file grows.");
+
+    rc = fileHandle.mapPage(numOfPages, page);
+    assert(rc != success && "Mapping a page that does not exist should fail.");
+
+    // The mapping should see writes
+    memset(data, 'z', PAGE_SIZE);
+    rc = fileHandle.writePage(0, data);
+    assert(rc == success && "Writing a page should not fail.");
+    rc = fileHandle.mapPage(0, page);
+    assert(rc == success && memcmp(page, data, PAGE_SIZE) == 0 && "A mapped page should see earlier writes.");
+
+    rc = fileHandle.adviseSequential();
+    assert(rc == success && "Advising the mapping should not fail.");
+    rc = fileHandle.prefetchMappedPages(0, numOfPages);
+    assert(rc == success && "Prefetching mapped pages should not fail.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // Insert records and scan them through the mapping
+    const int numOfRecords = 5000;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+    unsigned char *nullsIndicator = (unsigned char *) malloc(nullFieldsIndicatorActualSize);
+    memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    byte record[PAGE_SIZE];
+    int recordSize = 0;
+    RID rid;
+    for (int i = 0; i < numOfRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Employee", i, 170.0f, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->openFile(fileName, fileHandle, OPEN_MMAP);
+    assert(rc == success && "Opening the file with OPEN_MMAP should not fail.");
+
+    int threshold = numOfRecords / 2;
+    vector<string> attributes;
+    attributes.push_back("Age");
+    RBFM_ScanIterator rbfm_ScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &threshold, attributes, rbfm_ScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    int count = 0;
+    long long sum = 0;
+    while (rbfm_ScanIterator.getNextRecord(rid, record) != RBFM_EOF)
+    {
+        int age = *((int *) (record + 1));
+        assert(age >= threshold && "The scan should only return qualified records.");
+        sum += age;
+        count++;
+    }
+    rbfm_ScanIterator.close();
+    assert(count == numOfRecords - threshold && "The scan should return all qualified records.");
+    assert(sum == (long long) (threshold + numOfRecords - 1) * (numOfRecords - threshold) / 2 && "The scanned values should be correct.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(nullsIndicator);
+
+    cout << "RBF Test Case Mmap Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the mapped read path of the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    
+    remove("test_mmap");
+
+    RC rcmain = RBFTest_Mmap(pfm, rbfm);
+    return rcmain;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// The page size is stored after the fingerprint and the four 64-bit counters of the header page
+const int PAGE_SIZE_OFFSET = 5 * sizeof(uint64_t);
+
+int RBFTest_PageSize(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Create File (the page size is recorded in the header page)
+    // 2. Open File (a file with another page size is rejected)
+    // 3. Append Page / Read Page with the configured page size
+    cout << endl << "***** In RBF Test Case PageSize *****" << endl;
+
+    RC rc;
+    string fileName = "test_pagesize";
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    assert(getFileSize(fileName) == PAGE_SIZE && "The header page should have the configured page size.");
+
+    fstream file(fileName, fstream::in | fstream::out | fstream::binary);
+    uint32_t pageSize = 0;
+    file.seekg(PAGE_SIZE_OFFSET);
+    file.read((char*) &pageSize, sizeof(pageSize));
+    assert(file && pageSize == PAGE_SIZE && "The page size should be recorded in the header page.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    byte data[PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+    for (unsigned i = 0; i < PAGE_SIZE; i++)
+    {
+        data[i] = i % 251;
+    }
+    rc = fileHandle.appendPage(data);
+    assert(rc == success && "Appending a page should not fail.");
+    rc = fileHandle.readPage(0, buffer);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The page read should be the same as the page appended.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    assert(getFileSize(fileName) == 2 * PAGE_SIZE && "The file should have a header page and a data page.");
+
+    // Pretend that the file was created with half the page size
+    pageSize = PAGE_SIZE / 2;
+    file.seekp(PAGE_SIZE_OFFSET);
+    file.write((const char*) &pageSize, sizeof(pageSize));
+    file.close();
+
+    // Drop the cached header page, so that it is read from the file again
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc != success && "Opening a file with another page size should fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case PageSize Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the page size recorded in the file header
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_pagesize");
+
+    RC rcmain = RBFTest_PageSize(pfm);
+    return rcmain;
+}
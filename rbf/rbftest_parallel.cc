@@ -0,0 +1,160 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+bool operator<(const RID &rid1, const RID &rid2)
+{
+    return rid1.pageNum < rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum < rid2.slotNum);
+}
+
+// Scan the file by batches with the given number of threads (a serial scan if 0); return the RIDs and salaries
+void scanFile(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+              unsigned numOfThreads, bool isOrdered, vector<RID> &rids, vector<int32_t> &salaries)
+{
+    vector<string> attributeNames = {"Salary", "Age"};
+    int32_t age = 50;
+    RecordBatch batch;
+    rids.clear();
+    salaries.clear();
+
+    RC rc;
+    RBFM_ScanIterator scanIterator;
+    RBFM_ParallelScanIterator parallelScanIterator;
+    if (numOfThreads == 0) {
+        rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, attributeNames, scanIterator);
+    } else {
+        rc = rbfm->parallelScan(fileHandle, recordDescriptor, "Age", LT_OP, &age, attributeNames, numOfThreads,
+                                isOrdered, parallelScanIterator);
+    }
+    assert(rc == success && "Scanning the file should not fail.");
+
+    while ((numOfThreads == 0 ? scanIterator.getNextBatch(batch) : parallelScanIterator.getNextBatch(batch))
+           != RBFM_EOF)
+    {
+        assert(batch.getNumOfColumns() == attributeNames.size() && "A batch should have the projected columns.");
+        for (unsigned i = 0; i < batch.getNumOfRecords(); i++)
+        {
+            assert(batch.getInts(1)[i] < age && "The condition should hold.");
+            rids.push_back(batch.getRids()[i]);
+            salaries.push_back(batch.getInts(0)[i]);
+        }
+    }
+    scanIterator.close();
+    parallelScanIterator.close();
+}
+
+int RBFTest_Parallel(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. An ordered Parallel Scan returns the records of a serial scan, in the same order
+    // 2. An unordered Parallel Scan returns the same records
+    // 3. A Parallel Scan closed before its end can be reused
+    cout << endl << "***** In RBF Test Case Parallel *****" << endl;
+
+    RC rc;
+    string fileName = "test_parallel";
+    const unsigned numOfRecords = 80000;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    RID rid;
+    int recordSize = 0;
+    unsigned char nullsIndicator = 0;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        string name(1 + i % 30, 'a' + i % 26);
+        prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, 150 + i % 50, i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    assert(fileHandle.getNumberOfPages() > MAX_NUM_OF_ENTRIES + 1 && "The records should span two directories.");
+    cout << numOfRecords << " records in " << fileHandle.getNumberOfPages() << " pages." << endl;
+
+    vector<RID> serialRids, rids;
+    vector<int32_t> serialSalaries, salaries;
+    scanFile(rbfm, fileHandle, recordDescriptor, 0, true, serialRids, serialSalaries);
+    assert(serialRids.size() == numOfRecords / 2 && "The serial scan should return half the records.");
+
+    for (unsigned numOfThreads : {1, 4, 7})
+    {
+        scanFile(rbfm, fileHandle, recordDescriptor, numOfThreads, true, rids, salaries);
+        assert(rids.size() == serialRids.size() && "The parallel scan should return every record.");
+        for (unsigned i = 0; i < rids.size(); i++)
+        {
+            assert(rids[i].pageNum == serialRids[i].pageNum && rids[i].slotNum == serialRids[i].slotNum
+                   && salaries[i] == serialSalaries[i] && "The ordered scan should keep the order of the file.");
+        }
+
+        scanFile(rbfm, fileHandle, recordDescriptor, numOfThreads, false, rids, salaries);
+        assert(rids.size() == serialRids.size() && "The parallel scan should return every record.");
+        sort(rids.begin(), rids.end());
+        sort(salaries.begin(), salaries.end());
+        vector<int32_t> sortedSalaries(serialSalaries);
+        sort(sortedSalaries.begin(), sortedSalaries.end());
+        for (unsigned i = 0; i < rids.size(); i++)
+        {
+            assert(rids[i].pageNum == serialRids[i].pageNum && rids[i].slotNum == serialRids[i].slotNum
+                   && salaries[i] == sortedSalaries[i] && "The unordered scan should return the same records.");
+        }
+    }
+
+    // Stop a scan after its first batch, then scan again with the same iterator
+    RBFM_ParallelScanIterator parallelScanIterator;
+    RecordBatch batch;
+    vector<string> attributeNames(1, "Salary");
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, 4, false,
+                            parallelScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    rc = parallelScanIterator.getNextBatch(batch);
+    assert(rc == success && "The scan should not fail.");
+    parallelScanIterator.close();
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, 4, false,
+                            parallelScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    unsigned numOfScannedRecords = 0;
+    while (parallelScanIterator.getNextBatch(batch) != RBFM_EOF)
+    {
+        numOfScannedRecords += batch.getNumOfRecords();
+    }
+    parallelScanIterator.close();
+    assert(numOfScannedRecords == numOfRecords && "Every record should be scanned.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Parallel Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the parallel scan
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_parallel");
+
+    RC rcmain = RBFTest_Parallel(rbfm);
+    return rcmain;
+}
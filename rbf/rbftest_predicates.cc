@@ -0,0 +1,147 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+string getEmployeeName(unsigned recordNum)
+{
+    return string(1 + recordNum % 5, 'a' + recordNum % 3);
+}
+
+// Scan the file with the condition and check that exactly the records satisfying isSatisfied are returned
+template<typename Satisfied>
+void checkScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+               const ScanCondition &condition, unsigned numOfRecords, Satisfied isSatisfied)
+{
+    vector<string> attributeNames(1, "Salary");
+    RBFM_ScanIterator scanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, condition, attributeNames, scanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    vector<bool> isReturned(numOfRecords, false);
+    unsigned numOfReturnedRecords = 0;
+    RID rid;
+    byte data[PAGE_SIZE];
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF)
+    {
+        unsigned recordNum = *((int32_t*) (data + 1));
+        assert(recordNum < numOfRecords && !isReturned[recordNum] && isSatisfied(recordNum)
+               && "Only the satisfying records should be returned, once.");
+        isReturned[recordNum] = true;
+        numOfReturnedRecords++;
+    }
+    scanIterator.close();
+
+    unsigned numOfSatisfyingRecords = 0;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        numOfSatisfyingRecords += isSatisfied(i) ? 1 : 0;
+    }
+    assert(numOfReturnedRecords == numOfSatisfyingRecords && "Every satisfying record should be returned.");
+    cout << numOfReturnedRecords << " records returned." << endl;
+}
+
+int RBFTest_Predicates(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Scan with a conjunction of predicates
+    // 2. Scan with groups of alternative predicates, and IS NULL / IS NOT NULL
+    // 3. The result does not depend on the order of the predicates, which are reordered during the scan
+    // 4. A predicate on an unknown attribute fails the scan
+    cout << endl << "***** In RBF Test Case Predicates *****" << endl;
+
+    RC rc;
+    string fileName = "test_predicates";
+    const unsigned numOfRecords = 10000;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    RID rid;
+    int recordSize = 0;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        // the age is NULL for one record out of seven and the height for one out of eleven
+        string name = getEmployeeName(i);
+        unsigned char nullsIndicator = ((i % 7 == 0) ? 0x40 : 0) | ((i % 11 == 0) ? 0x20 : 0);
+        prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, 150 + i % 50, i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    int32_t age = 30, salary = 100;
+    float height = 160;
+    byte name[sizeof(uint32_t) + 3];
+    *((uint32_t*) name) = 3;
+    memcpy(name + sizeof(uint32_t), "bbb", 3);
+
+    // Salary >= 100 AND Age < 30 AND Height > 160, least selective first
+    ScanCondition condition = {
+        {{COMPARE_PRED, "Salary", GE_OP, &salary}},
+        {{COMPARE_PRED, "Age", LT_OP, &age}},
+        {{COMPARE_PRED, "Height", GT_OP, &height}}};
+    checkScan(rbfm, fileHandle, recordDescriptor, condition, numOfRecords, [](unsigned i) {
+        return i >= 100 && i % 7 != 0 && i % 100 < 30 && i % 11 != 0 && 150 + i % 50 > 160;
+    });
+
+    // (Age IS NULL OR EmpName = "bbb") AND Height IS NOT NULL
+    condition = {
+        {{IS_NULL_PRED, "Age", NO_OP, NULL}, {COMPARE_PRED, "EmpName", EQ_OP, name}},
+        {{NOT_NULL_PRED, "Height", NO_OP, NULL}}};
+    checkScan(rbfm, fileHandle, recordDescriptor, condition, numOfRecords, [](unsigned i) {
+        return (i % 7 == 0 || getEmployeeName(i) == "bbb") && i % 11 != 0;
+    });
+
+    // (Age < 30 OR Age != NULL value) is Age IS NOT NULL; a NULL value only satisfies !=
+    condition = {{{COMPARE_PRED, "Age", LT_OP, &age}, {COMPARE_PRED, "Age", NE_OP, NULL}}};
+    checkScan(rbfm, fileHandle, recordDescriptor, condition, numOfRecords, [](unsigned i) {
+        return i % 7 != 0;
+    });
+
+    // No condition
+    checkScan(rbfm, fileHandle, recordDescriptor, ScanCondition(), numOfRecords, [](unsigned) {
+        return true;
+    });
+
+    RBFM_ScanIterator scanIterator;
+    vector<string> attributeNames(1, "Salary");
+    condition = {{{COMPARE_PRED, "Age", LT_OP, &age}}, {{IS_NULL_PRED, "Weight", NO_OP, NULL}}};
+    rc = rbfm->scan(fileHandle, recordDescriptor, condition, attributeNames, scanIterator);
+    assert(rc != success && "A predicate on an unknown attribute should fail the scan.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case Predicates Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the scans with several predicates
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_predicates");
+
+    RC rcmain = RBFTest_Predicates(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h> 
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h> 
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+bool checkPage(const byte *page, byte expected)
+{
+    return page[0] == expected && page[PAGE_SIZE / 2] == expected && page[PAGE_SIZE - 1] == expected;
+}
+
+int RBFTest_Readahead(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Read Pages (vectored read of consecutive pages)
+    // 2. Read Pages with cached and dirty pages in the buffer pool
+    // 3. Readahead of sequential Read Page calls
+    // 4. Readahead invalidation after Write Page
+    // 5. Multi-page asynchronous requests
+    cout << endl << "***** In RBF Test Case Readahead *****" << endl;
+
+    RC rc;
+    string fileName = "test_readahead";
+    const unsigned numOfPages = 300;
+
+    // Use a small buffer pool, so that some pages are cached and others are not
+    rc = pfm->setBufferPoolSize(16);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    byte data[PAGE_SIZE];
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        memset(data, 'a' + i % 26, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    // Dirty a page in the middle; it is cached in the pool and not written back yet
+    memset(data, 'Z', PAGE_SIZE);
+    rc = fileHandle.writePage(100, data);
+    assert(rc == success && "Writing a page should not fail.");
+
+    unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+    unsigned readPageCount1 = 0;
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting counter values should not fail.");
+
+    byte *pages = new byte[numOfPages * PAGE_SIZE];
+    rc = fileHandle.readPages(0, numOfPages, pages);
+    assert(rc == success && "Reading pages should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        byte expected = (i == 100) ? 'Z' : 'a' + i % 26;
+        assert(checkPage(pages + i * PAGE_SIZE, expected) && "Pages read with vectored I/O should be correct.");
+    }
+    rc = fileHandle.collectCounterValues(readPageCount1, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting counter values should not fail.");
+    assert(readPageCount1 - readPageCount == numOfPages && "Read counter should count every page.");
+
+    rc = fileHandle.readPages(numOfPages - 1, 2, pages);
+    assert(rc != success && "Reading pages beyond the end of the file should fail.");
+
+    // Sequential reads should be served by readahead
+    unsigned fillCount = 0, pageCount = 0, hitCount = 0;
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = fileHandle.readPage(i, data);
+        assert(rc == success && "Reading a page should not fail.");
+        byte expected = (i == 100) ? 'Z' : 'a' + i % 26;
+        assert(checkPage(data, expected) && "Pages read ahead should be correct.");
+    }
+    rc = fileHandle.collectReadaheadCounterValues(fillCount, pageCount, hitCount);
+    assert(rc == success && "Collecting readahead counter values should not fail.");
+    assert(fillCount > 0 && fillCount < numOfPages / 4 && "Sequential reads should be batched by readahead.");
+    assert(hitCount + fillCount + READAHEAD_TRIGGER == numOfPages && "Most sequential reads should hit the ring.");
+
+    // A write should invalidate the pages read ahead
+    rc = fileHandle.readPage(10, data);
+    rc = fileHandle.readPage(11, data);
+    rc = fileHandle.readPage(12, data);
+    assert(rc == success && "Reading a page should not fail.");
+    memset(data, 'Y', PAGE_SIZE);
+    rc = fileHandle.writePage(13, data);
+    assert(rc == success && "Writing a page should not fail.");
+    rc = fileHandle.readPage(13, data);
+    assert(rc == success && checkPage(data, 'Y') && "A page read after a write should see the write.");
+
+    // Disabled readahead
+    rc = fileHandle.collectReadaheadCounterValues(fillCount, pageCount, hitCount);
+    assert(rc == success && "Collecting readahead counter values should not fail.");
+    fileHandle.setReadaheadWindow(0);
+    unsigned fillCount1 = 0;
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        rc = fileHandle.readPage(i, data);
+        assert(rc == success && "Reading a page should not fail.");
+    }
+    rc = fileHandle.collectReadaheadCounterValues(fillCount1, pageCount, hitCount);
+    assert(rc == success && "Collecting readahead counter values should not fail.");
+    assert(fillCount1 == fillCount && "No readahead should happen when it is disabled.");
+
+    // Multi-page asynchronous reads
+    AsyncPageIO requests[3];
+    for (unsigned i = 0; i < 3; i++)
+    {
+        requests[i].pageNum = i * 100;
+        requests[i].numOfPages = 100;
+        requests[i].data = pages + i * 100 * PAGE_SIZE;
+    }
+    memset(pages, 0, numOfPages * PAGE_SIZE);
+    rc = fileHandle.submitPages(requests, 3);
+    assert(rc == success && "Submitting page reads should not fail.");
+    rc = fileHandle.waitPages(requests, 3);
+    assert(rc == success && "Page reads should not fail.");
+    for (unsigned i = 0; i < numOfPages; i++)
+    {
+        byte expected = (i == 100) ? 'Z' : (i == 13) ? 'Y' : 'a' + i % 26;
+        assert(checkPage(pages + i * PAGE_SIZE, expected) && "Pages read asynchronously should be correct.");
+    }
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = pfm->setBufferPoolSize(DEFAULT_NUM_OF_FRAMES);
+    assert(rc == success && "Setting the buffer pool size should not fail.");
+
+    delete[] pages;
+
+    cout << "RBF Test Case Readahead Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test vectored reads and readahead of the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+    
+    remove("test_readahead");
+
+    RC rcmain = RBFTest_Readahead(pfm);
+    return rcmain;
+}
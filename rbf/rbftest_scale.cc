@@ -0,0 +1,177 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Build a page of the record-based file layout: a directory header page listing the following
+// record pages as full, or an empty record page stamped with its page number
+void prepareScalePage(PageNum pageNum, PageNum numOfPages, byte *page)
+{
+    memset(page, 0, PAGE_SIZE);
+    if (isHeaderPage(pageNum)) {
+        for (unsigned entryNum = 0; entryNum < MAX_NUM_OF_ENTRIES && pageNum + entryNum + 1 < numOfPages; ++entryNum) {
+            *((PageNum*) (page + entryNum*(PAGE_NUM_SZ + FREE_SPACE_SZ))) = pageNum + entryNum + 1;
+        }
+        PageNum nextHeaderNum = pageNum + MAX_NUM_OF_ENTRIES + 1;
+        *((PageNum*) (page + PAGE_SIZE - PAGE_NUM_SZ)) = (nextHeaderNum < numOfPages) ? nextHeaderNum : 0;
+    } else {
+        *((PageNum*) page) = pageNum;
+    }
+}
+
+int RBFTest_Scale(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Append Page beyond 4 GB
+    // 2. Read Page / Read Pages across the 4 GB offset
+    // 3. 64-bit counters in the header page after reopening the file
+    // 4. Insert / Read / Delete Record on pages beyond 4 GB
+    // 5. Scan through more than 4 GB of directory and record pages
+    cout << endl << "***** In RBF Test Case Scale *****" << endl;
+
+    RC rc;
+    string fileName = "test_scale";
+    const PageNum boundaryPageNum = (PageNum) ((1ULL << 32) / PAGE_SIZE) - 1;  // the page at physical offset 4 GB
+    const PageNum numOfPages = boundaryPageNum + 50001;
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // The first directory header page has been appended by openFile()
+    byte page[PAGE_SIZE];
+    prepareScalePage(0, numOfPages, page);
+    rc = fileHandle.writePage(0, page);
+    assert(rc == success && "Writing a page should not fail.");
+    for (PageNum i = 1; i < numOfPages; i++)
+    {
+        prepareScalePage(i, numOfPages, page);
+        rc = fileHandle.appendPage(page);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    struct stat fileStat;
+    assert(stat(fileName.c_str(), &fileStat) == 0 && (uint64_t) fileStat.st_size > (1ULL << 32)
+           && "The file should be larger than 4 GB.");
+
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "The number of pages should be persisted.");
+
+    uint64_t readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+    rc = fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    assert(rc == success && "Collecting the counter values should not fail.");
+    assert(appendPageCount == numOfPages && "The append counter should be persisted.");
+
+    // Read the pages around the 4 GB offset, one by one and with a vectored read
+    const unsigned numOfBoundaryPages = 16;
+    byte *pages = new byte[numOfBoundaryPages * PAGE_SIZE];
+    rc = fileHandle.readPages(boundaryPageNum - numOfBoundaryPages / 2, numOfBoundaryPages, pages);
+    assert(rc == success && "Reading pages across 4 GB should not fail.");
+    for (unsigned i = 0; i < numOfBoundaryPages; i++)
+    {
+        PageNum pageNum = boundaryPageNum - numOfBoundaryPages / 2 + i;
+        prepareScalePage(pageNum, numOfPages, page);
+        assert(memcmp(page, pages + i * PAGE_SIZE, PAGE_SIZE) == 0 && "Pages read across 4 GB should be correct.");
+
+        rc = fileHandle.readPage(pageNum, pages);
+        assert(rc == success && "Reading a page beyond 4 GB should not fail.");
+        assert(memcmp(page, pages, PAGE_SIZE) == 0 && "The page read beyond 4 GB should be correct.");
+    }
+    delete[] pages;
+
+    // Insert records; they go to new pages at the end of the file
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    void *record = malloc(1000);
+    void *returnedData = malloc(1000);
+    int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+    unsigned char *nullsIndicator = (unsigned char *) malloc(nullFieldsIndicatorActualSize);
+    memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+    int recordSize = 0;
+    const unsigned numOfRecords = 20;
+    vector<RID> rids;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        RID rid;
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 6, "Scale" + to_string(i % 10), 20 + i, 177.8, 6200 + i,
+                      record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record beyond 4 GB should not fail.");
+        assert(rid.pageNum >= numOfPages && "The record should be inserted into a new page.");
+        rids.push_back(rid);
+    }
+
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 6, "Scale" + to_string(i % 10), 20 + i, 177.8, 6200 + i,
+                      record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        assert(rc == success && "Reading a record beyond 4 GB should not fail.");
+        assert(memcmp(record, returnedData, recordSize) == 0 && "The record read beyond 4 GB should be correct.");
+    }
+
+    // Deleting a record updates the directory entry of a page beyond 4 GB; the space is then reused
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[0]);
+    assert(rc == success && "Deleting a record beyond 4 GB should not fail.");
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record beyond 4 GB should not fail.");
+    assert(rid.pageNum == rids[0].pageNum && "The freed space should be reused.");
+
+    // Scan the whole file; only the inserted records are found
+    vector<string> attrs;
+    attrs.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attrs, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    unsigned numOfScanned = 0;
+    while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        assert(rid.pageNum >= numOfPages && "Only the inserted records should be scanned.");
+        numOfScanned++;
+    }
+    rbfmScanIterator.close();
+    assert(numOfScanned == numOfRecords && "All the records should be scanned.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+    free(nullsIndicator);
+
+    cout << "RBF Test Case Scale Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test a record-based file larger than 4 GB (needs about 5 GB of free disk space)
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_scale");
+
+    RC rcmain = RBFTest_Scale(rbfm);
+    return rcmain;
+}
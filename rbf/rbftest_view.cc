@@ -0,0 +1,114 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+string getEmployeeName(unsigned recordNum)
+{
+    return string(recordNum % 20 + 1, 'a' + recordNum % 26);
+}
+
+int RBFTest_View(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. The fields of a RecordView are those of the projected attributes, NULLs included
+    // 2. A RecordView materializes to the data returned by getNextRecord() for the same record
+    // 3. The condition of the scan applies to the views
+    cout << endl << "***** In RBF Test Case View *****" << endl;
+
+    RC rc;
+    string fileName = "test_view";
+    const unsigned numOfRecords = 2000;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+    byte returnedRecord[PAGE_SIZE];
+    byte materializedRecord[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    RID rid;
+    int recordSize = 0;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        // the height is NULL for one record out of five
+        string name = getEmployeeName(i);
+        unsigned char nullsIndicator = (i % 5 == 0) ? 0x20 : 0;
+        prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, 150 + i % 50, 1000 * i, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // Project the fields out of order, and select the records of salary 1000000 or more
+    vector<string> attributeNames = {"Salary", "Height", "EmpName"};
+    int32_t salary = 1000000;
+    RBFM_ScanIterator viewIterator, dataIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, attributeNames, viewIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, attributeNames, dataIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RecordView view;
+    RID dataRid;
+    unsigned numOfViews = 0;
+    while (viewIterator.getNextRecord(rid, view) != RBFM_EOF)
+    {
+        rc = dataIterator.getNextRecord(dataRid, returnedRecord);
+        assert(rc == success && rid.pageNum == dataRid.pageNum && rid.slotNum == dataRid.slotNum
+               && "Both scans should return the same records.");
+        assert(view.getNumOfFields() == attributeNames.size() && "A view should have the projected fields.");
+
+        unsigned recordNum = view.getInt(0) / 1000;
+        assert(recordNum >= 1000 && recordNum < numOfRecords && !view.isNull(0) && "The condition should hold.");
+        assert(view.isNull(1) == (recordNum % 5 == 0) && "The NULL field should be NULL.");
+        assert((view.isNull(1) || view.getReal(1) == 150 + recordNum % 50) && "The real field should be read.");
+        unsigned nameLength;
+        const char *name = view.getVarChar(2, nameLength);
+        assert(!view.isNull(2) && getEmployeeName(recordNum) == string(name, nameLength)
+               && "The varchar field should be read.");
+
+        view.materialize(materializedRecord);
+        unsigned length = 1 + sizeof(int32_t) + (view.isNull(1) ? 0 : sizeof(float)) + sizeof(uint32_t) + nameLength;
+        assert(memcmp(materializedRecord, returnedRecord, length) == 0 && "The view should materialize to the record.");
+        numOfViews++;
+    }
+    rc = dataIterator.getNextRecord(dataRid, returnedRecord);
+    assert(rc == RBFM_EOF && numOfViews == numOfRecords - 1000
+           && "Every satisfying record should be returned.");
+    viewIterator.close();
+    dataIterator.close();
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case View Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the record views of a scan
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_view");
+
+    RC rcmain = RBFTest_View(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Fill a page with a pattern that depends on the page number and on the version of the page
+void preparePage(PageNum pageNum, unsigned version, byte *data)
+{
+    for (unsigned i = 0; i < PAGE_SIZE; i++)
+    {
+        data[i] = (pageNum * 31 + version * 7 + i) % 251;
+    }
+}
+
+// Overwrite the given pages of the file several times
+void writePages(FileHandle fileHandle, PageNum firstPageNum, unsigned numOfPages, unsigned numOfVersions,
+                bool &isCorrect)
+{
+    byte data[PAGE_SIZE];
+    isCorrect = true;
+    for (unsigned version = 1; version <= numOfVersions; version++)
+    {
+        for (PageNum pageNum = firstPageNum; pageNum < firstPageNum + numOfPages; pageNum++)
+        {
+            preparePage(pageNum, version, data);
+            if (fileHandle.writePage(pageNum, data) != success) {
+                isCorrect = false;
+                return;
+            }
+        }
+    }
+}
+
+// Append pages and overwrite some of them, then exit without closing the file or flushing the buffer pool
+void crash(PagedFileManager *pfm, const string &fileName, unsigned numOfPages)
+{
+    FileHandle fileHandle;
+    if (pfm->openFile(fileName, fileHandle, OPEN_WAL) != success) {
+        _exit(1);
+    }
+    byte data[PAGE_SIZE];
+    for (PageNum pageNum = 0; pageNum < numOfPages; pageNum++)
+    {
+        preparePage(pageNum, 0, data);
+        if (fileHandle.appendPage(data) != success) {
+            _exit(1);
+        }
+    }
+    for (PageNum pageNum = 0; pageNum < numOfPages; pageNum += 2)
+    {
+        preparePage(pageNum, 1, data);
+        if (fileHandle.writePage(pageNum, data) != success) {
+            _exit(1);
+        }
+    }
+    _exit(0);
+}
+
+int RBFTest_WAL(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Append Page / Write Page with OPEN_WAL, then a crash before the pages are written back
+    // 2. Open File replays the log, ignoring a torn record at its end
+    // 3. Concurrent Write Page with OPEN_WAL (group commit)
+    // 4. Flushing all pages empties the log
+    cout << endl << "***** In RBF Test Case WAL *****" << endl;
+
+    RC rc;
+    string fileName = "test_wal";
+    string logFileName = WriteAheadLog::getLogFileName(fileName);
+    const unsigned numOfPages = 200;
+    const unsigned numOfThreads = 4;
+    const unsigned numOfVersions = 5;
+    byte data[PAGE_SIZE];
+    byte buffer[PAGE_SIZE];
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    // The child process crashes; the pages it wrote are only in its buffer pool and in the log
+    pid_t pid = fork();
+    assert(pid >= 0 && "Forking should not fail.");
+    if (pid == 0) {
+        crash(pfm, fileName, numOfPages);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The writer should exit normally.");
+    assert(getFileSize(fileName) == PAGE_SIZE && "No page should have been written back before the crash.");
+    assert(WriteAheadLog::hasRecords(fileName) && "The log should hold the pages written.");
+
+    // A record torn by the crash at the end of the log is ignored
+    FILE *logFile = fopen(logFileName.c_str(), "ab");
+    assert(logFile != NULL && "Opening the log should not fail.");
+    memset(data, 0x5a, PAGE_SIZE);
+    fwrite(data, 1, PAGE_SIZE / 2, logFile);
+    fclose(logFile);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle, OPEN_WAL);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == numOfPages && "The appended pages should be recovered.");
+
+    unsigned recordCount = 0, flushCount = 0, recoveredCount = 0;
+    rc = fileHandle.collectLogCounterValues(recordCount, flushCount, recoveredCount);
+    assert(rc == success && "Collecting the log counter values should not fail.");
+    assert(recoveredCount >= numOfPages + numOfPages / 2 && "Every page written should be replayed.");
+    assert(!WriteAheadLog::hasRecords(fileName) && "The log should be emptied after recovery.");
+
+    for (PageNum pageNum = 0; pageNum < numOfPages; pageNum++)
+    {
+        rc = fileHandle.readPage(pageNum, buffer);
+        assert(rc == success && "Reading a recovered page should not fail.");
+        preparePage(pageNum, (pageNum % 2 == 0) ? 1 : 0, data);
+        assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The recovered page should be the last one written.");
+    }
+
+    // Writers on disjoint pages share the log syncs
+    vector<thread> threads;
+    bool isCorrect[numOfThreads];
+    const unsigned numOfPagesPerThread = numOfPages / numOfThreads;
+    for (unsigned i = 0; i < numOfThreads; i++)
+    {
+        threads.emplace_back(writePages, fileHandle, i * numOfPagesPerThread, numOfPagesPerThread, numOfVersions,
+                             ref(isCorrect[i]));
+    }
+    for (unsigned i = 0; i < numOfThreads; i++)
+    {
+        threads[i].join();
+        assert(isCorrect[i] && "Writing pages with the log should not fail.");
+    }
+
+    rc = fileHandle.collectLogCounterValues(recordCount, flushCount, recoveredCount);
+    assert(rc == success && "Collecting the log counter values should not fail.");
+    assert(recordCount >= numOfPages * numOfVersions && "Every page written should be logged.");
+    assert(flushCount > 0 && flushCount <= recordCount && "A log sync should cover one or more records.");
+    cout << "Logged " << recordCount << " pages with " << flushCount << " syncs." << endl;
+
+    for (PageNum pageNum = 0; pageNum < numOfPages; pageNum++)
+    {
+        rc = fileHandle.readPage(pageNum, buffer);
+        assert(rc == success && "Reading a page should not fail.");
+        preparePage(pageNum, numOfVersions, data);
+        assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "The page read should be the last one written.");
+    }
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // A checkpoint writes the pages back and empties the log
+    rc = pfm->flushAllPages();
+    assert(rc == success && "Flushing all pages should not fail.");
+    assert(!WriteAheadLog::hasRecords(fileName) && "The log should be emptied by a checkpoint.");
+    assert(getFileSize(fileName) == (numOfPages + 1) * PAGE_SIZE && "The pages should be written back.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    struct stat logStat;
+    assert(stat(logFileName.c_str(), &logStat) != 0 && "The log should be removed with the file.");
+
+    cout << "RBF Test Case WAL Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the write-ahead log
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test_wal");
+    remove("test_wal.wal");
+
+    RC rcmain = RBFTest_WAL(pfm);
+    return rcmain;
+}
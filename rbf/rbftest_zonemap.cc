@@ -0,0 +1,283 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+struct Employee {
+    string name;
+    bool isAgeNull;
+    int32_t age;
+};
+
+// An employee whose age is NULL for one record out of seven among the first 2000, and whose salary identifies it
+Employee getEmployee(unsigned recordNum)
+{
+    Employee employee;
+    employee.name = string(1 + recordNum % 20, 'a' + recordNum % 26);
+    employee.isAgeNull = recordNum < 2000 && recordNum % 7 == 0;
+    employee.age = recordNum % 100;
+    return employee;
+}
+
+void prepareEmployeeRecord(const Employee &employee, int32_t salary, byte *record)
+{
+    unsigned char nullsIndicator = employee.isAgeNull ? 0x40 : 0;
+    int recordSize = 0;
+    prepareRecord(4, &nullsIndicator, employee.name.size(), employee.name, employee.age, 170, salary, record,
+                  &recordSize);
+}
+
+// Scan the file with the condition and check that exactly the employees (by salary) satisfying isSatisfied are
+// returned; return the stats of the scan
+template<typename Satisfied>
+ScanStats checkScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                    const ScanCondition &condition, const map<int32_t, Employee> &employees, Satisfied isSatisfied)
+{
+    vector<string> attributeNames(1, "Salary");
+    RBFM_ScanIterator scanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, condition, attributeNames, scanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    map<int32_t, bool> isReturned;
+    RID rid;
+    byte data[PAGE_SIZE];
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF)
+    {
+        int32_t salary = *((int32_t*) (data + 1));
+        auto employee = employees.find(salary);
+        assert(employee != employees.end() && !isReturned[salary] && isSatisfied(salary, employee->second)
+               && "Only the satisfying records should be returned, once.");
+        isReturned[salary] = true;
+    }
+    scanIterator.close();
+
+    unsigned numOfSatisfyingRecords = 0;
+    for (const auto &employee : employees)
+    {
+        numOfSatisfyingRecords += isSatisfied(employee.first, employee.second) ? 1 : 0;
+    }
+    assert(isReturned.size() == numOfSatisfyingRecords && "Every satisfying record should be returned.");
+
+    ScanStats stats = scanIterator.getStats();
+    cout << numOfSatisfyingRecords << " records returned, " << stats.numOfPagesRead << " pages read and "
+         << stats.numOfPagesSkipped << " skipped." << endl;
+    return stats;
+}
+
+int RBFTest_ZoneMap(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. A scan skips the pages whose zones cannot satisfy its condition, and returns the same records
+    // 2. Inserts, updates and deletes keep the zones covering the records of their pages
+    // 3. The parallel scan skips the same pages
+    // 4. A zone map of an unknown attribute cannot be created
+    // 5. The zones are saved when the file is closed, loaded by the next process, and dropped if the file was not
+    //    closed after they changed
+    cout << endl << "***** In RBF Test Case Zone Map *****" << endl;
+
+    RC rc;
+    string fileName = "test_zonemap";
+    const unsigned numOfRecords = 20000;
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    byte record[PAGE_SIZE];
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    map<int32_t, Employee> employees;
+    map<int32_t, RID> rids;
+    for (unsigned i = 0; i < numOfRecords; i++)
+    {
+        employees[i] = getEmployee(i);
+        prepareEmployeeRecord(employees[i], i, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    int32_t salary = 1000;
+    ScanCondition lowSalaries = {{{COMPARE_PRED, "Salary", LT_OP, &salary}}};
+    auto isLowSalary = [](int32_t salary, const Employee&) { return salary < 1000; };
+    ScanStats stats = checkScan(rbfm, fileHandle, recordDescriptor, lowSalaries, employees, isLowSalary);
+    assert(stats.numOfPagesSkipped == 0 && "No page should be skipped without a zone map.");
+    PageNum numOfDataPages = stats.numOfPagesRead;
+
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Weight");
+    assert(rc != success && "A zone map of an unknown attribute should not be created.");
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Salary");
+    assert(rc == success && "Creating a zone map should not fail.");
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Age");
+    assert(rc == success && "Creating a zone map should not fail.");
+
+    // the salaries follow the pages, so that most of them are skipped
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, lowSalaries, employees, isLowSalary);
+    assert(stats.numOfPagesRead + stats.numOfPagesSkipped == numOfDataPages
+           && stats.numOfPagesRead < numOfDataPages / 10 && "The pages of higher salaries should be skipped.");
+
+    // Age IS NULL OR Salary >= 19000: the NULL ages are in the first pages
+    int32_t highSalary = 19000;
+    ScanCondition condition = {{{IS_NULL_PRED, "Age", NO_OP, NULL}, {COMPARE_PRED, "Salary", GE_OP, &highSalary}}};
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee &employee) { return employee.isAgeNull || salary >= 19000; });
+    assert(stats.numOfPagesSkipped > numOfDataPages / 2 && "The pages with neither should be skipped.");
+
+    // a predicate on an attribute without zones may match any page
+    int32_t age = 50;
+    condition = {{{COMPARE_PRED, "Age", GT_OP, &age}, {COMPARE_PRED, "EmpName", NE_OP, NULL}}};
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, condition, employees,
+                      [](int32_t, const Employee&) { return true; });
+    assert(stats.numOfPagesSkipped == 0 && "No page should be skipped.");
+
+    // Delete the low salaries, then insert salaries above the others, which go into the emptied pages
+    for (int32_t i = 0; i < 1000; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        employees.erase(i);
+    }
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, lowSalaries, employees, isLowSalary);
+    assert(stats.numOfPagesRead <= 1 && "The emptied pages should be skipped, the page shared with salary 1000 read.");
+
+    for (int32_t i = 100000; i < 100500; i++)
+    {
+        employees[i] = getEmployee(i);
+        prepareEmployeeRecord(employees[i], i, record);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    salary = 100000;
+    condition = {{{COMPARE_PRED, "Salary", GE_OP, &salary}}};
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee&) { return salary >= 100000; });
+    assert(stats.numOfPagesSkipped > 0 && "The pages of lower salaries should be skipped.");
+
+    // Update records of the last pages to low salaries with NULL ages, some with names long enough to be moved
+    for (int32_t i = numOfRecords - 50; i < (int32_t) numOfRecords; i++)
+    {
+        Employee employee = employees[i];
+        employee.isAgeNull = true;
+        if (i % 2 == 0) {
+            employee.name = string(30, 'z');
+        }
+        employees.erase(i);
+        employees[i - numOfRecords] = employee;
+        prepareEmployeeRecord(employee, i - numOfRecords, record);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+    }
+    salary = 0;
+    condition = {{{COMPARE_PRED, "Salary", LT_OP, &salary}}, {{IS_NULL_PRED, "Age", NO_OP, NULL}}};
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee &employee) { return salary < 0 && employee.isAgeNull; });
+    assert(stats.numOfPagesSkipped > 0 && "The pages of higher salaries should be skipped.");
+
+    // The parallel scan returns the same records as the serial scan, and skips the same pages
+    salary = 5000;
+    condition = {{{COMPARE_PRED, "Salary", LT_OP, &salary}}};
+    stats = checkScan(rbfm, fileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee&) { return salary < 5000; });
+    RBFM_ParallelScanIterator parallelScanIterator;
+    vector<string> attributeNames(1, "Salary");
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, condition, attributeNames, 4, false, parallelScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RecordBatch batch;
+    unsigned numOfScannedRecords = 0;
+    while (parallelScanIterator.getNextBatch(batch) != RBFM_EOF)
+    {
+        numOfScannedRecords += batch.getNumOfRecords();
+    }
+    ScanStats parallelStats = parallelScanIterator.getStats();
+    parallelScanIterator.close();
+    unsigned numOfSatisfyingRecords = 0;
+    for (const auto &employee : employees)
+    {
+        numOfSatisfyingRecords += (employee.first < 5000) ? 1 : 0;
+    }
+    assert(numOfScannedRecords == numOfSatisfyingRecords && parallelStats.numOfPagesRead == stats.numOfPagesRead
+           && parallelStats.numOfPagesSkipped == stats.numOfPagesSkipped
+           && "The parallel scan should skip the same pages.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    struct stat mapStat;
+    assert(stat(ZoneMap::getMapFileName(fileName).c_str(), &mapStat) == 0 && "The zones should be saved.");
+
+    // A copy of the file is another file to this process, so its zones are read from the saved ones
+    string copyFileName = fileName + "_copy";
+    copyFile(fileName, copyFileName);
+    copyFile(ZoneMap::getMapFileName(fileName), ZoneMap::getMapFileName(copyFileName));
+    FileHandle copyFileHandle;
+    rc = rbfm->openFile(copyFileName, copyFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    ScanStats loadedStats = checkScan(rbfm, copyFileHandle, recordDescriptor, condition, employees,
+                                      [](int32_t salary, const Employee&) { return salary < 5000; });
+    assert(loadedStats.numOfPagesRead == stats.numOfPagesRead
+           && loadedStats.numOfPagesSkipped == stats.numOfPagesSkipped && "The saved zones should skip the same pages.");
+
+    // Move a salary into a skipped page, and copy the file with its saved zones before it is closed
+    Employee employee = employees[5000];
+    employees.erase(5000);
+    employees[1] = employee;
+    prepareEmployeeRecord(employee, 1, record);
+    rc = rbfm->updateRecord(copyFileHandle, recordDescriptor, record, rids[5000]);
+    assert(rc == success && "Updating a record should not fail.");
+    rc = copyFileHandle.flushPages();
+    assert(rc == success && "Flushing the pages should not fail.");
+    string crashFileName = fileName + "_crash";
+    copyFile(copyFileName, crashFileName);
+    copyFile(ZoneMap::getMapFileName(copyFileName), ZoneMap::getMapFileName(crashFileName));
+
+    FileHandle crashFileHandle;
+    rc = rbfm->openFile(crashFileName, crashFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    stats = checkScan(rbfm, crashFileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee&) { return salary < 5000; });
+    assert(stats.numOfPagesSkipped == 0 && "The zones saved before the changes should be dropped.");
+    assert(stat(ZoneMap::getMapFileName(crashFileName).c_str(), &mapStat) != 0 && "The dropped zones should be removed.");
+    stats = checkScan(rbfm, copyFileHandle, recordDescriptor, condition, employees,
+                      [](int32_t salary, const Employee&) { return salary < 5000; });
+    assert(stats.numOfPagesSkipped > 0 && "The zones kept in memory should have the change.");
+
+    rc = rbfm->closeFile(crashFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(copyFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(crashFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile(copyFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    assert(stat(ZoneMap::getMapFileName(fileName).c_str(), &mapStat) != 0 && "The saved zones should be destroyed.");
+
+    cout << "RBF Test Case Zone Map Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the zone maps of the scans
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test_zonemap");
+    remove("test_zonemap_copy");
+    remove("test_zonemap_crash");
+
+    RC rcmain = RBFTest_ZoneMap(rbfm);
+    return rcmain;
+}
@@ -9,6 +9,8 @@
 #include <stdexcept>
 #include <stdio.h> 
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "pfm.h"
 #include "rbfm.h"
@@ -55,6 +57,23 @@ bool compareFileSizes(string fileName1, string fileName2) {
     return true;
 }
 
+// Copy the given file, e.g., to open the copy as another file
+void copyFile(const string &from, const string &to)
+{
+    ifstream in(from, fstream::in | fstream::binary);
+    ofstream out(to, fstream::out | fstream::binary | fstream::trunc);
+    out << in.rdbuf();
+}
+
+// Write the file to disk, then drop it from the OS page cache
+void dropCachedFile(const string &fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
 // After createFile() check
 int createFileShouldSucceed(string &fileName) 
 {
@@ -879,3 +898,24 @@ void prepareLargeRecord4(int fieldCount, unsigned char *nullFieldsIndicator, con
 
 
 
+
+// A record of a single varchar field, used to fill record pages with records of chosen sizes
+void createPayloadDescriptor(vector<Attribute> &recordDescriptor, AttrLength maxLength = (AttrLength) PAGE_SIZE) {
+
+    Attribute attr;
+    attr.name = "Payload";
+    attr.type = TypeVarChar;
+    attr.length = maxLength;
+    recordDescriptor.push_back(attr);
+
+}
+
+// Function to prepare a payload record of the given length, filled with a byte derived from seed. Return its size.
+unsigned preparePayloadRecord(unsigned seed, unsigned length, void *buffer)
+{
+    byte *record = (byte *) buffer;
+    record[0] = 0;  // nulls indicator
+    *((uint32_t *) (record + 1)) = length;
+    memset(record + 1 + sizeof(uint32_t), 'a' + seed % 26, length);
+    return 1 + sizeof(uint32_t) + length;
+}
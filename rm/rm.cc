@@ -146,11 +146,36 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     return SUCCESS;
 }
 
+RC RelationManager::insertTuples(const string &tableName, const vector<const void*> &data, vector<RID> &rids) {
+    FileHandle fileHandle;
+    vector<Attribute> recordDescriptor;
+    vector<Index> relatedIndices;
+
+    if (isSystemTable(tableName)) {
+        return FAIL;
+    }
+    if (rbfm->openFile(tableName, fileHandle) == FAIL) {
+        return FAIL;
+    }
+    prepareRecordDescriptor(tableName, recordDescriptor);
+    if (rbfm->insertRecords(fileHandle, recordDescriptor, data, rids) == FAIL) {
+        rbfm->closeFile(fileHandle);
+        return FAIL;
+    }
+    prepareRelatedIndices(tableName, relatedIndices);
+    insertEntriesToRelatedIndices(relatedIndices, recordDescriptor, data, rids);
+
+    rbfm->closeFile(fileHandle);
+
+    return SUCCESS;
+}
+
 RC RelationManager::deleteTuple(const string &tableName, const RID &rid) {
     FileHandle fileHandle;
     vector<Attribute> recordDescriptor;
     vector<Index> relatedIndices;
-    void *data = malloc(PAGE_SIZE);
+    PageBuffer tuple;
+    void *data = tuple.get();
 
     if (isSystemTable(tableName) || isSystemTuple(tableName, rid)) {
         return FAIL;
@@ -168,7 +193,6 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid) {
     prepareRelatedIndices(tableName, relatedIndices);
     deleteEntriesToRelatedIndices(relatedIndices, recordDescriptor, data, rid);
     rbfm->closeFile(fileHandle);
-    free(data);
 
     return SUCCESS;
 }
@@ -177,7 +201,8 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     FileHandle fileHandle;
     vector<Attribute> recordDescriptor;
     vector<Index> relatedIndices;
-    void *oldData = malloc(PAGE_SIZE);
+    PageBuffer oldTuple;
+    void *oldData = oldTuple.get();
 
     if (isSystemTable(tableName) || isSystemTuple(tableName, rid)) {
         return FAIL;
@@ -197,7 +222,6 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     deleteEntriesToRelatedIndices(relatedIndices, recordDescriptor, oldData, rid);
     insertEntriesToRelatedIndices(relatedIndices, recordDescriptor, data, rid);
     rbfm->closeFile(fileHandle);
-    free(oldData);
 
     return SUCCESS;
 }
@@ -536,40 +560,26 @@ RC RelationManager::prepareIndexRid(const string &indexName, RID &rid) {
 
 RC RelationManager::preparePositionAttributeMap(int tableId, unordered_map<int, Attribute> &positionAttributeMap) {
     RID rid;
+    RecordView view;
     RM_ScanIterator rm_scanIterator;
-    void *returnedData = malloc(PAGE_SIZE);
     vector<string> attributeNames;
     attributeNames.push_back(COLUMN_NAME);
     attributeNames.push_back(COLUMN_TYPE);
     attributeNames.push_back(COLUMN_LENGTH);
     attributeNames.push_back(COLUMN_POSITION);
-    int nullFieldIndicatorSize = getBytesOfNullIndicator(attributeNames.size());
 
     if (scan(COLUMNS_TABLE, TABLE_ID, EQ_OP, getScanValue(tableId), attributeNames, rm_scanIterator) == FAIL) {
         return FAIL;
     }
-    while (rm_scanIterator.getNextTuple(rid, returnedData) != RM_EOF) {
+    while (rm_scanIterator.getNextTuple(rid, view) != RM_EOF) {
         Attribute attribute;
-        int offset = 0;
-
-        int columnNameLength = *(uint32_t *) ((char *) returnedData + nullFieldIndicatorSize + offset);
-        offset += sizeof(uint32_t);
-        attribute.name = string((char *) returnedData + nullFieldIndicatorSize + offset, columnNameLength);
-        offset += columnNameLength;
-
-        int columnType = *(int *) ((char *) returnedData + offset + nullFieldIndicatorSize);
-        attribute.type = (AttrType) columnType;
-        offset += sizeof(int);
-
-        int columnLength = *(int *) ((char *) returnedData + offset + nullFieldIndicatorSize);
-        attribute.length = columnLength;
-        offset += sizeof(int);
-
-        int columnPositon = *(int *) ((char *) returnedData + offset + nullFieldIndicatorSize);
-        positionAttributeMap[columnPositon] = attribute;
-        offset += sizeof(int);
+        unsigned columnNameLength;
+        const char *columnName = view.getVarChar(0, columnNameLength);
+        attribute.name = string(columnName, columnNameLength);
+        attribute.type = (AttrType) view.getInt(1);
+        attribute.length = view.getInt(2);
+        positionAttributeMap[view.getInt(3)] = attribute;
     }
-    free(returnedData);
     rm_scanIterator.close();
     return SUCCESS;
 }
@@ -639,33 +649,26 @@ Attribute RelationManager::getAttribute(const string &attributeName, int tableId
     Attribute attribute;
     attribute.length = 0;
     RID rid;
+    RecordView view;
     RM_ScanIterator rm_scanIterator;
-    void *returnedData = malloc(PAGE_SIZE);
     vector<string> attributeNames;
     attributeNames.push_back(COLUMN_NAME);
     attributeNames.push_back(COLUMN_TYPE);
     attributeNames.push_back(COLUMN_LENGTH);
-//    int offset = getBytesOfNullIndicator(attributeNames.size());
 
     if (scan(COLUMNS_TABLE, TABLE_ID, EQ_OP, &tableId, attributeNames, rm_scanIterator) == FAIL) {
         return attribute;
     }
-    while (rm_scanIterator.getNextTuple(rid, returnedData) != RM_EOF) {
-        int offset = getBytesOfNullIndicator(attributeNames.size());
-        int nameLength = *((int *) ((char *) returnedData + offset));
-        offset += sizeof(int);
-        string currentAttributeName((char *) returnedData + offset, nameLength);
-        if (currentAttributeName == attributeName) {
+    while (rm_scanIterator.getNextTuple(rid, view) != RM_EOF) {
+        unsigned nameLength;
+        const char *name = view.getVarChar(0, nameLength);
+        if (attributeName.compare(0, string::npos, name, nameLength) == 0) {
             attribute.name = attributeName;
-            offset += nameLength;
-            attribute.type = *((AttrType *) ((char *) returnedData + offset));
-            offset += sizeof(AttrType); //
-            attribute.length = *((AttrLength *) ((char *) returnedData + offset));
-            offset += sizeof(AttrLength);
+            attribute.type = (AttrType) view.getInt(1);
+            attribute.length = view.getInt(2);
             break;
         }
     }
-    free(returnedData);
     rm_scanIterator.close();
     return attribute;
 }
@@ -769,6 +772,30 @@ RC RelationManager::insertEntriesToRelatedIndices(const vector<Index> &relatedIn
     return SUCCESS;
 }
 
+RC RelationManager::insertEntriesToRelatedIndices(const vector<Index> &relatedIndices,
+                                                  const vector<Attribute> &recordDescriptor,
+                                                  const vector<const void*> &data, const vector<RID> &rids) {
+    IXFileHandle ixFileHandle;
+    PageBuffer key;
+    Attribute attribute;
+
+    for (Index relatedIndex : relatedIndices) {
+        if (ix->openFile(relatedIndex.indexName, ixFileHandle) == FAIL) {
+            return FAIL;
+        }
+        for (size_t i = 0; i < data.size(); i++) {
+            if (prepareKeyAndAttribute(recordDescriptor, data[i], relatedIndex.attributeName, key.get(), attribute) == FAIL
+                || ix->insertEntry(ixFileHandle, attribute, key.get(), rids[i]) == FAIL) {
+                ix->closeFile(ixFileHandle);
+                return FAIL;
+            }
+        }
+        ix->closeFile(ixFileHandle);
+    }
+
+    return SUCCESS;
+}
+
 RC RelationManager::deleteEntriesToRelatedIndices(const vector<Index> &relatedIndices, 
                                                   const vector<Attribute> &recordDescriptor, 
                                                   const void *data, const RID &rid) {
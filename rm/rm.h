@@ -33,6 +33,11 @@ public:
         return (rbfm_scanIterator.getNextRecord(rid, data) == RBFM_EOF) ? RM_EOF : SUCCESS;
     }
 
+    // The tuple is read in its page, see RecordView
+    RC getNextTuple(RID &rid, RecordView &view) {
+        return (rbfm_scanIterator.getNextRecord(rid, view) == RBFM_EOF) ? RM_EOF : SUCCESS;
+    }
+
     RC close() { return rbfm_scanIterator.close(); }
 
 private:
@@ -73,6 +78,9 @@ public:
 
     RC insertTuple(const string &tableName, const void *data, RID &rid);
 
+    // Insert the tuples in order with RecordBasedFileManager::insertRecords() and set rids to their RIDs
+    RC insertTuples(const string &tableName, const vector<const void*> &data, vector<RID> &rids);
+
     RC deleteTuple(const string &tableName, const RID &rid);
 
     RC updateTuple(const string &tableName, const void *data, const RID &rid);
@@ -190,6 +198,10 @@ private:
     RC insertEntriesToRelatedIndices(const vector<Index> &relatedIndices, const vector<Attribute> &recordDescriptor,
                                      const void *data, const RID &rid);
 
+    // Each index file is opened once for all the tuples
+    RC insertEntriesToRelatedIndices(const vector<Index> &relatedIndices, const vector<Attribute> &recordDescriptor,
+                                     const vector<const void*> &data, const vector<RID> &rids);
+
     RC deleteEntriesToRelatedIndices(const vector<Index> &relatedIndices, const vector<Attribute> &recordDescriptor,
                                      const void *data, const RID &rid);
 